@@ -24,7 +24,16 @@
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/types.h>
-#include <zlib.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "crc32.h"
+#include "dcd.h"
+#include "hash.h"
+#include "lz4.h"
+#include "output.h"
+#include "stats.h"
+#include "trace.h"
 
 #ifndef O_BINARY
 #define O_BINARY 0
@@ -261,477 +270,93 @@ struct fdt_header {
 
 #define UNDEFINED 0xFFFFFFFF
 
-static void fill_zero(int ifd, int size, int offset)
-{
-	int fill_size;
-	int ret;
-	uint8_t zeros[4096];
-	memset(zeros, 0, sizeof(zeros));
-
-	ret = lseek(ifd, offset, SEEK_SET);
-	if (ret < 0) {
-		fprintf(stderr, "%s: lseek error %s\n",
-				__func__, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
-	while (size) {
-
-		if (size > 4096)
-			fill_size = 4096;
-		else
-			fill_size = size;
-
-		if (write(ifd, (char *)&zeros, fill_size) != fill_size) {
-			fprintf(stderr, "Write error: %s\n",
-				strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-
-		size -= fill_size;
-
-	};
-}
+/*
+ * Inputs are opened, stat'ed and mapped once per run, whatever the number
+ * of places that look at them.
+ */
+#define IN_MAX_FILES 32
 
-static void
-copy_file (int ifd, const char *datafile, int pad, int offset, int datafile_offset)
-{
-	int dfd;
+typedef struct {
+	char *name;
+	int fd;
 	struct stat sbuf;
-	unsigned char *ptr;
-	int tail;
-	int zero = 0;
-	uint8_t zeros[4096];
-	int size, ret;
-
-	memset(zeros, 0, sizeof(zeros));
+	uint8_t *data;
+} in_file_t;
 
-	if ((dfd = open(datafile, O_RDONLY|O_BINARY)) < 0) {
-		fprintf (stderr, "Can't open %s: %s\n",
-			datafile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
+static in_file_t in_files[IN_MAX_FILES];
+static int in_file_count;
 
-	if (fstat(dfd, &sbuf) < 0) {
-		fprintf (stderr, "Can't stat %s: %s\n",
-			datafile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
+static in_file_t *in_open(const char *filename)
+{
+	in_file_t *in;
 
-	ptr = mmap(0, sbuf.st_size, PROT_READ, MAP_SHARED, dfd, 0);
-	if (ptr == MAP_FAILED) {
-		fprintf (stderr, "Can't read %s: %s\n",
-			datafile, strerror(errno));
-		exit (EXIT_FAILURE);
+	for (int i = 0; i < in_file_count; i++) {
+		if (!strcmp(in_files[i].name, filename))
+			return &in_files[i];
 	}
 
-	size = sbuf.st_size - datafile_offset;
-	ret = lseek(ifd, offset, SEEK_SET);
-	if (ret < 0) {
-		fprintf(stderr, "%s: lseek error %s\n",
-				__func__, strerror(errno));
+	if (in_file_count == IN_MAX_FILES) {
+		fprintf(stderr, "%s: too many input files (max %d)\n",
+			filename, IN_MAX_FILES);
 		exit(EXIT_FAILURE);
 	}
-	if (write(ifd, ptr + datafile_offset, size) != size) {
-		fprintf (stderr, "Write error %s\n",
-			strerror(errno));
-		exit (EXIT_FAILURE);
-	}
 
-	tail = size % 4;
-	pad = pad - size;
-	if ((pad == 1) && (tail != 0)) {
-
-		if (write(ifd, (char *)&zero, 4-tail) != 4-tail) {
-			fprintf (stderr, "Write error on %s\n",
-				strerror(errno));
-			exit (EXIT_FAILURE);
-		}
-	} else if (pad > 1) {
-		while (pad > 0) {
-			int todo = sizeof(zeros);
-
-			if (todo > pad)
-				todo = pad;
-			if (write(ifd, (char *)&zeros, todo) != todo) {
-				fprintf(stderr, "Write error: %s\n",
-					strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-			pad -= todo;
-		}
-	}
-
-	(void) munmap((void *)ptr, sbuf.st_size);
-	(void) close (dfd);
-}
-
-static void append_data(char *filename, uint8_t *data, int size)
-{
-	int dfd, ret;
-
-	if ((dfd = open(filename, O_RDWR|O_BINARY)) < 0) {
-		fprintf (stderr, "Can't open %s: %s\n",
+	in = &in_files[in_file_count++];
+	in->name = strdup(filename);
+	in->fd = open(filename, O_RDONLY | O_BINARY);
+	if (in->fd < 0) {
+		fprintf(stderr, "%s: Can't open: %s\n",
 			filename, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-
-	ret = lseek(dfd, 0, SEEK_END);
-	if (ret < 0) {
-		fprintf(stderr, "%s: lseek error %s\n",
-				__func__, strerror(errno));
 		exit(EXIT_FAILURE);
 	}
-	if (write(dfd, data, size) != size) {
-		fprintf (stderr, "Write error %s\n",
-			strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-	(void) close (dfd);
-}
-
-
-enum imximage_fld_types {
-	CFG_INVALID = -1,
-	CFG_COMMAND,
-	CFG_REG_SIZE,
-	CFG_REG_ADDRESS,
-	CFG_REG_VALUE
-};
-
-enum imximage_cmd {
-	CMD_INVALID,
-	CMD_IMAGE_VERSION,
-	CMD_BOOT_FROM,
-	CMD_BOOT_OFFSET,
-	CMD_WRITE_DATA,
-	CMD_WRITE_CLR_BIT,
-	CMD_WRITE_SET_BIT,
-	CMD_CHECK_BITS_SET,
-	CMD_CHECK_BITS_CLR,
-	CMD_CHECK_ANY_BIT_SET,
-	CMD_CHECK_ANY_BIT_CLR,
-	CMD_CSF,
-	CMD_PLUGIN,
-};
-
-typedef struct table_entry {
-	int	id;
-	char	*sname;		/* short (input) name to find table entry */
-	char	*lname;		/* long (output) name to print for messages */
-} table_entry_t;
 
-/*
- * Supported commands for configuration file
- */
-static table_entry_t imximage_cmds[] = {
-	{CMD_BOOT_FROM,         "BOOT_FROM",            "boot command",	  },
-	{CMD_BOOT_OFFSET,       "BOOT_OFFSET",          "Boot offset",	  },
-	{CMD_WRITE_DATA,        "DATA",                 "Reg Write Data", },
-	{CMD_WRITE_CLR_BIT,     "CLR_BIT",              "Reg clear bit",  },
-	{CMD_WRITE_SET_BIT,     "SET_BIT",              "Reg set bit",  },
-	{CMD_CHECK_BITS_SET,    "CHECK_BITS_SET",   "Reg Check all bits set", },
-	{CMD_CHECK_BITS_CLR,    "CHECK_BITS_CLR",   "Reg Check all bits clr", },
-	{CMD_CHECK_ANY_BIT_SET, "CHECK_ANY_BIT_SET",   "Reg Check any bit set", },
-	{CMD_CHECK_ANY_BIT_CLR, "CHECK_ANY_BIT_CLR",   "Reg Check any bit clr", },
-	{CMD_CSF,               "CSF",           "Command Sequence File", },
-	{CMD_IMAGE_VERSION,     "IMAGE_VERSION",        "image version",  },
-	{-1,                    "",                     "",	          },
-};
-
-static uint32_t imximage_version;
-static struct dcd_v2_cmd *gd_last_cmd;
-static uint32_t imximage_ivt_offset = UNDEFINED;
-static uint32_t imximage_csf_size = UNDEFINED;
-
-int get_table_entry_id(const table_entry_t *table,
-		const char *table_name, const char *name)
-{
-	const table_entry_t *t;
-
-	for (t = table; t->id >= 0; ++t) {
-		if (t->sname && strcasecmp(t->sname, name) == 0)
-			return (t->id);
-	}
-
-	return -1;
-}
-
-static uint32_t get_cfg_value(char *token, char *name,  int linenr)
-{
-	char *endptr;
-	uint32_t value;
-
-	errno = 0;
-	value = strtoul(token, &endptr, 16);
-	if (errno || (token == endptr)) {
-		fprintf(stderr, "Error: %s[%d] - Invalid hex data(%s)\n",
-			name,  linenr, token);
+	if (fstat(in->fd, &in->sbuf) < 0) {
+		fprintf(stderr, "%s: Can't stat: %s\n",
+			filename, strerror(errno));
 		exit(EXIT_FAILURE);
 	}
-	return value;
-}
-
-static void set_dcd_param_v2(dcd_v2_t *dcd_v2, uint32_t dcd_len,
-		int32_t cmd)
-{
-	struct dcd_v2_cmd *d = gd_last_cmd;
-	struct dcd_v2_cmd *d2;
-	int len;
-
-	if (!d)
-		d = &dcd_v2->dcd_cmd;
-	d2 = d;
-	len = be16_to_cpu(d->write_dcd_command.length);
-	if (len > 4)
-		d2 = (struct dcd_v2_cmd *)(((char *)d) + len);
-
-	switch (cmd) {
-	/* Write value: *address = val_msk */
-	case CMD_WRITE_DATA:
-		if ((d->write_dcd_command.tag == DCD_WRITE_DATA_COMMAND_TAG) &&
-		    (d->write_dcd_command.param == DCD_WRITE_DATA_PARAM))
-			break;
-		d = d2;
-		d->write_dcd_command.tag = DCD_WRITE_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_WRITE_DATA_PARAM;
-		break;
-	/* Clear bitmask: *address &= ~val_msk */
-	case CMD_WRITE_CLR_BIT:
-		if ((d->write_dcd_command.tag == DCD_WRITE_DATA_COMMAND_TAG) &&
-		    (d->write_dcd_command.param == DCD_WRITE_CLR_BIT_PARAM))
-			break;
-		d = d2;
-		d->write_dcd_command.tag = DCD_WRITE_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_WRITE_CLR_BIT_PARAM;
-		break;
-	/* Set  bitmask: *address |= val_msk */
-	case CMD_WRITE_SET_BIT:
-		if ((d->write_dcd_command.tag == DCD_WRITE_DATA_COMMAND_TAG) &&
-		    (d->write_dcd_command.param == DCD_WRITE_SET_BIT_PARAM))
-			break;
-		d = d2;
-		d->write_dcd_command.tag = DCD_WRITE_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_WRITE_SET_BIT_PARAM;
-		break;
-	/*
-	 * Check data command only supports one entry,
-	 */
-	/* All bits set: (*address & mask) == mask */
-	case CMD_CHECK_BITS_SET:
-		d = d2;
-		d->write_dcd_command.tag = DCD_CHECK_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_CHECK_BITS_SET_PARAM;
-		break;
-	/* All bits clear: (*address & mask) == 0 */
-	case CMD_CHECK_BITS_CLR:
-		d = d2;
-		d->write_dcd_command.tag = DCD_CHECK_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_CHECK_BITS_CLR_PARAM;
-		break;
-	default:
-		break;
-	}
-	gd_last_cmd = d;
-}
-
-static void set_dcd_val_v2(dcd_v2_t *dcd_v2, char *name, int lineno,
-					int fld, uint32_t value, uint32_t off)
-{
-	struct dcd_v2_cmd *d = gd_last_cmd;
-	int len;
-
-	len = be16_to_cpu(d->write_dcd_command.length);
-	off = (len - 4) >> 3;
-
-	switch (fld) {
-	case CFG_REG_ADDRESS:
-		d->addr_data[off].addr = cpu_to_be32(value);
-		break;
-	case CFG_REG_VALUE:
-		d->addr_data[off].value = cpu_to_be32(value);
-		off++;
-		d->write_dcd_command.length = cpu_to_be16((off << 3) + 4);
-		break;
-	default:
-		break;
-
-	}
-}
-
-static uint32_t set_dcd_rst_v2(dcd_v2_t *dcd_v2, uint32_t dcd_len,
-						char *name, int lineno)
-{
-	struct dcd_v2_cmd *d = gd_last_cmd;
-	int len;
-
-	if (!d)
-		d = &dcd_v2->dcd_cmd;
-	len = be16_to_cpu(d->write_dcd_command.length);
-	if (len > 4)
-		d = (struct dcd_v2_cmd *)(((char *)d) + len);
-
-	len = (char *)d - (char *)&dcd_v2->header;
-
-	dcd_v2->header.tag = DCD_HEADER_TAG;
-	dcd_v2->header.length = cpu_to_be16(len);
-	dcd_v2->header.version = DCD_VERSION;
 
-	return len;
-}
-
-static void parse_cfg_cmd(dcd_v2_t *dcd_v2, int32_t cmd, char *token,
-				char *name, int lineno, int fld, int dcd_len)
-{
-	int value;
-	static int cmd_ver_first = ~0;
-
-	switch (cmd) {
-	case CMD_IMAGE_VERSION:
-		imximage_version = get_cfg_value(token, name, lineno);
-		if (cmd_ver_first == 0) {
-			fprintf(stderr, "Error: %s[%d] - IMAGE_VERSION "
-				"command need be the first before other "
-				"valid command in the file\n", name, lineno);
-			exit(EXIT_FAILURE);
-		}
-		cmd_ver_first = 1;
-		break;
-	case CMD_BOOT_OFFSET:
-		imximage_ivt_offset = get_cfg_value(token, name, lineno);
-		if (cmd_ver_first != 1)
-			cmd_ver_first = 0;
-		break;
-	case CMD_WRITE_DATA:
-	case CMD_WRITE_CLR_BIT:
-	case CMD_WRITE_SET_BIT:
-	case CMD_CHECK_BITS_SET:
-	case CMD_CHECK_BITS_CLR:
-		value = get_cfg_value(token, name, lineno);
-		set_dcd_param_v2(dcd_v2, dcd_len, cmd);
-		set_dcd_val_v2(dcd_v2, name, lineno, fld, value, dcd_len); /*nothing to do for v2, because we are in CFG_REG_SIZE fld */
-		if (cmd_ver_first != 1)
-			cmd_ver_first = 0;
-		break;
-	case CMD_CSF:
-		if (imximage_version != 2) {
-			fprintf(stderr,
-				"Error: %s[%d] - CSF only supported for VERSION 2(%s)\n",
-				name, lineno, token);
+	if (in->sbuf.st_size) {
+		in->data = mmap(0, in->sbuf.st_size, PROT_READ, MAP_SHARED, in->fd, 0);
+		if (in->data == MAP_FAILED) {
+			fprintf(stderr, "%s: Can't read: %s\n",
+				filename, strerror(errno));
 			exit(EXIT_FAILURE);
 		}
-		imximage_csf_size = get_cfg_value(token, name, lineno);
-		if (cmd_ver_first != 1)
-			cmd_ver_first = 0;
-		break;
 	}
+
+	return in;
 }
 
-static void parse_cfg_fld(dcd_v2_t *dcd_v2, int32_t *cmd,
-		char *token, char *name, int lineno, int fld, int *dcd_len)
+static void fill_zero(output_t *out, int size, int offset)
 {
-	int value;
-
-	switch (fld) {
-	case CFG_COMMAND:
-		*cmd = get_table_entry_id(imximage_cmds,
-			"imximage commands", token);
-		if (*cmd < 0) {
-			fprintf(stderr, "Error: %s[%d] - Invalid command"
-			"(%s)\n", name, lineno, token);
-			exit(EXIT_FAILURE);
-		}
-		break;
-	case CFG_REG_SIZE:
-		parse_cfg_cmd(dcd_v2, *cmd, token, name, lineno, fld, *dcd_len);
-		break;
-	case CFG_REG_ADDRESS:
-	case CFG_REG_VALUE:
-		switch(*cmd) {
-		case CMD_WRITE_DATA:
-		case CMD_WRITE_CLR_BIT:
-		case CMD_WRITE_SET_BIT:
-		case CMD_CHECK_BITS_SET:
-		case CMD_CHECK_BITS_CLR:
-			value = get_cfg_value(token, name, lineno);
-			set_dcd_param_v2(dcd_v2, *dcd_len, *cmd);
-			set_dcd_val_v2(dcd_v2, name, lineno, fld, value,
-					*dcd_len);
-
-			if (fld == CFG_REG_VALUE) {
-				(*dcd_len)++;
-				if (*dcd_len > MAX_HW_CFG_SIZE_V2) {
-					fprintf(stderr, "Error: %s[%d] -"
-						"DCD table exceeds maximum size(%d)\n",
-						name, lineno, MAX_HW_CFG_SIZE_V2);
-					exit(EXIT_FAILURE);
-				}
-			}
-			break;
-		default:
-			break;
-		}
-		break;
-	default:
-		break;
-	}
-
+	stats_begin(STATS_PAD, NULL);
+	output_zero(out, offset, size);
+	stats_end(STATS_PAD);
 }
 
-static uint32_t parse_cfg_file(dcd_v2_t *dcd_v2, char *name)
+static void
+copy_file (output_t *out, const char *datafile, int pad, int offset, int datafile_offset)
 {
-	FILE *fd = NULL;
-	char *line = NULL;
-	char *token, *saveptr1, *saveptr2;
-	int lineno = 0;
-	int fld;
-	size_t len;
-	int dcd_len = 0, dcd_size = 0;
-	int32_t cmd;
-
-	fd = fopen(name, "r");
-	if (fd == 0) {
-		fprintf(stderr, "Error: %s - Can't open DCD file\n", name);
-		exit(EXIT_FAILURE);
-	}
-
-	/*
-	 * Very simple parsing, line starting with # are comments
-	 * and are dropped
-	 */
-	while ((getline(&line, &len, fd)) > 0) {
-		lineno++;
-
-		token = strtok_r(line, "\r\n", &saveptr1);
-		if (token == NULL)
-			continue;
-
-		/* Check inside the single line */
-		for (fld = CFG_COMMAND, cmd = CMD_INVALID,
-				line = token; ; line = NULL, fld++) {
-			token = strtok_r(line, " \t", &saveptr2);
-			if (token == NULL)
-				break;
-
-			/* Drop all text starting with '#' as comments */
-			if (token[0] == '#')
-				break;
+	in_file_t *in;
+	int tail;
+	int size;
 
-			parse_cfg_fld(dcd_v2, &cmd, token, name,
-					lineno, fld, &dcd_len);
-		}
+	stats_begin(STATS_COPY, datafile);
 
-	}
+	in = in_open(datafile);
+	size = in->sbuf.st_size - datafile_offset;
+	output_write(out, offset, in->data + datafile_offset, size);
+	stats_add(STATS_BYTES_READ, size);
 
-	dcd_size = set_dcd_rst_v2(dcd_v2, dcd_len, name, lineno);
-	fclose(fd);
+	tail = size % 4;
+	pad = pad - size;
+	if ((pad == 1) && (tail != 0))
+		output_zero(out, offset + size, 4 - tail);
+	else if (pad > 1)
+		output_zero(out, offset + size, pad);
 
-	return dcd_size;
+	stats_end(STATS_COPY);
 }
 
 void dump_header_v2(imx_header_v2_t *imx_header, int index)
@@ -772,37 +397,20 @@ void dump_uimage_header(uimage_header_t * uimage_hd_ptr)
 	fprintf(stderr, "ih_name: \t\t%s\n", uimage_hd_ptr->ih_name);
 }
 
-void set_uimage_header(uimage_header_t * uimage_hd_ptr, int fd, uint32_t ep)
+/* dcrc is the crc of the sld-ivt image, computed while it was written */
+void set_uimage_header(uimage_header_t * uimage_hd_ptr, const struct stat *sbuf, uint32_t ep, uint32_t dcrc)
 {
 	uint32_t checksum;
 	time_t time;
-	struct stat sbuf;
-	void *file_ptr;
-
-	if (fstat(fd, &sbuf) < 0) {
-		fprintf(stderr, "set_uimage_header error: %s\n",
-			strerror(errno));
-		exit(EXIT_FAILURE);
-	}
 
-	time = sbuf.st_mtime;
-
-	file_ptr = mmap(0, sbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
-	if (file_ptr == MAP_FAILED) {
-		fprintf (stderr, "set_uimage_header, File can't read %s\n",
-			strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-
-	checksum = crc32(0,
-			(const unsigned char *)(file_ptr), sbuf.st_size); /* crc for image and ivt, not include CSF and uimage header */
+	time = sbuf->st_mtime;
 
 	uimage_hd_ptr->ih_magic = cpu_to_be32(IH_MAGIC);
 	uimage_hd_ptr->ih_time = cpu_to_be32(time);
-	uimage_hd_ptr->ih_size = cpu_to_be32((sbuf.st_size + 0x2000 - sizeof(flash_header_v2_t))); /* The st_size already contain the flash_header */
+	uimage_hd_ptr->ih_size = cpu_to_be32((sbuf->st_size + 0x2000 - sizeof(flash_header_v2_t))); /* The st_size already contain the flash_header */
 	uimage_hd_ptr->ih_load = cpu_to_be32(ep);
 	uimage_hd_ptr->ih_ep = cpu_to_be32(ep);
-	uimage_hd_ptr->ih_dcrc = cpu_to_be32(checksum);
+	uimage_hd_ptr->ih_dcrc = cpu_to_be32(dcrc); /* crc for image and ivt, not include CSF and uimage header */
 	uimage_hd_ptr->ih_os = IH_OS_U_BOOT;
 	uimage_hd_ptr->ih_arch = IH_ARCH_ARM;
 	uimage_hd_ptr->ih_type = IH_TYPE_FIRMWARE;
@@ -810,65 +418,43 @@ void set_uimage_header(uimage_header_t * uimage_hd_ptr, int fd, uint32_t ep)
 
 	strncpy((char *)uimage_hd_ptr->ih_name, "Second uimage loader", IH_NMLEN);
 
-	checksum = crc32(0, (const unsigned char *)uimage_hd_ptr,
+	checksum = crc32_update(0, (const unsigned char *)uimage_hd_ptr,
 				sizeof(uimage_header_t));
 	uimage_hd_ptr->ih_hcrc = cpu_to_be32(checksum);
 }
 
-void generate_sld_with_ivt(char * input_file, uint32_t ep, char *out_file)
+/*
+ * Write input_file + padding + IVT to out_file. Returns the crc of what was
+ * written (the uImage data crc), computed chunk by chunk as it is copied.
+ */
+uint32_t generate_sld_with_ivt(char * input_file, uint32_t ep, char *out_file)
 {
 #define IVT_ALIGN 0x1000
 
-	struct stat sbuf;
-	void *file_ptr;
-	int ivt_fd, input_fd;
+	in_file_t *in;
+	output_t *out;
+	off_t size;
 	int aligned_size;
 
-	int i;
-	char pad = 0;
-
-	input_fd = open(input_file, O_RDONLY | O_BINARY);
-	if (input_fd < 0) {
-		fprintf(stderr, "%s: Can't open: %s\n",
-                            input_file, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
-	if (fstat(input_fd, &sbuf) < 0) {
-		fprintf(stderr, "generate_sld_with_ivt error: %s\n",
-			strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	uint32_t crc;
+	size_t pad;
+	static const uint8_t zeros[IVT_ALIGN];
 
-	file_ptr = mmap(0, sbuf.st_size, PROT_READ, MAP_SHARED, input_fd, 0);
-	if (file_ptr == MAP_FAILED) {
-		fprintf (stderr, "generate_sld_with_ivt, File can't read %s\n",
-			strerror(errno));
-		exit (EXIT_FAILURE);
-	}
+	in = in_open(input_file);
+	size = in->sbuf.st_size;
+	out = output_open(out_file);
 
-	ivt_fd = open (out_file, O_RDWR|O_CREAT|O_TRUNC|O_BINARY, 0666);
-	if (ivt_fd < 0) {
-		fprintf(stderr, "%s: Can't open: %s\n",
-                                "sld-ivt.bin", strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	stats_begin(STATS_COPY, input_file);
+	stats_add(STATS_BYTES_READ, size);
 
-	if (write(ivt_fd, file_ptr, sbuf.st_size) != sbuf.st_size) {
-		fprintf(stderr, "error writing sld-ivt image\n");
-		exit(EXIT_FAILURE);
-	}
+	crc = crc32_update(0, in->data, size);
+	output_write(out, 0, in->data, size);
 
-	aligned_size = (sbuf.st_size + sizeof(uimage_header_t) + IVT_ALIGN - 1) & ~(IVT_ALIGN - 1);
-	i = sbuf.st_size + sizeof(uimage_header_t);
+	aligned_size = (size + sizeof(uimage_header_t) + IVT_ALIGN - 1) & ~(IVT_ALIGN - 1);
+	pad = aligned_size - size - sizeof(uimage_header_t);
 
-	for (; i < aligned_size; i++) {
-		if (write(ivt_fd, (char *) &pad, 1) != 1) {
-			fprintf(stderr,
-					"Pad error on sld-ivt image\n");
-			exit(EXIT_FAILURE);
-		}
-	}
+	crc = crc32_update(crc, zeros, pad);
+	output_zero(out, size, pad);
 
 	flash_header_v2_t ivt_header = { { 0xd1, 0x2000, 0x40 },
 		ep, 0, 0, 0,
@@ -876,74 +462,42 @@ void generate_sld_with_ivt(char * input_file, uint32_t ep, char *out_file)
 		(ep + aligned_size - sizeof(uimage_header_t) + 0x20),
 		0 };
 
-	if (write(ivt_fd, &ivt_header, sizeof(flash_header_v2_t)) != sizeof(flash_header_v2_t)) {
-		fprintf(stderr, "IVT writing error on sld-ivt image\n");
-		exit(EXIT_FAILURE);
-	}
+	crc = crc32_update(crc, &ivt_header, sizeof(flash_header_v2_t));
+	output_write(out, size + pad, &ivt_header, sizeof(flash_header_v2_t));
+
+	output_close(out);
+	stats_end(STATS_COPY);
 
-	munmap((void *)file_ptr, sbuf.st_size);
-	close(ivt_fd);
-	close(input_fd);
+	return crc;
 }
 
 #define HASH_MAX_LEN 32
+/* sha256 of the FIT structure, checked by SPL before it uses the FIT */
 static void calc_fitimage_hash(char* filename, uint8_t *hash)
 {
-	int sld_fd;
-	FILE *fp = NULL;
-	char sha_command[512];
-	char *digest_type = "sha256sum";
-	char hash_char[2 * HASH_MAX_LEN + 1];
-	int digest_length = 64;
-
-	uimage_header_t image_header;
+	in_file_t *in = in_open(filename);
 	uint32_t fit_size;
 
-	sld_fd = open(filename, O_RDONLY | O_BINARY);
-	if (sld_fd < 0) {
-		fprintf(stderr, "%s: Can't open: %s\n",
-                            filename, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
-	if (read(sld_fd, (char *)&image_header, sizeof(uimage_header_t)) != sizeof(uimage_header_t)) {
-		fprintf (stderr, "generate_ivt_for_fit read failed: %s\n",
-			strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-
-	if (be32_to_cpu(image_header.ih_magic) != FDT_MAGIC){
+	if (in->sbuf.st_size < sizeof(uimage_header_t) ||
+	    fdt_magic(in->data) != FDT_MAGIC) {
 		fprintf (stderr, "generate_ivt_for_fit error: not a FIT file\n");
 		exit (EXIT_FAILURE);
 	}
 
-	fit_size = fdt_totalsize(&image_header);
+	fit_size = fdt_totalsize(in->data);
 
 	fprintf(stderr, "fit_size: %u\n", fit_size);
 
-	sprintf(sha_command, "dd if=\'%s\' of=tmp_pad bs=%d count=1;\
-				%s tmp_pad; rm -f tmp_pad;",
-			filename, fit_size, digest_type);
-
-	memset(hash, 0, HASH_MAX_LEN);
-
-	fp = popen(sha_command, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "Failed to run command hash\n" );
-		exit(EXIT_FAILURE);
-	}
-
-	if(fgets(hash_char, digest_length + 1, fp) == NULL) {
+	if (fit_size > in->sbuf.st_size) {
 		fprintf(stderr, "Failed to hash file: %s\n", filename);
 		exit(EXIT_FAILURE);
 	}
 
-	for(int i = 0; i < strlen(hash_char)/2; i++){
-		sscanf(hash_char + 2*i, "%02hhx", &hash[i]);
-	}
-
-	pclose(fp);
-	(void) close (sld_fd);
+	stats_begin(STATS_HASH, filename);
+	hash_buffer(HASH_ALGO_SHA256, in->data, fit_size, fit_size, hash);
+	stats_add(STATS_BYTES_READ, fit_size);
+	stats_add(STATS_BYTES_HASHED, fit_size);
+	stats_end(STATS_HASH);
 }
 
 void dump_fit_hash(uint8_t *hash, int size)
@@ -957,47 +511,25 @@ void dump_fit_hash(uint8_t *hash, int size)
 	fprintf(stderr, "\n");
 }
 
-/* Return this IVT offset in the final output file */
-int generate_ivt_for_fit(int fd, int fit_offset, uint32_t ep, uint32_t *fit_load_addr)
+/* Return this IVT offset in the final output file, fit is what was copied at fit_offset */
+int generate_ivt_for_fit(output_t *out, in_file_t *fit, int fit_offset, uint32_t ep, uint32_t *fit_load_addr)
 {
-	uimage_header_t image_header;
-
 	uint32_t fit_size, load_addr;
 	int align_len = 64 - 1; /* 64 is cacheline size */
-	int ret;
-
-	ret = lseek(fd, fit_offset, SEEK_SET);
-	if (ret < 0) {
-		fprintf(stderr, "%s: lseek error %s\n",
-				__func__, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
-	if (read(fd, (char *)&image_header, sizeof(uimage_header_t)) != sizeof(uimage_header_t)) {
-		fprintf (stderr, "generate_ivt_for_fit read failed: %s\n",
-			strerror(errno));
-		exit (EXIT_FAILURE);
-	}
 
-	if (be32_to_cpu(image_header.ih_magic) != FDT_MAGIC){
+	if (fit->sbuf.st_size < sizeof(uimage_header_t) ||
+	    fdt_magic(fit->data) != FDT_MAGIC) {
 		fprintf (stderr, "generate_ivt_for_fit error: not a FIT file\n");
 		exit (EXIT_FAILURE);
 	}
 
-	fit_size = fdt_totalsize(&image_header);
+	fit_size = fdt_totalsize(fit->data);
 	fit_size = (fit_size + 3) & ~3;
 
 #define ALIGN_SIZE		0x1000
 
 	fit_size = ALIGN(fit_size, ALIGN_SIZE);
 
-	ret = lseek(fd, fit_offset + fit_size, SEEK_SET);
-	if (ret < 0) {
-		fprintf(stderr, "%s: lseek error %s\n",
-				__func__, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
 	/* ep is the u-boot entry. SPL loads the FIT before the u-boot address. 0x2000 is for CSF_SIZE */
 	load_addr = (ep - (fit_size + 2 * CSF_SIZE) - 512 -
 			align_len) & ~align_len;
@@ -1008,17 +540,7 @@ int generate_ivt_for_fit(int fd, int fit_offset, uint32_t ep, uint32_t *fit_load
 		(load_addr + fit_size + 0x20),
 		0 };
 
-	if (write(fd, &ivt_header, sizeof(flash_header_v2_t)) != sizeof(flash_header_v2_t)) {
-		fprintf(stderr, "IVT writing error on fit image\n");
-		exit(EXIT_FAILURE);
-	}
-
-	ret = lseek(fd, fit_offset + fit_size + CSF_SIZE, SEEK_SET);
-	if (ret < 0) {
-		fprintf(stderr, "%s: lseek error %s\n",
-				__func__, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	output_write(out, fit_offset + fit_size, &ivt_header, sizeof(flash_header_v2_t));
 
 	flash_header_v2_t fdt_ivt_header = { { 0xd1, 0x2000, 0x40 },
 		load_addr, 0, 0, 0,
@@ -1026,10 +548,7 @@ int generate_ivt_for_fit(int fd, int fit_offset, uint32_t ep, uint32_t *fit_load
 		(load_addr + fit_size + CSF_SIZE + 0x20),
 		0 };
 
-	if (write(fd, &fdt_ivt_header, sizeof(flash_header_v2_t)) != sizeof(flash_header_v2_t)) {
-		fprintf(stderr, "FIT FDT IVT writing error on fit image\n");
-		exit(EXIT_FAILURE);
-	}
+	output_write(out, fit_offset + fit_size + CSF_SIZE, &fdt_ivt_header, sizeof(flash_header_v2_t));
 
 	*fit_load_addr = load_addr;
 
@@ -1037,9 +556,511 @@ int generate_ivt_for_fit(int fd, int fit_offset, uint32_t ep, uint32_t *fit_load
 
 }
 
+/*
+ * FIT (.itb) writer for the ATF/TEE/U-Boot/DTB bundle loaded by SPL. It
+ * builds the same tree mkimage_fit_atf.sh + 'mkimage -E -p' used to, with
+ * the image data stored after the FDT (external data).
+ */
+#define FDT_BEGIN_NODE		0x1
+#define FDT_END_NODE		0x2
+#define FDT_PROP		0x3
+#define FDT_NOP			0x4
+#define FDT_END			0x9
+#define FDT_RSVMAP_SIZE		16	/* only the terminating entry */
+#define FIT_MAX_IMAGES		16
+#define FIT_DATA_ALIGN		4
+
+typedef struct {
+	char *node;		/* node name in /images */
+	char *desc;
+	char *type;
+	char *filename;
+	uint8_t *data;		/* set for payloads built in memory */
+	uint32_t size;
+	uint32_t load;
+	uint32_t entry;
+	bool has_load;
+	bool has_entry;
+	bool is_fdt;
+	uint32_t position;	/* data position in the .itb */
+} fit_image_t;
+
+static fit_image_t fit_images[FIT_MAX_IMAGES];
+static int fit_image_count;
+
+typedef struct {
+	uint8_t *buf;
+	uint32_t len;
+} fdt_blob_t;
+
+static fdt_blob_t fdt_struct, fdt_strings;
+
+static void fdt_append(fdt_blob_t *b, const void *data, uint32_t len)
+{
+	uint32_t padded = ALIGN(len, 4);
+
+	b->buf = realloc(b->buf, b->len + padded);
+	if (!b->buf) {
+		fprintf(stderr, "FIT: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(b->buf + b->len, data, len);
+	memset(b->buf + b->len + len, 0, padded - len);
+	b->len += padded;
+}
+
+static void fdt_token(uint32_t token)
+{
+	uint32_t v = cpu_to_be32(token);
+
+	fdt_append(&fdt_struct, &v, sizeof(v));
+}
+
+static uint32_t fdt_string_offset(const char *name)
+{
+	uint32_t off = 0, len = strlen(name) + 1;
+
+	while (off < fdt_strings.len) {
+		if (!strcmp((char *)fdt_strings.buf + off, name))
+			return off;
+		off += strlen((char *)fdt_strings.buf + off) + 1;
+	}
+
+	/* The strings block is not padded, grow it by hand */
+	fdt_strings.buf = realloc(fdt_strings.buf, fdt_strings.len + len);
+	if (!fdt_strings.buf) {
+		fprintf(stderr, "FIT: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(fdt_strings.buf + fdt_strings.len, name, len);
+	fdt_strings.len += len;
+
+	return off;
+}
+
+static void fdt_begin_node(const char *name)
+{
+	fdt_token(FDT_BEGIN_NODE);
+	fdt_append(&fdt_struct, name, strlen(name) + 1);
+}
+
+static void fdt_prop(const char *name, const void *val, uint32_t len)
+{
+	uint32_t hdr[3] = {
+		cpu_to_be32(FDT_PROP),
+		cpu_to_be32(len),
+		cpu_to_be32(fdt_string_offset(name)),
+	};
+
+	fdt_append(&fdt_struct, hdr, sizeof(hdr));
+	if (len)
+		fdt_append(&fdt_struct, val, len);
+}
+
+static void fdt_prop_str(const char *name, const char *val)
+{
+	fdt_prop(name, val, strlen(val) + 1);
+}
+
+static void fdt_prop_u32(const char *name, uint32_t val)
+{
+	val = cpu_to_be32(val);
+	fdt_prop(name, &val, sizeof(val));
+}
+
+static fit_image_t *fit_add_image(char *node, char *desc, char *type, char *filename)
+{
+	fit_image_t *img;
+
+	if (fit_image_count >= FIT_MAX_IMAGES) {
+		fprintf(stderr, "FIT: too many images (max %d)\n", FIT_MAX_IMAGES);
+		exit(EXIT_FAILURE);
+	}
+
+	img = &fit_images[fit_image_count++];
+	memset(img, 0, sizeof(*img));
+	img->node = node;
+	img->desc = desc;
+	img->type = type;
+	img->filename = filename;
+
+	return img;
+}
+
+/* Order of the nodes in /images, which is also the data order */
+static int fit_image_rank(const fit_image_t *img)
+{
+	if (img->is_fdt)
+		return 1;
+	if (!strcmp(img->node, "uboot-1"))
+		return 0;
+	if (!strcmp(img->node, "atf-1"))
+		return 2;
+	if (!strcmp(img->node, "tee-1"))
+		return 3;
+	return 4;
+}
+
+static void fit_sort_images(void)
+{
+	for (int i = 1; i < fit_image_count; i++) {
+		fit_image_t tmp = fit_images[i];
+		int j = i;
+
+		while (j > 0 && fit_image_rank(&fit_images[j - 1]) > fit_image_rank(&tmp)) {
+			fit_images[j] = fit_images[j - 1];
+			j--;
+		}
+		fit_images[j] = tmp;
+	}
+}
+
+static fit_image_t *fit_find_image(const char *node)
+{
+	for (int i = 0; i < fit_image_count; i++) {
+		if (!strcmp(fit_images[i].node, node))
+			return &fit_images[i];
+	}
+
+	return NULL;
+}
+
+/* dtb description is its file name without directory and .dtb suffix */
+static char *fit_fdt_desc(const char *filename)
+{
+	const char *base = strrchr(filename, '/');
+	char *desc, *ext;
+
+	desc = strdup(base ? base + 1 : filename);
+	ext = strstr(desc, ".dtb");
+	if (ext && !ext[4])
+		*ext = '\0';
+
+	return desc;
+}
+
+static void fit_add_fdt(char *filename)
+{
+	char *node = malloc(16);
+	int cnt = 1;
+
+	for (int i = 0; i < fit_image_count; i++)
+		cnt += fit_images[i].is_fdt;
+
+	sprintf(node, "fdt-%d", cnt);
+	fit_add_image(node, fit_fdt_desc(filename), "flat_dt", filename)->is_fdt = true;
+}
+
+/* compress=lz4hc: store the payload as an LZ4 frame padded to 16 bytes */
+static void fit_compress_image(fit_image_t *img, const char *method)
+{
+	in_file_t *in;
+	size_t size;
+
+	if (strcmp(method, "lz4hc") && strcmp(method, "lz4")) {
+		fprintf(stderr, "%s: unsupported compression '%s'\n", img->filename, method);
+		exit(EXIT_FAILURE);
+	}
+
+	in = in_open(img->filename);
+
+	trace_begin("lz4", "compress", img->filename);
+	img->data = lz4_compress_frame(in->data, in->sbuf.st_size, &size);
+	trace_end();
+	img->size = ALIGN(size, 16);
+	img->data = realloc(img->data, img->size);
+	memset(img->data + size, 0, img->size - size);
+
+	fprintf(stderr, "\tlz4: 0x%lx -> 0x%x bytes\n", (long)in->sbuf.st_size, img->size);
+}
+
+static void fit_image_node(fit_image_t *img, uint32_t data_pos)
+{
+	fdt_begin_node(img->node);
+	fdt_prop_str("description", img->desc);
+	fdt_prop_str("type", img->type);
+	if (!img->is_fdt && strcmp(img->type, "script"))
+		fdt_prop_str("arch", "arm64");
+	fdt_prop_str("compression", "none");
+	if (img->has_load)
+		fdt_prop_u32("load", img->load);
+	if (img->has_entry)
+		fdt_prop_u32("entry", img->entry);
+	if (data_pos)
+		fdt_prop_u32("data-position", img->position);
+	else
+		fdt_prop_u32("data-offset", img->position);
+	fdt_prop_u32("data-size", img->size);
+	fdt_token(FDT_END_NODE);
+}
+
+/*
+ * Write the FIT to ofname. With a non zero data_pos the image data starts at
+ * that absolute file offset (mkimage -E -p), otherwise right after the FDT.
+ * Returns the FDT size, which is what generate_ivt_for_fit() pads from.
+ */
+static uint32_t fit_write(char *ofname, uint32_t data_pos, char *rbindex)
+{
+	struct fdt_header hdr;
+	uint8_t rsvmap[FDT_RSVMAP_SIZE] = { 0 };
+	uint32_t buf_ptr = 0, fdt_size, data_start, written;
+	char loadables[64] = "";
+	int loadables_len = 0;
+	output_t *out;
+	fit_image_t *uboot = fit_find_image("uboot-1");
+	const char *order[] = { "dek_blob-1", "atf-1", "tee-1" };
+	const char *epoch = getenv("SOURCE_DATE_EPOCH");
+
+	if (!uboot || !fit_find_image("atf-1")) {
+		fprintf(stderr, "FIT: -fit_uboot and -fit_atf are mandatory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	stats_begin(STATS_FLATTEN, NULL);
+
+	/* Data layout, in /images order like mkimage -E */
+	fit_sort_images();
+	for (int i = 0; i < fit_image_count; i++) {
+		fit_image_t *img = &fit_images[i];
+
+		if (!img->data)
+			img->size = in_open(img->filename)->sbuf.st_size;
+		img->position = data_pos + buf_ptr;
+		buf_ptr += ALIGN(img->size, FIT_DATA_ALIGN);
+	}
+
+	for (int i = 0; i < 3; i++) {
+		if (!fit_find_image(order[i]))
+			continue;
+		strcpy(loadables + loadables_len, order[i]);
+		loadables_len += strlen(order[i]) + 1;
+	}
+
+	fdt_begin_node("");
+	fdt_prop_str("description", "Configuration to load ATF before U-Boot");
+	fdt_prop_u32("#address-cells", 1);
+	fdt_prop_u32("timestamp", epoch ? strtoul(epoch, NULL, 0) : time(NULL));
+
+	fdt_begin_node("images");
+	for (int i = 0; i < fit_image_count; i++)
+		fit_image_node(&fit_images[i], data_pos);
+	fdt_token(FDT_END_NODE);
+
+	fdt_begin_node("configurations");
+	fdt_prop_str("default", "config-1");
+	for (int i = 0; i < fit_image_count; i++) {
+		fit_image_t *img = &fit_images[i];
+		char name[16];
+
+		if (!img->is_fdt)
+			continue;
+		sprintf(name, "config-%s", img->node + 4);
+		fdt_begin_node(name);
+		fdt_prop_str("description", img->desc);
+		fdt_prop_str("firmware", "uboot-1");
+		fdt_prop("loadables", loadables, loadables_len);
+		fdt_prop_str("fdt", img->node);
+		if (rbindex && fit_find_image("tee-1"))
+			fdt_prop_str("rbindex", rbindex);
+		fdt_token(FDT_END_NODE);
+	}
+	fdt_token(FDT_END_NODE);
+
+	fdt_token(FDT_END_NODE);
+	fdt_token(FDT_END);
+
+	fdt_size = sizeof(hdr) + FDT_RSVMAP_SIZE + fdt_struct.len + fdt_strings.len;
+	fdt_size = ALIGN(fdt_size, FIT_DATA_ALIGN);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = cpu_to_be32(FDT_MAGIC);
+	hdr.totalsize = cpu_to_be32(fdt_size);
+	hdr.off_mem_rsvmap = cpu_to_be32(sizeof(hdr));
+	hdr.off_dt_struct = cpu_to_be32(sizeof(hdr) + FDT_RSVMAP_SIZE);
+	hdr.off_dt_strings = cpu_to_be32(sizeof(hdr) + FDT_RSVMAP_SIZE + fdt_struct.len);
+	hdr.version = cpu_to_be32(17);
+	hdr.last_comp_version = cpu_to_be32(16);
+	hdr.size_dt_strings = cpu_to_be32(fdt_strings.len);
+	hdr.size_dt_struct = cpu_to_be32(fdt_struct.len);
+
+	if (data_pos) {
+		if (data_pos < fdt_size) {
+			fprintf(stderr, "FIT: data position 0x%x overlaps FIT length 0x%x\n",
+				data_pos, fdt_size);
+			exit(EXIT_FAILURE);
+		}
+		data_start = data_pos;
+	} else {
+		data_start = fdt_size;
+		for (int i = 0; i < fit_image_count; i++)
+			fit_images[i].position += fdt_size;
+	}
+
+	out = output_open(ofname);
+
+	written = 0;
+	output_write(out, written, &hdr, sizeof(hdr));
+	written += sizeof(hdr);
+	output_write(out, written, rsvmap, sizeof(rsvmap));
+	written += sizeof(rsvmap);
+	output_write(out, written, fdt_struct.buf, fdt_struct.len);
+	written += fdt_struct.len;
+	output_write(out, written, fdt_strings.buf, fdt_strings.len);
+	written += fdt_strings.len;
+	stats_end(STATS_FLATTEN);
+	fill_zero(out, data_start - written, written);
+
+	fprintf(stderr, "FIT IMAGE:\t%s\n", ofname);
+	fprintf(stderr, " fit_size \t\t0x%x\n", fdt_size);
+	for (int i = 0; i < fit_image_count; i++) {
+		fit_image_t *img = &fit_images[i];
+
+		if (img->data) {
+			uint32_t pad = ALIGN(img->size, FIT_DATA_ALIGN) - img->size;
+
+			output_write(out, img->position, img->data, img->size);
+			if (pad)
+				fill_zero(out, pad, img->position + img->size);
+		} else {
+			copy_file(out, img->filename, 1, img->position, 0);
+		}
+
+		fprintf(stderr, " %-12s\t\t0x%x 0x%x %s\n", img->node,
+			img->position, img->size, img->filename);
+	}
+
+	output_close(out);
+	free(fdt_struct.buf);
+	free(fdt_strings.buf);
+
+	return fdt_size;
+}
+
+/* Collect the /images sub-nodes of the FIT at fdt, with their data layout */
+static int fit_parse_images(const uint8_t *fdt, fit_image_t *imgs, int max)
+{
+	const uint8_t *p = fdt + fdt_off_dt_struct(fdt);
+	const char *strings = (const char *)fdt + fdt_off_dt_strings(fdt);
+	uint32_t data_base = ALIGN(fdt_totalsize(fdt), FIT_DATA_ALIGN);
+	int depth = 0, count = 0;
+	bool in_images = false;
+	fit_image_t *img = NULL;
+
+	for (;;) {
+		uint32_t token = be32_to_cpu(*(const uint32_t *)p);
+		const char *name;
+		uint32_t len, val;
+
+		p += 4;
+		switch (token) {
+		case FDT_BEGIN_NODE:
+			name = (const char *)p;
+			p += ALIGN(strlen(name) + 1, 4);
+			depth++;
+			if (depth == 2)
+				in_images = !strcmp(name, "images");
+			if (depth == 3 && in_images) {
+				if (count >= max) {
+					fprintf(stderr, "FIT: too many images (max %d)\n", max);
+					exit(EXIT_FAILURE);
+				}
+				img = &imgs[count++];
+				memset(img, 0, sizeof(*img));
+				img->node = strdup(name);
+			}
+			break;
+		case FDT_END_NODE:
+			if (depth == 3)
+				img = NULL;
+			depth--;
+			break;
+		case FDT_PROP:
+			len = be32_to_cpu(*(const uint32_t *)p);
+			name = strings + be32_to_cpu(*(const uint32_t *)(p + 4));
+			val = len >= 4 ? be32_to_cpu(*(const uint32_t *)(p + 8)) : 0;
+			p += 8 + ALIGN(len, 4);
+			if (!img)
+				break;
+			if (!strcmp(name, "load")) {
+				img->load = val;
+				img->has_load = true;
+			} else if (!strcmp(name, "entry")) {
+				img->entry = val;
+				img->has_entry = true;
+			} else if (!strcmp(name, "data-size")) {
+				img->size = val;
+			} else if (!strcmp(name, "data-position")) {
+				img->position = val;
+			} else if (!strcmp(name, "data-offset")) {
+				img->position = data_base + val;
+			} else if (!strcmp(name, "type")) {
+				img->is_fdt = !strcmp((const char *)p - ALIGN(len, 4), "flat_dt");
+			}
+			break;
+		case FDT_NOP:
+			break;
+		case FDT_END:
+			return count;
+		default:
+			fprintf(stderr, "FIT: bad structure token 0x%x\n", token);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+ * Print the HAB blocks (load address, offset, length) of every sub-image of
+ * the FIT found at file_off in filename. sign_base is the offset of the FIT
+ * in the boot image as seen by CST. SPL loads the dtbs right after U-Boot,
+ * so a dtb without a load address gets the end of the previous image.
+ */
+static void fit_print_hab(FILE *out, const char *filename, uint32_t file_off,
+			  uint32_t sign_base, bool json)
+{
+	fit_image_t imgs[FIT_MAX_IMAGES];
+	in_file_t *in = in_open(filename);
+	const uint8_t *fdt = in->data + file_off;
+	uint32_t next_load = 0;
+	int count;
+
+	if (in->sbuf.st_size < file_off + sizeof(struct fdt_header) ||
+	    fdt_magic(fdt) != FDT_MAGIC) {
+		fprintf(stderr, "%s: no FIT at offset 0x%x\n", filename, file_off);
+		exit(EXIT_FAILURE);
+	}
+
+	if (in->sbuf.st_size < file_off + fdt_totalsize(fdt)) {
+		fprintf(stderr, "%s: Can't read FIT: truncated\n", filename);
+		exit(EXIT_FAILURE);
+	}
+
+	count = fit_parse_images(fdt, imgs, FIT_MAX_IMAGES);
+
+	if (json)
+		fprintf(out, "[\n");
+	for (int i = 0; i < count; i++) {
+		fit_image_t *img = &imgs[i];
+		uint32_t load = img->has_load ? img->load : next_load;
+
+		next_load = load + img->size;
+
+		if (json)
+			fprintf(out, "  { \"image\": \"%s\", \"load\": \"0x%X\", \"offset\": \"0x%X\", \"size\": \"0x%X\" }%s\n",
+				img->node, load, sign_base + img->position, img->size,
+				i + 1 < count ? "," : "");
+		else
+			fprintf(out, "0x%X 0x%X 0x%X\n",
+				load, sign_base + img->position, img->size);
+		free(img->node);
+	}
+	if (json)
+		fprintf(out, "]\n");
+}
+
 int main(int argc, char **argv)
 {
-	int c, file_off, plugin_fd = -1, hdmi_fd = -1, ap_fd = -1, csf_hdmi_fd = -1, csf_fd = -1, ofd = -1, csf_plugin_fd = -1, sld_fd = -1;
+	int c, file_off;
+	output_t *out;
 	unsigned int dcd_size = 0, plugin_start_addr = 0, ap_start_addr = 0, sld_start_addr = 0, sld_src_off = 0, sld_csf_off = 0, sld_load_addr = 0;
 	char *ofname = NULL, *hdmi_img = NULL, *dcd_img = NULL, *plugin_img = NULL, *ap_img = NULL, *csf_img = NULL, *csf_plugin_img = NULL, *csf_hdmi_img = NULL, *sld_img = NULL;
 	char *signed_hdmi = NULL;
@@ -1050,7 +1071,8 @@ int main(int argc, char **argv)
 	struct stat sbuf;
 	uint32_t plugin_off = 0, hdmi_off = 0, image_off = 0, csf_plugin_off = 0, csf_hdmi_off = 0, csf_off = 0;
 	uint32_t header_hdmi_off = 0, header_hdmi_2_off = 0, header_plugin_off = 0, header_image_off = 0, dcd_off = 0;
-	uint32_t sld_header_off = 0;
+	uint32_t sld_header_off = 0, sld_crc;
+	off_t ap_size;
 	int using_fit = 0;
 	int gen_fit_ivt = 0;
 	dcd_v2_t dcd_table;
@@ -1058,11 +1080,20 @@ int main(int argc, char **argv)
 	uint32_t version = ROM_V1;
 
 	uint8_t fit_hash[HASH_MAX_LEN];
+	char *fit_gen = NULL, *fit_rbindex = NULL;
+	uint32_t fit_data_pos = 0;
+	fit_image_t *fit_img;
+	char *fit_hab_img = NULL;
+	uint32_t fit_hab_off = 0, sld_fit_off = 0;
+	bool hab_json = false;
+	bool dcd_opt = false;
 
 	static struct option long_options[] =
 	{
 		{"loader", required_argument, NULL, 'i'},
 		{"dcd", required_argument, NULL, 'd'},
+		{"dcd_opt", no_argument, NULL, 'D'},
+		{"dcd_cache", required_argument, NULL, 'K'},
 		{"fit", no_argument, NULL, 'f'},
 		{"out", required_argument, NULL, 'o'},
 		{"plugin", required_argument, NULL, 'p'},
@@ -1075,6 +1106,18 @@ int main(int argc, char **argv)
 		{"second_loader", required_argument, NULL, 'u'},
 		{"version", required_argument, NULL, 'v'},
 		{"fit_ivt", required_argument, NULL, 't'},
+		{"fit_gen", required_argument, NULL, 'g'},
+		{"fit_uboot", required_argument, NULL, 'U'},
+		{"fit_atf", required_argument, NULL, 'a'},
+		{"fit_tee", required_argument, NULL, 'T'},
+		{"fit_dek", required_argument, NULL, 'k'},
+		{"fit_fdt", required_argument, NULL, 'F'},
+		{"fit_rbindex", required_argument, NULL, 'r'},
+		{"fit_data_pos", required_argument, NULL, 'P'},
+		{"print_fit_hab", required_argument, NULL, 'H'},
+		{"hab_json", no_argument, NULL, 'j'},
+		{"stats", optional_argument, NULL, 'Q'},
+		{"trace", required_argument, NULL, 'Z'},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -1082,6 +1125,8 @@ int main(int argc, char **argv)
 
 	fprintf(stderr, "Platform:\ti.MX8M (mScale)\n");
 
+	stats_begin(STATS_ARGS, NULL);
+
 	while(1)
     	{
 		/* getopt_long stores the option index here. */
@@ -1106,6 +1151,13 @@ int main(int argc, char **argv)
 				fprintf(stderr, "DCD:\t%s\n", optarg);
 				dcd_img = optarg;
 				break;
+			case 'D':
+				dcd_opt = true;
+				break;
+			case 'K':
+				fprintf(stderr, "DCD CACHE:\t%s\n", optarg);
+				dcd_set_cache_dir(optarg);
+				break;
 			case 'f':
 				fprintf(stderr, "Using FIT image\n");
 				using_fit = 1;
@@ -1213,6 +1265,70 @@ int main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 'g':
+				fprintf(stderr, "FIT OUTPUT:\t%s\n", optarg);
+				fit_gen = optarg;
+				break;
+			case 'U':
+			case 'a':
+			case 'T':
+			case 'k':
+				if (c == 'U')
+					fit_img = fit_add_image("uboot-1", "U-Boot (64-bit)", "standalone", optarg);
+				else if (c == 'a')
+					fit_img = fit_add_image("atf-1", "ARM Trusted Firmware", "firmware", optarg);
+				else if (c == 'T')
+					fit_img = fit_add_image("tee-1", "TEE firmware", "firmware", optarg);
+				else
+					fit_img = fit_add_image("dek_blob-1", "dek_blob", "script", optarg);
+				fprintf(stderr, "FIT %s:\t%s", fit_img->node, optarg);
+				if (optind < argc && *argv[optind] != '-') {
+					fit_img->load = (uint32_t) strtoll(argv[optind++], NULL, 0);
+					fit_img->has_load = true;
+					/* U-Boot is started by SPL as firmware, dek blob is not executed */
+					fit_img->has_entry = (c == 'a' || c == 'T');
+					fit_img->entry = fit_img->load;
+					fprintf(stderr, " load addr: 0x%08x\n", fit_img->load);
+				} else {
+					fprintf(stderr, "\n-%s option require TWO arguments: filename, load address in hex\n\n",
+						long_options[option_index].name);
+					exit(1);
+				}
+				if (c == 'T' && optind < argc && !strncmp(argv[optind], "compress=", 9))
+					fit_compress_image(fit_img, argv[optind++] + 9);
+				break;
+			case 'F':
+				fprintf(stderr, "FIT FDT:\t%s\n", optarg);
+				fit_add_fdt(optarg);
+				break;
+			case 'r':
+				fprintf(stderr, "FIT ROLLBACK INDEX:\t%s\n", optarg);
+				fit_rbindex = optarg;
+				break;
+			case 'P':
+				fit_data_pos = (uint32_t) strtoll(optarg, NULL, 0);
+				fprintf(stderr, "FIT DATA POSITION:\t0x%x\n", fit_data_pos);
+				break;
+			case 'H':
+				fprintf(stderr, "FIT HAB:\t%s", optarg);
+				fit_hab_img = optarg;
+				if (optind < argc && *argv[optind] != '-') {
+					fit_hab_off = (uint32_t) strtoll(argv[optind++], NULL, 0);
+					fprintf(stderr, " fit offset: 0x%x\n", fit_hab_off);
+				} else {
+					fprintf(stderr, "\n-print_fit_hab option require TWO arguments: filename, FIT offset in flash.bin\n\n");
+					exit(1);
+				}
+				break;
+			case 'j':
+				hab_json = true;
+				break;
+			case 'Q':
+				stats_enable(optarg);
+				break;
+			case 'Z':
+				trace_open(optarg);
+				break;
 			case ':':
 				fprintf(stderr, "option %c missing arguments\n", optopt);
 				break;
@@ -1225,21 +1341,36 @@ int main(int argc, char **argv)
 		}
 	}
 
+	stats_end(STATS_ARGS);
+	stats_begin(STATS_LAYOUT, NULL);
+	stats_output(ofname ? ofname : fit_gen);
+
+	if (fit_gen) {
+		fit_write(fit_gen, fit_data_pos, fit_rbindex);
+
+		if (!ap_img && !gen_fit_ivt && !fit_hab_img)
+			exit(0);
+	}
+
+	if (fit_hab_img) {
+		uint32_t sign_off = fit_hab_off;
+
+		/* flash.bin is written at 0 for flexspi, at 32KB (+ IVT offset on V1) otherwise */
+		if (ivt_offset != IVT_OFFSET_FLEXSPI && fit_hab_off)
+			sign_off -= IMAGE_OFFSET_SD + (version == ROM_V1 ? IVT_OFFSET_SD : 0);
+
+		fit_print_hab(stdout, fit_hab_img, 0, sign_off, hab_json);
+		exit(0);
+	}
+
 	if (gen_fit_ivt) {
-		/* Open output file */
-		ofd = open (ofname, O_RDWR|O_CREAT|O_TRUNC|O_BINARY, 0666);
-		if (ofd < 0) {
-			fprintf(stderr, "%s: Can't open: %s\n",
-	                                ofname, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
+		out = output_open(ofname);
 
 		/* Write image header */
-		copy_file(ofd, sld_img, 0, sld_src_off, 0);
-		sld_csf_off = generate_ivt_for_fit(ofd, sld_src_off, sld_start_addr, &sld_load_addr) + 0x20;
+		copy_file(out, sld_img, 0, sld_src_off, 0);
+		sld_csf_off = generate_ivt_for_fit(out, in_open(sld_img), sld_src_off, sld_start_addr, &sld_load_addr) + 0x20;
 
-		/* Close output file */
-		close(ofd);
+		output_close(out);
 
 		fprintf(stderr, "\nFIT IVT IMAGE:\n");
 		fprintf(stderr, " fit_csf_off \t\t0x%x\n",
@@ -1268,11 +1399,9 @@ int main(int argc, char **argv)
 	}
 
 	if (sld_img && using_fit) {
+		/* Written after ap_img in the output, the input is left alone */
 		calc_fitimage_hash(sld_img, fit_hash);
 
-		/* Append hash to ap_img */
-		append_data(ap_img, fit_hash, HASH_MAX_LEN);
-
 		dump_fit_hash(fit_hash, HASH_MAX_LEN);
 	}
 
@@ -1296,19 +1425,7 @@ int main(int argc, char **argv)
 	if (signed_hdmi) {
 		header_hdmi_off = file_off + ivt_offset;
 
-		hdmi_fd = open(signed_hdmi, O_RDONLY | O_BINARY);
-		if (hdmi_fd < 0) {
-			fprintf(stderr, "%s: Can't open: %s\n",
-                                signed_hdmi, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-
-		if (fstat(hdmi_fd, &sbuf) < 0) {
-			fprintf(stderr, "%s: Can't stat: %s\n",
-				signed_hdmi, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		close(hdmi_fd);
+		sbuf = in_open(signed_hdmi)->sbuf;
 
 		/* Aligned to 104KB = 92KB FW image + 0x8000 (IVT and alignment) + 0x4000 (second IVT + CSF)*/
 		file_off += ALIGN(sbuf.st_size, HDMI_FW_SIZE + 0x2000 + 0x1000);
@@ -1322,19 +1439,7 @@ int main(int argc, char **argv)
 		file_off += ALIGN(sizeof(imx_header_v2_t) + ivt_offset, 0x2000); /* Aligned to 8KB */
 
 
-		hdmi_fd = open(hdmi_img, O_RDONLY | O_BINARY);
-		if (hdmi_fd < 0) {
-			fprintf(stderr, "%s: Can't open: %s\n",
-                                hdmi_img, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-
-		if (fstat(hdmi_fd, &sbuf) < 0) {
-			fprintf(stderr, "%s: Can't stat: %s\n",
-				hdmi_img, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		close(hdmi_fd);
+		sbuf = in_open(hdmi_img)->sbuf;
 
 		if (sbuf.st_size > HDMI_FW_SIZE) {
 			fprintf(stderr, "%s: size is too large:%ld\n",
@@ -1374,19 +1479,7 @@ int main(int argc, char **argv)
 
 		if (csf_hdmi_img) {
 
-			csf_hdmi_fd = open(csf_hdmi_img, O_RDONLY | O_BINARY);
-			if (csf_hdmi_fd < 0) {
-				fprintf(stderr, "%s: Can't open: %s\n",
-	                                csf_hdmi_img, strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-
-			if (fstat(csf_hdmi_fd, &sbuf) < 0) {
-				fprintf(stderr, "%s: Can't stat: %s\n",
-					csf_hdmi_img, strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-			close(csf_hdmi_fd);
+			sbuf = in_open(csf_hdmi_img)->sbuf;
 		}
 		imx_header[HDMI_IVT_ID].fhdr.csf = imx_header[HDMI_IVT_ID].fhdr.self + ALIGN(sizeof(imx_header_v2_t), 64); /* The fhdr + boot_data is 48 bytes, we align to 64 */
 		csf_hdmi_off = header_hdmi_2_off + (imx_header[HDMI_IVT_ID].fhdr.csf - imx_header[HDMI_IVT_ID].fhdr.self);
@@ -1398,19 +1491,7 @@ int main(int argc, char **argv)
 	if(plugin_img) {
 		header_plugin_off = file_off + ivt_offset;
 
-		plugin_fd = open(plugin_img, O_RDONLY | O_BINARY);
-		if (plugin_fd < 0) {
-			fprintf(stderr, "%s: Can't open: %s\n",
-	                                plugin_img, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-
-		if (fstat(plugin_fd, &sbuf) < 0) {
-			fprintf(stderr, "%s: Can't stat: %s\n",
-					plugin_img, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		close(plugin_fd);
+		sbuf = in_open(plugin_img)->sbuf;
 
 		imx_header[PLUGIN_IVT_ID].fhdr.header.tag = IVT_HEADER_TAG; /* 0xD1 */
 		imx_header[PLUGIN_IVT_ID].fhdr.header.length = cpu_to_be16(sizeof(flash_header_v2_t));
@@ -1429,19 +1510,7 @@ int main(int argc, char **argv)
 		file_off += imx_header[PLUGIN_IVT_ID].boot_data.size;
 
 		if(csf_plugin_img) {
-			csf_plugin_fd = open(csf_plugin_img, O_RDONLY | O_BINARY);
-			if (csf_plugin_fd < 0) {
-				fprintf(stderr, "%s: Can't open: %s\n",
-		                                csf_plugin_img, strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-
-			if (fstat(csf_plugin_fd, &sbuf) < 0) {
-				fprintf(stderr, "%s: Can't stat: %s\n",
-						csf_plugin_img, strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-			close(csf_plugin_fd);
+			sbuf = in_open(csf_plugin_img)->sbuf;
 
 			imx_header[PLUGIN_IVT_ID].fhdr.csf = imx_header[PLUGIN_IVT_ID].boot_data.start + imx_header[PLUGIN_IVT_ID].boot_data.size;
 			imx_header[PLUGIN_IVT_ID].boot_data.size += ALIGN(sbuf.st_size, 64);
@@ -1462,7 +1531,10 @@ int main(int argc, char **argv)
 
 	/* First boot loader image */
 	if (dcd_img) {
-		dcd_size = parse_cfg_file(&dcd_table, dcd_img);
+		dcd_size = dcd_compile(dcd_img, DCD_VERSION, &dcd_table,
+				       sizeof(dcd_table), MAX_HW_CFG_SIZE_V2, NULL);
+		if (dcd_opt)
+			dcd_size = dcd_optimize(&dcd_table);
 		fprintf(stderr, "dcd size = %d\n", dcd_size);
 
 		if (ALIGN(dcd_size, 64) > (ROM_INITIAL_LOAD_SIZE - ivt_offset - sizeof(imx_header_v2_t))) {
@@ -1471,18 +1543,12 @@ int main(int argc, char **argv)
 		}
 	}
 
-	ap_fd = open(ap_img, O_RDONLY | O_BINARY);
-	if (ap_fd < 0) {
-		fprintf(stderr, "%s: Can't open: %s\n",
-                        	ap_img, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-	if (fstat(ap_fd, &sbuf) < 0) {
-		fprintf(stderr, "%s: Can't stat: %s\n",
-			ap_img, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-	close(ap_fd);
+	sbuf = in_open(ap_img)->sbuf;
+
+	/* The FIT hash trailer is part of the first loader image */
+	ap_size = sbuf.st_size;
+	if (sld_img && using_fit)
+		sbuf.st_size += HASH_MAX_LEN;
 
 	imx_header[IMAGE_IVT_ID].fhdr.header.tag = IVT_HEADER_TAG; /* 0xD1 */
 	imx_header[IMAGE_IVT_ID].fhdr.header.length = cpu_to_be16(sizeof(flash_header_v2_t));
@@ -1520,19 +1586,7 @@ int main(int argc, char **argv)
 	imx_header[IMAGE_IVT_ID].boot_data.plugin = 0;
 
 	if (csf_img) {
-		csf_fd = open(csf_img, O_RDONLY | O_BINARY);
-		if (csf_fd < 0) {
-			fprintf(stderr, "%s: Can't open: %s\n",
-                                csf_img, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-
-		if (fstat(csf_fd, &sbuf) < 0) {
-			fprintf(stderr, "%s: Can't stat: %s\n",
-				csf_img, strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		close(csf_fd);
+		sbuf = in_open(csf_img)->sbuf;
 
 		if (sbuf.st_size > CSF_DATA_SIZE) {
 			fprintf(stderr, "%s: file size %ld is larger than CSF_DATA_SIZE %d\n",
@@ -1572,27 +1626,13 @@ int main(int argc, char **argv)
 			 *  Because the 8K region is added, we has to modify the size field in uimage to add the alignment padding and 8K region. This size does NOT include
 			 *  the size of uimage header.
 			 */
-			generate_sld_with_ivt(sld_img, sld_start_addr, (char *)&sld_ivt_img);
+			sld_crc = generate_sld_with_ivt(sld_img, sld_start_addr, (char *)&sld_ivt_img);
 			sld_img = (char *)&sld_ivt_img; /* Change to the sld_ivt image */
 
 			sld_header_off = sld_src_off - rom_image_offset;
 
-			sld_fd = open(sld_img, O_RDONLY | O_BINARY);
-			if (sld_fd < 0) {
-				fprintf(stderr, "%s: Can't open: %s\n",
-	                                sld_img, strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-
-			if (fstat(sld_fd, &sbuf) < 0) {
-				fprintf(stderr, "%s: Can't stat: %s\n",
-					sld_img, strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-
-			set_uimage_header(&uimage_hdr, sld_fd, sld_start_addr);
-
-			close(sld_fd);
+			sbuf = in_open(sld_img)->sbuf;
+			set_uimage_header(&uimage_hdr, &sbuf, sld_start_addr, sld_crc);
 
 			file_off = sld_header_off;
 			file_off += sbuf.st_size + sizeof(uimage_header_t);
@@ -1601,20 +1641,7 @@ int main(int argc, char **argv)
 			file_off += CSF_SIZE - sizeof(flash_header_v2_t);
 		}else {
 			sld_header_off = sld_src_off - rom_image_offset;
-			sld_fd = open(sld_img, O_RDONLY | O_BINARY);
-			if (sld_fd < 0) {
-				fprintf(stderr, "%s: Can't open: %s\n",
-	                                sld_img, strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-
-			if (fstat(sld_fd, &sbuf) < 0) {
-				fprintf(stderr, "%s: Can't stat: %s\n",
-					sld_img, strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-
-			close(sld_fd);
+			sbuf = in_open(sld_img)->sbuf;
 
 			file_off = sld_header_off;
 			file_off += sbuf.st_size + sizeof(uimage_header_t);
@@ -1623,19 +1650,13 @@ int main(int argc, char **argv)
 
 
 	/* Open output file */
-	ofd = open (ofname, O_RDWR|O_CREAT|O_TRUNC|O_BINARY, 0666);
-	if (ofd < 0) {
-		fprintf(stderr, "%s: Can't open: %s\n",
-                                ofname, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	out = output_open(ofname);
 
 	if(signed_hdmi) {
 		header_hdmi_off -= ivt_offset;
-		lseek(ofd, header_hdmi_off, SEEK_SET);
 
 		/* The signed HDMI FW has 0x400 IVT offset, need remove it */
-		copy_file(ofd, signed_hdmi, 0, header_hdmi_off, 0x400);
+		copy_file(out, signed_hdmi, 0, header_hdmi_off, 0x400);
 	}
 
 	if(!signed_hdmi && hdmi_img) {
@@ -1643,26 +1664,16 @@ int main(int argc, char **argv)
 		hdmi_off -= ivt_offset;
 		header_hdmi_2_off -= ivt_offset;
 
-		lseek(ofd, header_hdmi_off, SEEK_SET);
-
 		/* Write image header */
-		if (write(ofd, &imx_header[HDMI_IVT_ID], sizeof(imx_header_v2_t)) != sizeof(imx_header_v2_t)) {
-			fprintf(stderr, "error writing image hdr\n");
-			exit(1);
-		};
-
-		copy_file(ofd, hdmi_img, 0, hdmi_off, 0);
+		output_write(out, header_hdmi_off, &imx_header[HDMI_IVT_ID], sizeof(imx_header_v2_t));
 
-		lseek(ofd, header_hdmi_2_off, SEEK_SET);
+		copy_file(out, hdmi_img, 0, hdmi_off, 0);
 
-		if (write(ofd, &imx_header[HDMI_IVT_ID], sizeof(imx_header_v2_t)) != sizeof(imx_header_v2_t)) {
-			fprintf(stderr, "error writing image hdr\n");
-			exit(1);
-		}
+		output_write(out, header_hdmi_2_off, &imx_header[HDMI_IVT_ID], sizeof(imx_header_v2_t));
 
 		if (csf_hdmi_img) {
 			csf_hdmi_off -= ivt_offset;
-			copy_file(ofd, csf_hdmi_img, 0, csf_hdmi_off, 0);
+			copy_file(out, csf_hdmi_img, 0, csf_hdmi_off, 0);
 		}
 	}
 
@@ -1670,77 +1681,63 @@ int main(int argc, char **argv)
 		header_plugin_off -= ivt_offset;
 		plugin_off -= ivt_offset;
 
-		lseek(ofd, header_plugin_off, SEEK_SET);
-
 		/* Write image header */
-		if (write(ofd, &imx_header[PLUGIN_IVT_ID], sizeof(imx_header_v2_t)) != sizeof(imx_header_v2_t)) {
-			fprintf(stderr, "error writing image hdr\n");
-			exit(1);
-		}
+		output_write(out, header_plugin_off, &imx_header[PLUGIN_IVT_ID], sizeof(imx_header_v2_t));
 
-		copy_file(ofd, plugin_img, 0, plugin_off, 0);
+		copy_file(out, plugin_img, 0, plugin_off, 0);
 
 		if (csf_plugin_img) {
 			csf_plugin_off -= ivt_offset;
-			copy_file(ofd, csf_plugin_img, 0, csf_plugin_off, 0);
+			copy_file(out, csf_plugin_img, 0, csf_plugin_off, 0);
 		}
 	}
 
 	/* Main Image */
 	header_image_off -= ivt_offset;
 	image_off -= ivt_offset;
-	lseek(ofd, header_image_off, SEEK_SET);
 
 	/* Write image header */
-	if (write(ofd, &imx_header[IMAGE_IVT_ID], sizeof(imx_header_v2_t)) != sizeof(imx_header_v2_t)) {
-		fprintf(stderr, "error writing image hdr\n");
-		exit(1);
-	}
+	output_write(out, header_image_off, &imx_header[IMAGE_IVT_ID], sizeof(imx_header_v2_t));
 
 	if (dcd_size) {
 		dcd_off -= ivt_offset;
-		lseek(ofd, dcd_off, SEEK_SET);
-
-		if (write(ofd, &dcd_table, dcd_size) != dcd_size) {
-			fprintf(stderr, "error writing dcd\n");
-			exit(1);
-		}
+		output_write(out, dcd_off, &dcd_table, dcd_size);
 	}
 
-	copy_file(ofd, ap_img, 0, image_off, 0);
+	copy_file(out, ap_img, 0, image_off, 0);
+
+	if (sld_img && using_fit) {
+		output_write(out, image_off + ap_size, fit_hash, HASH_MAX_LEN);
+	}
 
 	if (csf_img) {
 		csf_off -= ivt_offset;
-		copy_file(ofd, csf_img, 0, csf_off, 0);
+		copy_file(out, csf_img, 0, csf_off, 0);
 	} else {
 		csf_off -= ivt_offset;
-		fill_zero(ofd, CSF_SIZE, csf_off);
+		fill_zero(out, CSF_SIZE, csf_off);
 	}
 
 	if (sld_img) {
 		sld_header_off -= ivt_offset;
-		lseek(ofd, sld_header_off, SEEK_SET);
 
-		/* Write image header */
 		if (!using_fit) {
 			/* Write image header */
-			if (write(ofd, &uimage_hdr, sizeof(uimage_header_t)) != sizeof(uimage_header_t)) {
-				fprintf(stderr, "error writing uimage hdr\n");
-				exit(1);
-			}
+			output_write(out, sld_header_off, &uimage_hdr, sizeof(uimage_header_t));
 
-			copy_file(ofd, sld_img, 0, sld_header_off + sizeof(uimage_header_t), 0);
-			fill_zero(ofd, CSF_SIZE - sizeof(flash_header_v2_t), sld_csf_off);
+			copy_file(out, sld_img, 0, sld_header_off + sizeof(uimage_header_t), 0);
+			fill_zero(out, CSF_SIZE - sizeof(flash_header_v2_t), sld_csf_off);
 			sld_csf_off -= ivt_offset;
 			sld_load_addr = sld_start_addr - (uint32_t)sizeof(uimage_header_t);
 		} else {
-			copy_file(ofd, sld_img, 0, sld_header_off, 0);
-			sld_csf_off = generate_ivt_for_fit(ofd, sld_header_off, sld_start_addr, &sld_load_addr) + 0x20;
+			copy_file(out, sld_img, 0, sld_header_off, 0);
+			sld_csf_off = generate_ivt_for_fit(out, in_open(sld_img), sld_header_off, sld_start_addr, &sld_load_addr) + 0x20;
+			sld_fit_off = sld_header_off;
 		}
 	}
 
 	/* Close output file */
-	close(ofd);
+	output_close(out);
 
 	if (!signed_hdmi)
 		dump_header_v2(imx_header, 0);
@@ -1809,6 +1806,12 @@ int main(int argc, char **argv)
 	fprintf(stderr, "\tBlocks = \t0x%x 0x%x 0x%x \"flash.bin\"\n",
 		sld_load_addr, sld_header_off, sld_csf_off + CSF_SIZE - sld_header_off);
 
+	if (sld_img && using_fit) {
+		fprintf(stderr, "SLD FIT images (load addr, offset, size):\n");
+		fit_print_hab(hab_json ? stdout : stderr, ofname, sld_fit_off,
+			      sld_header_off, hab_json);
+	}
+
 	return 0;
 }
 
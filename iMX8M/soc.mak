@@ -87,12 +87,20 @@ endif
 
 FIT_EXTERNAL_POSITION = 0x5000
 
+# Loadables of the u-boot*.itb FIT images, written by $(MKIMG) -fit_gen
+FIT_LOADABLES = -fit_data_pos $(FIT_EXTERNAL_POSITION) \
+		-fit_uboot u-boot-nodtb.bin 0x40200000 \
+		-fit_atf bl31.bin $(ATF_LOAD_ADDR) \
+		$(if $(wildcard $(TEE)),-fit_tee $(TEE) $(TEE_LOAD_ADDR) $(if $(TEE_COMPRESS_ENABLE),compress=lz4hc)) \
+		$(if $(wildcard dek_blob_fit_dummy.bin),-fit_dek dek_blob_fit_dummy.bin $(DEK_BLOB_LOAD_ADDR)) \
+		$(if $(ROLLBACK_INDEX_IN_FIT),-fit_rbindex $(ROLLBACK_INDEX_IN_FIT))
+
 FW_DIR = imx-boot/imx-boot-tools/$(PLAT)
 
-$(MKIMG): ../$(SOC_DIR)/mkimage_imx8.c
+$(MKIMG): ../$(SOC_DIR)/mkimage_imx8.c ../src/lz4.c ../src/crc32.c ../src/dcd.c ../src/hash.c ../src/stats.c ../src/trace.c ../src/output.c
 	@echo "PLAT="$(PLAT) "HDMI="$(HDMI)
 	@echo "Compiling mkimage_imx8"
-	$(CC) $(CFLAGS) ../$(SOC_DIR)/mkimage_imx8.c -o $(MKIMG) $(BUILD_LDFLAGS) -lz
+	$(CC) $(CFLAGS) ../$(SOC_DIR)/mkimage_imx8.c ../src/lz4.c ../src/crc32.c ../src/dcd.c ../src/hash.c ../src/stats.c ../src/trace.c ../src/output.c -I ../src -o $(MKIMG) $(BUILD_LDFLAGS) -lpthread
 
 lpddr4_imem_1d = lpddr4_pmu_train_1d_imem$(LPDDR_FW_VERSION).bin
 lpddr4_dmem_1d = lpddr4_pmu_train_1d_dmem$(LPDDR_FW_VERSION).bin
@@ -164,61 +172,56 @@ $(dtb):
 	@echo "DTB pre-processing complete."
 	@echo "=============================================="
 
-u-boot.itb: $(dtb) $(supp_dtbs)
+u-boot.itb: $(MKIMG) $(dtb) $(supp_dtbs)
 	./$(PAD_IMAGE) $(TEE)
 	./$(PAD_IMAGE) bl31.bin
 	./$(PAD_IMAGE) u-boot-nodtb.bin $(dtb) $(supp_dtbs)
-	BL32=$(TEE) DEK_BLOB_LOAD_ADDR=$(DEK_BLOB_LOAD_ADDR) TEE_LOAD_ADDR=$(TEE_LOAD_ADDR) ATF_LOAD_ADDR=$(ATF_LOAD_ADDR) ../$(SOC_DIR)/mkimage_fit_atf.sh $(dtb) $(supp_dtbs) > u-boot.its
-	./mkimage_uboot -E -p $(FIT_EXTERNAL_POSITION) -f u-boot.its u-boot.itb
-	@rm -f u-boot.its $(dtb)
+	./$(MKIMG) -fit_gen u-boot.itb $(FIT_LOADABLES) $(addprefix -fit_fdt ,$(dtb) $(supp_dtbs))
+	@rm -f $(dtb)
 
 dtb_ddr3l = valddr3l.dtb
 $(dtb_ddr3l):
 	./$(DTB_PREPROC) $(PLAT)-ddr3l-$(VAL_BOARD).dtb $(dtb_ddr3l) $(dtbs)
 
-u-boot-ddr3l.itb: $(dtb_ddr3l) $(supp_dtbs)
+u-boot-ddr3l.itb: $(MKIMG) $(dtb_ddr3l) $(supp_dtbs)
 	./$(PAD_IMAGE) $(TEE)
 	./$(PAD_IMAGE) bl31.bin
 	./$(PAD_IMAGE) u-boot-nodtb.bin $(dtb_ddr3l) $(supp_dtbs)
-	DEK_BLOB_LOAD_ADDR=$(DEK_BLOB_LOAD_ADDR) TEE_LOAD_ADDR=$(TEE_LOAD_ADDR) ATF_LOAD_ADDR=$(ATF_LOAD_ADDR) ../$(SOC_DIR)/mkimage_fit_atf.sh $(dtb_ddr3l) $(supp_dtbs) > u-boot-ddr3l.its
-	./mkimage_uboot -E -p $(FIT_EXTERNAL_POSITION) -f u-boot-ddr3l.its u-boot-ddr3l.itb
-	@rm -f u-boot.its $(dtb_ddr3l)
+	./$(MKIMG) -fit_gen u-boot-ddr3l.itb $(FIT_LOADABLES) $(addprefix -fit_fdt ,$(dtb_ddr3l) $(supp_dtbs))
+	@rm -f $(dtb_ddr3l)
 
 dtb_ddr3l_evk = evkddr3l.dtb
 $(dtb_ddr3l_evk):
 	./$(DTB_PREPROC) $(PLAT)-ddr3l-evk.dtb $(dtb_ddr3l_evk) $(dtbs)
 
-u-boot-ddr3l-evk.itb: $(dtb_ddr3l_evk) $(supp_dtbs)
+u-boot-ddr3l-evk.itb: $(MKIMG) $(dtb_ddr3l_evk) $(supp_dtbs)
 	./$(PAD_IMAGE) $(TEE)
 	./$(PAD_IMAGE) bl31.bin
 	./$(PAD_IMAGE) u-boot-nodtb.bin $(dtb_ddr3l_evk) $(supp_dtbs)
-	DEK_BLOB_LOAD_ADDR=$(DEK_BLOB_LOAD_ADDR) TEE_LOAD_ADDR=$(TEE_LOAD_ADDR) ATF_LOAD_ADDR=$(ATF_LOAD_ADDR) ../$(SOC_DIR)/mkimage_fit_atf.sh $(dtb_ddr3l_evk) $(supp_dtbs) > u-boot-ddr3l-evk.its
-	./mkimage_uboot -E -p $(FIT_EXTERNAL_POSITION) -f u-boot-ddr3l-evk.its u-boot-ddr3l-evk.itb
-	@rm -f u-boot.its $(dtb_ddr3l_evk)
+	./$(MKIMG) -fit_gen u-boot-ddr3l-evk.itb $(FIT_LOADABLES) $(addprefix -fit_fdt ,$(dtb_ddr3l_evk) $(supp_dtbs))
+	@rm -f $(dtb_ddr3l_evk)
 
 dtb_ddr4 = valddr4.dtb
 $(dtb_ddr4):
 	./$(DTB_PREPROC) $(PLAT)-ddr4-$(VAL_BOARD).dtb $(dtb_ddr4) $(dtbs)
 
-u-boot-ddr4.itb: $(dtb_ddr4) $(supp_dtbs)
+u-boot-ddr4.itb: $(MKIMG) $(dtb_ddr4) $(supp_dtbs)
 	./$(PAD_IMAGE) $(TEE)
 	./$(PAD_IMAGE) bl31.bin
 	./$(PAD_IMAGE) u-boot-nodtb.bin $(dtb_ddr4) $(supp_dtbs)
-	DEK_BLOB_LOAD_ADDR=$(DEK_BLOB_LOAD_ADDR) TEE_LOAD_ADDR=$(TEE_LOAD_ADDR) ATF_LOAD_ADDR=$(ATF_LOAD_ADDR) ../$(SOC_DIR)/mkimage_fit_atf.sh $(dtb_ddr4) $(supp_dtbs) > u-boot-ddr4.its
-	./mkimage_uboot -E -p $(FIT_EXTERNAL_POSITION) -f u-boot-ddr4.its u-boot-ddr4.itb
-	@rm -f u-boot.its $(dtb_ddr4)
+	./$(MKIMG) -fit_gen u-boot-ddr4.itb $(FIT_LOADABLES) $(addprefix -fit_fdt ,$(dtb_ddr4) $(supp_dtbs))
+	@rm -f $(dtb_ddr4)
 
 dtb_ddr4_evk = evkddr4.dtb
 $(dtb_ddr4_evk):
 	./$(DTB_PREPROC) $(PLAT)-ddr4-evk.dtb $(dtb_ddr4_evk) $(dtbs)
 
-u-boot-ddr4-evk.itb: $(dtb_ddr4_evk) $(supp_dtbs)
+u-boot-ddr4-evk.itb: $(MKIMG) $(dtb_ddr4_evk) $(supp_dtbs)
 	./$(PAD_IMAGE) $(TEE)
 	./$(PAD_IMAGE) bl31.bin
 	./$(PAD_IMAGE) u-boot-nodtb.bin $(dtb_ddr4_evk) $(supp_dtbs)
-	DEK_BLOB_LOAD_ADDR=$(DEK_BLOB_LOAD_ADDR) TEE_LOAD_ADDR=$(TEE_LOAD_ADDR) ATF_LOAD_ADDR=$(ATF_LOAD_ADDR) ../$(SOC_DIR)/mkimage_fit_atf.sh $(dtb_ddr4_evk) $(supp_dtbs) > u-boot-ddr4-evk.its
-	./mkimage_uboot -E -p $(FIT_EXTERNAL_POSITION) -f u-boot-ddr4-evk.its u-boot-ddr4-evk.itb
-	@rm -f u-boot.its $(dtb_ddr4_evk)
+	./$(MKIMG) -fit_gen u-boot-ddr4-evk.itb $(FIT_LOADABLES) $(addprefix -fit_fdt ,$(dtb_ddr4_evk) $(supp_dtbs))
+	@rm -f $(dtb_ddr4_evk)
 
 ifeq ($(HDMI),yes)
 flash_evk: $(MKIMG) signed_hdmi_imx8m.bin u-boot-spl-ddr.bin u-boot.itb
@@ -333,26 +336,14 @@ flash_dp_spl_uboot: flash_dp_evk
 
 flash_spl_uboot: flash_evk_no_hdmi
 
-print_fit_hab: u-boot-nodtb.bin bl31.bin $(dtb) $(supp_dtbs)
-	./$(PAD_IMAGE) $(TEE)
-	./$(PAD_IMAGE) bl31.bin
-	./$(PAD_IMAGE) u-boot-nodtb.bin $(dtb) $(supp_dtbs)
-	FIT_DATA_POS=$(FIT_EXTERNAL_POSITION) TEE_LOAD_ADDR=$(TEE_LOAD_ADDR) ATF_LOAD_ADDR=$(ATF_LOAD_ADDR) VERSION=$(VERSION) ../$(SOC_DIR)/print_fit_hab.sh $(PRINT_FIT_HAB_OFFSET) $(dtb) $(supp_dtbs)
-	@rm -f $(dtb)
+print_fit_hab: $(MKIMG) u-boot.itb
+	./$(MKIMG) -version $(VERSION) -print_fit_hab u-boot.itb $(PRINT_FIT_HAB_OFFSET)
 
-print_fit_hab_ddr4: u-boot-nodtb.bin bl31.bin $(dtb_ddr4_evk) $(supp_dtbs)
-	./$(PAD_IMAGE) $(TEE)
-	./$(PAD_IMAGE) bl31.bin
-	./$(PAD_IMAGE) u-boot-nodtb.bin $(dtb_ddr4_evk) $(supp_dtbs)
-	FIT_DATA_POS=$(FIT_EXTERNAL_POSITION) TEE_LOAD_ADDR=$(TEE_LOAD_ADDR) ATF_LOAD_ADDR=$(ATF_LOAD_ADDR) VERSION=$(VERSION) ../$(SOC_DIR)/print_fit_hab.sh $(PRINT_FIT_HAB_OFFSET) $(dtb_ddr4_evk) $(supp_dtbs)
-	@rm -f $(dtb_ddr4_evk)
+print_fit_hab_ddr4: $(MKIMG) u-boot-ddr4-evk.itb
+	./$(MKIMG) -version $(VERSION) -print_fit_hab u-boot-ddr4-evk.itb $(PRINT_FIT_HAB_OFFSET)
 
-print_fit_hab_flexspi: u-boot-nodtb.bin bl31.bin $(dtb) $(supp_dtbs)
-	./$(PAD_IMAGE) $(TEE)
-	./$(PAD_IMAGE) bl31.bin
-	./$(PAD_IMAGE) u-boot-nodtb.bin $(dtb) $(supp_dtbs)
-	FIT_DATA_POS=$(FIT_EXTERNAL_POSITION) TEE_LOAD_ADDR=$(TEE_LOAD_ADDR) ATF_LOAD_ADDR=$(ATF_LOAD_ADDR) VERSION=$(VERSION) BOOT_DEV="flexspi" ../$(SOC_DIR)/print_fit_hab.sh $(PRINT_FIT_HAB_OFFSET) $(dtb) $(supp_dtbs)
-	@rm -f $(dtb)
+print_fit_hab_flexspi: $(MKIMG) u-boot.itb
+	./$(MKIMG) -version $(VERSION) -dev flexspi -print_fit_hab u-boot.itb $(PRINT_FIT_HAB_OFFSET)
 
 nightly :
 	@echo "Pulling nightly for $(PLAT) evk board from $(SERVER)/$(DIR)"
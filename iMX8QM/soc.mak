@@ -16,6 +16,7 @@ PAD_IMAGE = ../scripts/pad_image.sh
 
 AHAB_IMG = mx8qmb0-ahab-container.img
 TEE = tee.bin
+TEE_ATTRS = $(if $(TEE_COMPRESS_ENABLE),compress=lz4hc)
 
 FORCE:
 
@@ -66,15 +67,10 @@ u-boot-atf-container.img: bl31.bin u-boot-hash.bin
 	mv u-boot-hash.bin.temp u-boot-hash.bin; \
 	fi
 	if [ -f $(TEE) ]; then \
-		if [ $(shell echo $(TEE_COMPRESS_ENABLE)) ]; then \
-			echo "Start compress $(TEE)"; \
-			lz4 -9 -f --rm $(TEE) $(TEE).lz4; \
-			cp $(TEE).lz4 $(TEE); \
-		fi; \
 		if [ $(shell echo $(ROLLBACK_INDEX_IN_CONTAINER)) ]; then \
-			./$(MKIMG) -soc QM -sw_version $(ROLLBACK_INDEX_IN_CONTAINER) -rev B0 -c -ap bl31.bin a53 0x80000000 -ap u-boot-hash.bin a53 0x80020000 -ap $(TEE) a53 0xFE000000 -out u-boot-atf-container.img; \
+			./$(MKIMG) -soc QM -sw_version $(ROLLBACK_INDEX_IN_CONTAINER) -rev B0 -c -ap bl31.bin a53 0x80000000 -ap u-boot-hash.bin a53 0x80020000 -ap $(TEE) a53 0xFE000000 $(TEE_ATTRS) -out u-boot-atf-container.img; \
 		else \
-			./$(MKIMG) -soc QM -rev B0 -c -ap bl31.bin a53 0x80000000 -ap u-boot-hash.bin a53 0x80020000 -ap $(TEE) a53 0xFE000000 -out u-boot-atf-container.img; \
+			./$(MKIMG) -soc QM -rev B0 -c -ap bl31.bin a53 0x80000000 -ap u-boot-hash.bin a53 0x80020000 -ap $(TEE) a53 0xFE000000 $(TEE_ATTRS) -out u-boot-atf-container.img; \
 		fi; \
 	else \
 	./$(MKIMG) -soc QM -rev B0 -c -ap bl31.bin a53 0x80000000 -ap u-boot-hash.bin a53 0x80020000 -out u-boot-atf-container.img; \
@@ -23,6 +23,7 @@ AHAB_IMG = mx8qxc0-ahab-container.img
 endif
 
 TEE = tee.bin
+TEE_ATTRS = $(if $(TEE_COMPRESS_ENABLE),compress=lz4hc)
 
 ifeq ($(SOC),iMX8DX)
 TEE_LOAD_ADDR ?= 0x96000000
@@ -49,15 +50,10 @@ u-boot-atf.itb: u-boot-hash.bin bl31.bin
 
 u-boot-atf-container.img: bl31.bin u-boot-hash.bin
 	if [ -f $(TEE) ]; then \
-		if [ $(shell echo $(TEE_COMPRESS_ENABLE)) ]; then \
-			echo "Start compress $(TEE)"; \
-			lz4 -9 -f --rm $(TEE) $(TEE).lz4; \
-			cp $(TEE).lz4 $(TEE); \
-		fi; \
 		if [ $(shell echo $(ROLLBACK_INDEX_IN_CONTAINER)) ]; then \
-			./$(MKIMG) -soc QX -sw_version $(ROLLBACK_INDEX_IN_CONTAINER) -rev B0 -c -ap bl31.bin a35 0x80000000 -ap u-boot-hash.bin a35 0x80020000 -ap $(TEE) a35 $(TEE_LOAD_ADDR) -out u-boot-atf-container.img; \
+			./$(MKIMG) -soc QX -sw_version $(ROLLBACK_INDEX_IN_CONTAINER) -rev B0 -c -ap bl31.bin a35 0x80000000 -ap u-boot-hash.bin a35 0x80020000 -ap $(TEE) a35 $(TEE_LOAD_ADDR) $(TEE_ATTRS) -out u-boot-atf-container.img; \
 		else \
-			./$(MKIMG) -soc QX -rev B0 -c -ap bl31.bin a35 0x80000000 -ap u-boot-hash.bin a35 0x80020000 -ap $(TEE) a35 $(TEE_LOAD_ADDR) -out u-boot-atf-container.img; \
+			./$(MKIMG) -soc QX -rev B0 -c -ap bl31.bin a35 0x80000000 -ap u-boot-hash.bin a35 0x80020000 -ap $(TEE) a35 $(TEE_LOAD_ADDR) $(TEE_ATTRS) -out u-boot-atf-container.img; \
 		fi; \
 	else \
 	./$(MKIMG) -soc QX -rev B0 -c -ap bl31.bin a35 0x80000000 -ap u-boot-hash.bin a35 0x80020000 -out u-boot-atf-container.img; \
@@ -21,6 +21,7 @@ endif
 LC_REVISION = $(shell echo $(REV) | tr ABC abc)
 AHAB_IMG = mx8ulp$(LC_REVISION)-ahab-container.img
 TEE = tee.bin
+TEE_ATTRS = $(if $(TEE_COMPRESS_ENABLE),compress=lz4hc)
 UPOWER_IMG = upower.bin
 MCU_IMG = m33_image.bin
 ROM_PATCH_IMG = ahab-container-patch.bin
@@ -53,15 +54,10 @@ u-boot-atf.itb: u-boot-hash.bin bl31.bin
 
 u-boot-atf-container.img: bl31.bin u-boot-hash.bin
 	if [ -f $(TEE) ]; then \
-		if [ $(shell echo $(TEE_COMPRESS_ENABLE)) ]; then \
-			echo "Start compress $(TEE)"; \
-			lz4 -9 -f --rm $(TEE) $(TEE).lz4; \
-			cp $(TEE).lz4 $(TEE); \
-		fi; \
 		if [ $(shell echo $(ROLLBACK_INDEX_IN_CONTAINER)) ]; then \
-			./$(MKIMG) -soc ULP -sw_version $(ROLLBACK_INDEX_IN_CONTAINER)  -c -ap bl31.bin a35 $(ATF_LOAD_ADDR) -ap u-boot-hash.bin a35 $(UBOOT_LOAD_ADDR) -ap $(TEE) a35 $(TEE_LOAD_ADDR) -out u-boot-atf-container.img; \
+			./$(MKIMG) -soc ULP -sw_version $(ROLLBACK_INDEX_IN_CONTAINER)  -c -ap bl31.bin a35 $(ATF_LOAD_ADDR) -ap u-boot-hash.bin a35 $(UBOOT_LOAD_ADDR) -ap $(TEE) a35 $(TEE_LOAD_ADDR) $(TEE_ATTRS) -out u-boot-atf-container.img; \
 		else \
-			./$(MKIMG) -soc ULP -c -ap bl31.bin a35 $(ATF_LOAD_ADDR) -ap u-boot-hash.bin a35 $(UBOOT_LOAD_ADDR) -ap $(TEE) a35 $(TEE_LOAD_ADDR) -out u-boot-atf-container.img; \
+			./$(MKIMG) -soc ULP -c -ap bl31.bin a35 $(ATF_LOAD_ADDR) -ap u-boot-hash.bin a35 $(UBOOT_LOAD_ADDR) -ap $(TEE) a35 $(TEE_LOAD_ADDR) $(TEE_ATTRS) -out u-boot-atf-container.img; \
 		fi; \
 	else \
 		./$(MKIMG) -soc ULP -c -ap bl31.bin a35 $(ATF_LOAD_ADDR) -ap u-boot-hash.bin a35 $(UBOOT_LOAD_ADDR) -out u-boot-atf-container.img; \
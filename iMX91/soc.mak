@@ -26,7 +26,7 @@ SPL_LOAD_ADDR ?= 0x204A0000
 ATF_LOAD_ADDR ?= 0x204C0000
 UBOOT_LOAD_ADDR ?= 0x80200000
 LPDDR_FW_VERSION ?= _v202201
-SPL_A55_IMG ?= u-boot-spl-ddr.bin
+SPL_A55_IMG ?= @spl-ddr
 KERNEL_DTB ?= imx91-11x11-evk.dtb   # Used by kernel authentication
 KERNEL_DTB_ADDR ?= 0x83000000
 KERNEL_ADDR ?= 0x80400000
@@ -73,24 +73,20 @@ lpddr4_imem_qb = lpddr4_imem_qb$(LPDDR_FW_VERSION).bin
 lpddr4_dmem_qb = lpddr4_dmem_qb$(LPDDR_FW_VERSION).bin
 lpddr4_qb_data = lpddr4_qb_data.bin
 
-u-boot-spl-ddr.bin: u-boot-spl.bin $(lpddr4_imem_1d) $(lpddr4_dmem_1d) $(lpddr4_imem_2d) $(lpddr4_dmem_2d)
-	@objcopy -I binary -O binary --pad-to 0x8000 --gap-fill=0x0 $(lpddr4_imem_1d) lpddr4_pmu_train_1d_imem_pad.bin
-	@objcopy -I binary -O binary --pad-to 0x4000 --gap-fill=0x0 $(lpddr4_dmem_1d) lpddr4_pmu_train_1d_dmem_pad.bin
-	@objcopy -I binary -O binary --pad-to 0x8000 --gap-fill=0x0 $(lpddr4_imem_2d) lpddr4_pmu_train_2d_imem_pad.bin
-	@cat lpddr4_pmu_train_1d_imem_pad.bin lpddr4_pmu_train_1d_dmem_pad.bin > lpddr4_pmu_train_1d_fw.bin
-	@cat lpddr4_pmu_train_2d_imem_pad.bin $(lpddr4_dmem_2d) > lpddr4_pmu_train_2d_fw.bin
-	@dd if=u-boot-spl.bin of=u-boot-spl-pad.bin bs=4 conv=sync
-	@cat u-boot-spl-pad.bin lpddr4_pmu_train_1d_fw.bin lpddr4_pmu_train_2d_fw.bin > u-boot-spl-ddr.bin
-	@rm -f u-boot-spl-pad.bin lpddr4_pmu_train_1d_fw.bin lpddr4_pmu_train_2d_fw.bin
-	@rm -f lpddr4_pmu_train_1d_imem_pad.bin lpddr4_pmu_train_1d_dmem_pad.bin lpddr4_pmu_train_2d_imem_pad.bin
-
-u-boot-spl-ddr-qb.bin: u-boot-spl.bin $(lpddr4_imem_qb) $(lpddr4_dmem_qb) $(lpddr4_qb_data)
-	@objcopy -I binary -O binary --pad-to 0x8000 --gap-fill=0x0 $(lpddr4_imem_qb) lpddr4_pmu_qb_imem_pad.bin
-	@objcopy -I binary -O binary --pad-to 0x4000 --gap-fill=0x0 $(lpddr4_dmem_qb) lpddr4_pmu_qb_dmem_pad.bin
-	@cat lpddr4_pmu_qb_imem_pad.bin lpddr4_pmu_qb_dmem_pad.bin > lpddr4_pmu_qb_fw.bin
-	@dd if=u-boot-spl.bin of=u-boot-spl-pad.bin bs=4 conv=sync
-	@cat u-boot-spl-pad.bin lpddr4_pmu_qb_fw.bin $(lpddr4_qb_data) > u-boot-spl-ddr-qb.bin
-	@rm -f u-boot-spl-pad.bin lpddr4_pmu_qb_imem_pad.bin lpddr4_pmu_qb_dmem_pad.bin lpddr4_pmu_qb_fw.bin
+# The SPL with the DDR training firmware appended, built in memory by
+# mkimage (-compose) and used as @spl-ddr, or @spl-ddr-qb for QuickBoot
+SPL_DDR_PARTS = u-boot-spl.bin,align=4 \
+		$(lpddr4_imem_1d),pad=0x8000 $(lpddr4_dmem_1d),pad=0x4000 \
+		$(lpddr4_imem_2d),pad=0x8000 $(lpddr4_dmem_2d)
+SPL_DDR_QB_PARTS = u-boot-spl.bin,align=4 \
+		   $(lpddr4_imem_qb),pad=0x8000 $(lpddr4_dmem_qb),pad=0x4000 $(lpddr4_qb_data)
+
+# Empty when SPL_A55_IMG is set to a file
+SPL_A55_COMPOSE = $(if $(filter @spl-ddr,$(SPL_A55_IMG)),-compose spl-ddr $(SPL_DDR_PARTS))
+
+@spl-ddr: u-boot-spl.bin $(lpddr4_imem_1d) $(lpddr4_dmem_1d) $(lpddr4_imem_2d) $(lpddr4_dmem_2d)
+
+@spl-ddr-qb: u-boot-spl.bin $(lpddr4_imem_qb) $(lpddr4_dmem_qb) $(lpddr4_qb_data)
 
 u-boot-hash.bin: u-boot.bin
 	./$(MKIMG) -commit > head.hash
@@ -160,7 +156,7 @@ flash_fw.bin: FORCE
 
 .PHONY: clean nightly
 clean:
-	@rm -f $(MKIMG) u-boot-atf-container.img u-boot-spl-ddr.bin u-boot-spl-ddr-qb.bin u-boot-hash.bin
+	@rm -f $(MKIMG) u-boot-atf-container.img u-boot-hash.bin
 	@rm -rf extracted_imgs
 	@echo "imx91 clean done"
 
@@ -202,27 +198,28 @@ endif
 
 
 flash_singleboot: $(MKIMG) $(AHAB_IMG) $(SPL_A55_IMG) u-boot-atf-container.img
-	./$(MKIMG) -soc IMX9 -append $(AHAB_IMG) -c -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) -out flash.bin
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -append $(AHAB_IMG) -c -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_singleboot_no_ahabfw: $(MKIMG) $(SPL_A55_IMG) u-boot-atf-container.img
-	./$(MKIMG) -soc IMX9 -c -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) -out flash.bin
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -c -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_singleboot_spinand: $(MKIMG) $(AHAB_IMG) $(SPL_A55_IMG) u-boot-atf-container-spinand.img flash_fw.bin
-	./$(MKIMG) -soc IMX9 -dev nand 4K -append $(AHAB_IMG) -c \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -dev nand 4K -append $(AHAB_IMG) -c \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) -out flash.bin
 	$(call append_container,u-boot-atf-container-spinand.img,4)
 
 flash_singleboot_spinand_fw: flash_fw.bin
 	@mv -f flash_fw.bin flash.bin
 
-flash_singleboot_qb: $(MKIMG) $(AHAB_IMG) u-boot-spl-ddr-qb.bin u-boot-atf-container.img
-	./$(MKIMG) -soc IMX9 -append $(AHAB_IMG) -c -ap u-boot-spl-ddr-qb.bin a55 $(SPL_LOAD_ADDR) -out flash.bin
+flash_singleboot_qb: $(MKIMG) $(AHAB_IMG) @spl-ddr-qb u-boot-atf-container.img
+	./$(MKIMG) -soc IMX9 -compose spl-ddr-qb $(SPL_DDR_QB_PARTS) \
+		   -append $(AHAB_IMG) -c -ap @spl-ddr-qb a55 $(SPL_LOAD_ADDR) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_singleboot_flexspi: $(MKIMG) $(AHAB_IMG) $(SPL_A55_IMG) u-boot-atf-container.img fcb.bin
-	./$(MKIMG) -soc IMX9 -dev flexspi -append $(AHAB_IMG) -c \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -dev flexspi -append $(AHAB_IMG) -c \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) \
 		   -fcb fcb.bin $(FCB_LOAD_ADDR) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
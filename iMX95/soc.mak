@@ -37,7 +37,7 @@ MCU_TCM_ADDR_ACORE_VIEW ?= 0x201C0000
 LPDDR_TYPE ?= lpddr5
 LPDDR_FUNC ?= train
 LPDDR_FW_VERSION ?= _v202311
-SPL_A55_IMG ?= u-boot-spl-ddr-v2.bin
+SPL_A55_IMG ?= @spl-ddr-v2
 KERNEL_DTB ?= imx95-19x19-evk.dtb   # Used by kernel authentication
 KERNEL_DTB_ADDR ?= 0x93000000
 KERNEL_ADDR ?= 0x90400000
@@ -48,6 +48,7 @@ V2X_DDR = 0x8b000000
 MCU_IMG ?= m33_image.bin
 M7_IMG ?= m7_image.bin
 TEE ?= tee.bin
+TEE_ATTRS = $(if $(TEE_COMPRESS_ENABLE),compress=lz4hc)
 TEE_LOAD_ADDR ?= 0x8C000000
 MCU_XIP_ADDR ?= 0x28032000 # Point entry of m33 in flexspi0 nor flash
 M33_IMAGE_XIP_OFFSET ?= 0x31000 # 1st container offset is 0x1000 when boot device is flexspi0 nor
@@ -82,8 +83,8 @@ OEI_M33_DDR_IMG ?= oei-m33-ddr.bin
 OEI_A55_TCM_IMG ?= oei-a55-tcm.bin
 OEI_M33_TCM_IMG ?= oei-m33-tcm.bin
 
-A55_OEI_DDRFW = a55-oei-ddrfw.bin
-M33_OEI_DDRFW = m33-oei-ddrfw.bin
+A55_OEI_DDRFW = @a55-oei-ddrfw
+M33_OEI_DDRFW = @m33-oei-ddrfw
 OEI_QBDATA_FILE = qb_data.bin
 
 ifneq (,$(wildcard $(OEI_QBDATA_FILE)))
@@ -93,11 +94,13 @@ OEI_DDR_QB_DATA =
 endif
 
 ifneq (,$(wildcard $(OEI_A55_DDR_IMG)))
+OEI_OPT_A55 += -compose a55-oei-ddrfw $(OEI_A55_DDR_IMG),align=4 $(DDRFW_V3_PARTS)
 OEI_OPT_A55 += -oei $(A55_OEI_DDRFW) a55 $(OEI_A55_ENTR_ADDR) $(OEI_A55_LOAD_ADDR)
 OEI_OPT_A55 += -hold 65536 $(OEI_DDR_QB_DATA)
 OEI_IMG_A55 += $(A55_OEI_DDRFW) $(OEI_DDR_QB_DATA)
 endif
 ifneq (,$(wildcard $(OEI_M33_DDR_IMG)))
+OEI_OPT_M33 += -compose m33-oei-ddrfw $(OEI_M33_DDR_IMG),align=4 $(DDRFW_V3_PARTS)
 OEI_OPT_M33 += -oei $(M33_OEI_DDRFW) m33 $(OEI_M33_ENTR_ADDR) $(OEI_M33_LOAD_ADDR)
 OEI_OPT_M33 += -hold 65536 $(OEI_DDR_QB_DATA)
 OEI_IMG_M33 += $(M33_OEI_DDRFW) $(OEI_DDR_QB_DATA)
@@ -156,41 +159,26 @@ endef
 
 FORCE:
 
-fw-header.bin: $(lpddr_imem) $(lpddr_dmem)
-	@imem_size=`wc -c $(lpddr_imem) | awk '{printf "%.8x", $$1}' | sed -e 's/\(..\)\(..\)\(..\)\(..\)/\4\3\2\1/'`; \
-		echo $$imem_size | xxd -r -p >  fw-header.bin
-	@dmem_size=`wc -c $(lpddr_dmem) | awk '{printf "%.8x", $$1}' | sed -e 's/\(..\)\(..\)\(..\)\(..\)/\4\3\2\1/'`; \
-		echo $$dmem_size | xxd -r -p >> fw-header.bin
-
-fw-header-qb.bin: $(lpddr_imem_qb) $(lpddr_dmem_qb)
-	@imem_size=`wc -c $(lpddr_imem_qb) | awk '{printf "%.8x", $$1}' | sed -e 's/\(..\)\(..\)\(..\)\(..\)/\4\3\2\1/'`; \
-		echo $$imem_size | xxd -r -p >  fw-header-qb.bin
-	@dmem_size=`wc -c $(lpddr_dmem_qb) | awk '{printf "%.8x", $$1}' | sed -e 's/\(..\)\(..\)\(..\)\(..\)/\4\3\2\1/'`; \
-		echo $$dmem_size | xxd -r -p >> fw-header-qb.bin
-
-define append_ddrfw_v2
-	@dd if=$(1) of=$(1)-pad bs=4 conv=sync
-	@cat $(1)-pad fw-header.bin $(lpddr_imem) $(lpddr_dmem) $(3) > $(2).unaligned
-	@dd if=$(2).unaligned of=$(2) bs=8 conv=sync
-	@rm -f $(1)-pad $(2).unaligned fw-header.bin
-endef
+# The DDR firmware follows its user (SPL or OEI) padded to 4 bytes, each
+# imem/dmem pair behind a header of their 32-bit sizes, the whole padded to
+# 8 bytes. Built in memory by mkimage (-compose): @spl-ddr-v2 for the SPL,
+# @a55-oei-ddrfw and @m33-oei-ddrfw for the OEI, with the QuickBoot
+# firmware too.
+SPL_DDR_V2_PARTS = u-boot-spl.bin,align=4 \
+		   size32=$(lpddr_imem) size32=$(lpddr_dmem) $(lpddr_imem) $(lpddr_dmem) \
+		   align=8
+DDRFW_V3_PARTS = size32=$(lpddr_imem) size32=$(lpddr_dmem) $(lpddr_imem) $(lpddr_dmem) \
+		 size32=$(lpddr_imem_qb) size32=$(lpddr_dmem_qb) $(lpddr_imem_qb) $(lpddr_dmem_qb) \
+		 align=8
 
-define append_ddrfw_v3
-	@dd if=$(1) of=$(1)-pad bs=4 conv=sync
-	@cat $(1)-pad fw-header.bin $(lpddr_imem) $(lpddr_dmem) fw-header-qb.bin $(lpddr_imem_qb) $(lpddr_dmem_qb) > $(2).unaligned
-	@dd if=$(2).unaligned of=$(2) bs=8 conv=sync
-	@rm -f $(1)-pad $(2).unaligned fw-header.bin fw-header-qb.bin
-endef
+# Empty when SPL_A55_IMG is set to a file
+SPL_A55_COMPOSE = $(if $(filter @spl-ddr-v2,$(SPL_A55_IMG)),-compose spl-ddr-v2 $(SPL_DDR_V2_PARTS))
 
-a55-oei-ddrfw.bin: $(OEI_A55_DDR_IMG) $(lpddr_imem) $(lpddr_dmem) fw-header.bin $(lpddr_imem_qb) $(lpddr_dmem_qb) fw-header-qb.bin
-	$(call append_ddrfw_v3,$(OEI_A55_DDR_IMG),a55-oei-ddrfw.bin)
+@a55-oei-ddrfw: $(OEI_A55_DDR_IMG) $(lpddr_imem) $(lpddr_dmem) $(lpddr_imem_qb) $(lpddr_dmem_qb)
 
-m33-oei-ddrfw.bin: $(OEI_M33_DDR_IMG) $(lpddr_imem) $(lpddr_dmem) fw-header.bin $(lpddr_imem_qb) $(lpddr_dmem_qb) fw-header-qb.bin
-	@echo "DDR FW - $(lpddr_imem) $(lpddr_dmem) $(lpddr_imem_qb) $(lpddr_dmem_qb)"
-	$(call append_ddrfw_v3,$(OEI_M33_DDR_IMG),m33-oei-ddrfw.bin)
+@m33-oei-ddrfw: $(OEI_M33_DDR_IMG) $(lpddr_imem) $(lpddr_dmem) $(lpddr_imem_qb) $(lpddr_dmem_qb)
 
-u-boot-spl-ddr-v2.bin: u-boot-spl.bin $(lpddr_imem) $(lpddr_dmem) fw-header.bin
-	$(call append_ddrfw_v2,u-boot-spl.bin,u-boot-spl-ddr-v2.bin)
+@spl-ddr-v2: u-boot-spl.bin $(lpddr_imem) $(lpddr_dmem)
 
 u-boot-hash.bin: u-boot.bin
 	./$(MKIMG) -commit > head.hash
@@ -209,22 +197,17 @@ u-boot-atf.itb: u-boot-hash.bin bl31.bin
 
 u-boot-atf-container.img: bl31.bin u-boot-hash.bin
 	if [ -f $(TEE) ]; then \
-		if [ $(shell echo $(TEE_COMPRESS_ENABLE)) ]; then \
-			echo "Start compress $(TEE)"; \
-			lz4 -9 -f --rm $(TEE) $(TEE).lz4; \
-			cp $(TEE).lz4 $(TEE); \
-		fi; \
 		if [ $(shell echo $(ROLLBACK_INDEX_IN_CONTAINER)) ]; then \
 			./$(MKIMG) -soc IMX9 -sw_version $(ROLLBACK_INDEX_IN_CONTAINER) -c \
 				   -ap bl31.bin a55 $(ATF_LOAD_ADDR) \
 				   -ap u-boot-hash.bin a55 $(UBOOT_LOAD_ADDR) \
-				   -ap $(TEE) a55 $(TEE_LOAD_ADDR) \
+				   -ap $(TEE) a55 $(TEE_LOAD_ADDR) $(TEE_ATTRS) \
 				   -out u-boot-atf-container.img; \
 		else \
 			./$(MKIMG) -soc IMX9 -c \
 				   -ap bl31.bin a55 $(ATF_LOAD_ADDR) \
 				   -ap u-boot-hash.bin a55 $(UBOOT_LOAD_ADDR) \
-				   -ap $(TEE) a55 $(TEE_LOAD_ADDR) -out u-boot-atf-container.img; \
+				   -ap $(TEE) a55 $(TEE_LOAD_ADDR) $(TEE_ATTRS) -out u-boot-atf-container.img; \
 		fi; \
 	else \
 		./$(MKIMG) -soc IMX9 -c \
@@ -240,13 +223,13 @@ u-boot-atf-container-spinand.img: bl31.bin u-boot-hash.bin
 				   -dev nand 4K -c \
 				   -ap bl31.bin a55 $(ATF_LOAD_ADDR) \
 				   -ap u-boot-hash.bin a55 $(UBOOT_LOAD_ADDR) \
-				   -ap $(TEE) a55 $(TEE_LOAD_ADDR) \
+				   -ap $(TEE) a55 $(TEE_LOAD_ADDR) $(TEE_ATTRS) \
 				   -out u-boot-atf-container-spinand.img; \
 		else \
 			./$(MKIMG) -soc IMX9 -dev nand 4K -c \
 				   -ap bl31.bin a55 $(ATF_LOAD_ADDR) \
 				   -ap u-boot-hash.bin a55 $(UBOOT_LOAD_ADDR) \
-				   -ap $(TEE) a55 $(TEE_LOAD_ADDR) \
+				   -ap $(TEE) a55 $(TEE_LOAD_ADDR) $(TEE_ATTRS) \
 				   -out u-boot-atf-container-spinand.img; \
 		fi; \
 	else \
@@ -265,7 +248,7 @@ flash_fw.bin: FORCE
 
 .PHONY: clean nightly
 clean:
-	@rm -f $(MKIMG) u-boot-atf-container.img u-boot-spl-ddr-v2.bin m33-oei-ddrfw.bin a55-oei-ddrfw.bin u-boot-hash.bin flash.bin head.hash boot-spl-container.img
+	@rm -f $(MKIMG) u-boot-atf-container.img u-boot-hash.bin flash.bin head.hash boot-spl-container.img
 	@rm -rf extracted_imgs
 	@echo "imx95 clean done"
 
@@ -293,19 +276,19 @@ flash_lpboot_flexspi_xip: $(MKIMG) $(AHAB_IMG) $(MCU_IMG) $(OEI_IMG_M33)
 	./$(QSPI_PACKER) $(QSPI_HEADER)
 
 flash_a55: $(MKIMG) $(AHAB_IMG) $(MCU_IMG) u-boot-atf-container.img $(SPL_A55_IMG) $(OEI_IMG_M33) $(OEI_M33_DDR_IMG)
-	./$(MKIMG) -soc IMX9 -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR_M33_VIEW) $(V2X_DUMMY) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_a55_no_ahabfw: $(MKIMG) $(MCU_IMG) u-boot-atf-container.img $(SPL_A55_IMG) $(OEI_IMG_M33)
-	./$(MKIMG) -soc IMX9 -c $(OEI_OPT_M33) -msel $(MSEL) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -c $(OEI_OPT_M33) -msel $(MSEL) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR_M33_VIEW) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_a55_flexspi: $(MKIMG) $(AHAB_IMG) $(MCU_IMG) $(SPL_A55_IMG) $(OEI_IMG_M33) fcb.bin u-boot-atf-container.img
-	./$(MKIMG) -soc IMX9 -dev flexspi -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -dev flexspi -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR_M33_VIEW) $(V2X_DUMMY) -fcb fcb.bin $(FCB_LOAD_ADDR) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
@@ -342,21 +325,21 @@ flash_m7_ddr: $(MKIMG) $(MCU_IMG) $(M7_IMG) $(OEI_IMG_M33) $(AHAB_IMG)
 		   -m7 $(M7_IMG) 0 $(M7_DDR_ADDR) $(M7_DDR_ADDR) $(V2X_DUMMY) -out flash.bin
 
 flash_all: $(MKIMG) $(AHAB_IMG) $(MCU_IMG) $(M7_IMG) u-boot-atf-container.img $(SPL_A55_IMG) $(OEI_IMG_M33)
-	./$(MKIMG) -soc IMX9 -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) \
 		   -m7 $(M7_IMG) 0 $(M7_TCM_ADDR) $(M7_TCM_ADDR_ALIAS)  \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR_M33_VIEW) $(V2X_DUMMY) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_all_ddr: $(MKIMG) $(AHAB_IMG) $(MCU_IMG) $(M7_IMG) u-boot-atf-container.img $(SPL_A55_IMG) $(OEI_IMG_M33)
-	./$(MKIMG) -soc IMX9 -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) \
 		   -m7 $(M7_IMG) 0 $(M7_DDR_ADDR) $(M7_DDR_ADDR)  \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR_M33_VIEW) $(V2X_DUMMY) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_all_ddr_flexspi: $(MKIMG) $(AHAB_IMG) $(MCU_IMG) $(M7_IMG) u-boot-atf-container.img $(SPL_A55_IMG) $(OEI_IMG_M33) fcb.bin
-	./$(MKIMG) -soc IMX9 -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -append $(AHAB_IMG) -c $(OEI_OPT_M33) -msel $(MSEL) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) \
 		   -m7 $(M7_IMG) 0 $(M7_DDR_ADDR) $(M7_DDR_ADDR)  \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR_M33_VIEW) $(V2X_DUMMY) \
@@ -365,7 +348,7 @@ flash_all_ddr_flexspi: $(MKIMG) $(AHAB_IMG) $(MCU_IMG) $(M7_IMG) u-boot-atf-cont
 	$(call append_fcb)
 
 flash_all_no_ahabfw: $(MKIMG) $(MCU_IMG) $(M7_IMG) u-boot-atf-container.img $(SPL_A55_IMG) $(OEI_IMG_M33)
-	./$(MKIMG) -soc IMX9 -c $(OEI_OPT_M33) -msel $(MSEL) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -c $(OEI_OPT_M33) -msel $(MSEL) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) \
 		   -m7 $(M7_IMG) 0 $(M7_TCM_ADDR) $(M7_TCM_ADDR_ALIAS)  \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR_M33_VIEW) -out flash.bin
@@ -417,17 +400,17 @@ flash_netc: flash_lpboot_sm_all
 flash_evk: flash_lpboot_sm_all
 
 flash_singleboot: $(MKIMG) $(AHAB_IMG) $(SPL_A55_IMG) u-boot-atf-container.img $(OEI_IMG_A55)
-	./$(MKIMG) -soc IMX9 -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) $(V2X_DUMMY) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_singleboot_no_ahabfw: $(MKIMG) $(SPL_A55_IMG) u-boot-atf-container.img $(OEI_IMG_A55)
-	./$(MKIMG) -soc IMX9 -c $(OEI_OPT_A55) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -c $(OEI_OPT_A55) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_singleboot_spinand: $(MKIMG) $(AHAB_IMG) $(SPL_A55_IMG) u-boot-atf-container-spinand.img $(OEI_IMG_A55) flash_fw.bin
-	./$(MKIMG) -soc IMX9 -dev nand 4K -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -dev nand 4K -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) $(V2X_DUMMY) -out flash.bin
 	$(call append_container,u-boot-atf-container-spinand.img,4)
 
@@ -435,26 +418,26 @@ flash_singleboot_spinand_fw: flash_fw.bin
 	@mv -f flash_fw.bin flash.bin
 
 flash_singleboot_flexspi: $(MKIMG) $(AHAB_IMG) $(OEI_IMG_A55) $(SPL_A55_IMG) u-boot-atf-container.img fcb.bin
-	./$(MKIMG) -soc IMX9 -dev flexspi -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -dev flexspi -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) $(V2X_DUMMY) \
 		   -fcb fcb.bin $(FCB_LOAD_ADDR) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 	$(call append_fcb)
 
 flash_singleboot_m33: $(MKIMG) $(AHAB_IMG) u-boot-atf-container.img $(MCU_IMG) $(SPL_A55_IMG) $(OEI_IMG_A55)
-	./$(MKIMG) -soc IMX9 -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) $(MCU_TCM_ADDR_ACORE_VIEW) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) $(V2X_DUMMY) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_singleboot_m33_no_ahabfw: $(MKIMG) u-boot-atf-container.img $(MCU_IMG) $(SPL_A55_IMG) $(OEI_IMG_A55)
-	./$(MKIMG) -soc IMX9 -c $(OEI_OPT_A55) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -c $(OEI_OPT_A55) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) $(MCU_TCM_ADDR_ACORE_VIEW) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_singleboot_m33_flexspi: $(MKIMG) $(AHAB_IMG) $(UPOWER_IMG) u-boot-atf-container.img $(MCU_IMG) $(SPL_A55_IMG) $(OEI_IMG_A55) fcb.bin
-	./$(MKIMG) -soc IMX9 -dev flexspi -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -dev flexspi -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) $(MCU_TCM_ADDR_ACORE_VIEW) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) $(V2X_DUMMY) \
 		   -fcb fcb.bin $(FCB_LOAD_ADDR) -out flash.bin
@@ -462,14 +445,14 @@ flash_singleboot_m33_flexspi: $(MKIMG) $(AHAB_IMG) $(UPOWER_IMG) u-boot-atf-cont
 	$(call append_fcb)
 
 flash_singleboot_all: $(MKIMG) $(AHAB_IMG) u-boot-atf-container.img $(MCU_IMG) $(M7_IMG) $(SPL_A55_IMG) $(OEI_IMG_A55)
-	./$(MKIMG) -soc IMX9 -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -append $(AHAB_IMG) -c $(OEI_OPT_A55) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) $(MCU_TCM_ADDR_ACORE_VIEW) \
 		   -m7 $(M7_IMG) 0 $(M7_TCM_ADDR) $(M7_TCM_ADDR_ALIAS) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) $(V2X_DUMMY) -out flash.bin
 	$(call append_container,u-boot-atf-container.img,1)
 
 flash_singleboot_all_no_ahabfw: $(MKIMG) u-boot-atf-container.img $(MCU_IMG) $(M7_IMG) $(SPL_A55_IMG) $(OEI_IMG_A55)
-	./$(MKIMG) -soc IMX9 -c $(OEI_OPT_A55) \
+	./$(MKIMG) -soc IMX9 $(SPL_A55_COMPOSE) -c $(OEI_OPT_A55) \
 		   -m33 $(MCU_IMG) 0 $(MCU_TCM_ADDR) $(MCU_TCM_ADDR_ACORE_VIEW) \
 		   -m7 $(M7_IMG) 0 $(M7_TCM_ADDR) $(M7_TCM_ADDR_ALIAS) \
 		   -ap $(SPL_A55_IMG) a55 $(SPL_LOAD_ADDR) -out flash.bin
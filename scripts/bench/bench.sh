@@ -0,0 +1,177 @@
+#!/bin/sh
+#
+# End-to-end mkimage benchmark, run by 'make bench'.
+#
+# usage: bench.sh MKIMAGE MKIMAGE_IMX8M GEN_INPUTS WORKDIR [NAME=SIZE ...]
+#
+# Generates deterministic inputs in WORKDIR/in, then runs every layout in
+# the case table below BENCH_RUNS times from a fresh copy of the inputs.
+# Each run must exit 0 and produce the same outputs as the first one.
+# Latency percentiles and throughput are printed per case; the p50 is
+# compared against BENCH_BASELINE, WORKDIR/baseline.txt by default (written
+# by the first run, or with BENCH_UPDATE=1), and the script fails when a
+# case got slower than BENCH_TOLERANCE percent plus BENCH_NOISE_US
+# microseconds. Timings only compare on the same machine: keep the baseline
+# with the workspace, or point BENCH_BASELINE at a file kept for that host.
+
+MK=$(realpath "$1")
+MK8M=$(realpath "$2")
+GEN=$(realpath "$3")
+WORK=$4
+shift 4
+
+RUNS=${BENCH_RUNS:-10}
+TOLERANCE=${BENCH_TOLERANCE:-20}
+NOISE_US=${BENCH_NOISE_US:-2000}
+
+if [ ! -x "$MK" ] || [ ! -x "$MK8M" ] || [ ! -x "$GEN" ] || [ -z "$WORK" ]; then
+	echo "usage: bench.sh MKIMAGE MKIMAGE_IMX8M GEN_INPUTS WORKDIR [NAME=SIZE ...]" >&2
+	exit 1
+fi
+
+mkdir -p "$WORK"
+WORK=$(realpath "$WORK")
+BASELINE=${BENCH_BASELINE:-$WORK/baseline.txt}
+RESULTS=$WORK/results.txt
+
+# The FIT timestamp is the build time otherwise, outputs must not depend on it
+SOURCE_DATE_EPOCH=${SOURCE_DATE_EPOCH:-1577836800}
+export SOURCE_DATE_EPOCH
+
+echo "Generating inputs in $WORK/in"
+rm -rf "$WORK/in" "$WORK/run"
+"$GEN" "$WORK/in" "$@" || exit 1
+
+# Inputs derived with plain shell, as the soc.mak recipes do
+cd "$WORK/in"
+cat bl31.bin u-boot-nodtb.bin > u-boot-atf.bin
+cp u-boot-spl.bin u-boot-spl-ddr.bin
+truncate -s %4 u-boot-spl-ddr.bin
+for fw in 1d_imem 1d_dmem 2d_imem 2d_dmem; do
+	case $fw in
+	*imem) pad=32768 ;;
+	*) pad=16384 ;;
+	esac
+	cp lpddr4_pmu_train_$fw.bin fw.pad
+	truncate -s $pad fw.pad
+	cat fw.pad >> u-boot-spl-ddr.bin
+done
+rm -f fw.pad
+
+#
+# Case table: NAME|OUTPUTS|COMMAND
+#
+# Cases run in order in one directory, later cases may use the outputs of
+# earlier ones (ahab.img, u-boot.itb, qx_sd.bin ...). OUTPUTS are checked
+# for determinism and their size is the byte count for the throughput.
+#
+CASES=$(cat <<EOF
+ahab|ahab.img|$MK -soc IMX9 -c -sentinel sentinel.bin -out ahab.img
+qx_sd|qx_sd.bin|$MK -soc QX -rev B0 -append ahab.img -c -scfw scfw_tcm.bin -ap u-boot-atf.bin a35 0x80000000 -out qx_sd.bin
+qx_emmc_fast|qx_emmc.bin|$MK -soc QX -rev B0 -dev emmc_fast -append ahab.img -c -scfw scfw_tcm.bin -ap u-boot-atf.bin a35 0x80000000 -out qx_emmc.bin
+qx_flexspi|qx_fspi.bin|$MK -soc QX -rev B0 -dev flexspi -append ahab.img -c -scfw scfw_tcm.bin -ap u-boot-atf.bin a35 0x80000000 -out qx_fspi.bin
+qx_nand4k|qx_nand4k.bin|$MK -soc QX -rev B0 -dev nand 4K -append ahab.img -c -scfw scfw_tcm.bin -ap u-boot-atf.bin a35 0x80000000 -out qx_nand4k.bin
+qx_nand8k|qx_nand8k.bin|$MK -soc QX -rev B0 -dev nand 8K -append ahab.img -c -scfw scfw_tcm.bin -ap u-boot-atf.bin a35 0x80000000 -out qx_nand8k.bin
+qx_nand16k|qx_nand16k.bin|$MK -soc QX -rev B0 -dev nand 16K -append ahab.img -c -scfw scfw_tcm.bin -ap u-boot-atf.bin a35 0x80000000 -out qx_nand16k.bin
+qx_m4|qx_m4.bin|$MK -soc QX -rev B0 -append ahab.img -c -flags 0x00200000 -scfw scfw_tcm.bin -ap u-boot-atf.bin a35 0x80000000 -p3 -m4 m33_image.bin 0 0x34FE0000 -out qx_m4.bin
+qx_kernel|qx_kernel.bin|$MK -soc QX -rev B0 -c -ap Image a35 0x80200000 -data board.dtb a35 0x83000000 -out qx_kernel.bin
+qm_sd|qm_sd.bin|$MK -soc QM -rev B0 -append ahab.img -c -scfw scfw_tcm.bin -ap u-boot-atf.bin a53 0x80000000 -out qm_sd.bin
+dxl_sd|dxl_sd.bin|$MK -soc DXL -rev A0 -append ahab.img -c -scfw scfw_tcm.bin -ap u-boot-atf.bin a35 0x80000000 -out dxl_sd.bin
+ulp_sd|ulp_sd.bin|$MK -soc ULP -append ahab.img -c -upower upower.bin -ap u-boot-spl.bin a35 0x22020000 -out ulp_sd.bin
+ulp_m33|ulp_m33.bin|$MK -soc ULP -append ahab.img -c -m4 m33_image.bin 0 0x1FFC2000 -upower upower.bin -ap u-boot-spl.bin a35 0x22020000 -out ulp_m33.bin
+imx9_sd|imx9_sd.bin|$MK -soc IMX9 -append ahab.img -c -m33 m33_image.bin 0 0x1FFE0000 -ap u-boot-spl-ddr.bin a55 0x2049A000 -out imx9_sd.bin
+imx9_flexspi|imx9_fspi.bin|$MK -soc IMX9 -dev flexspi -append ahab.img -c -ap u-boot-spl-ddr.bin a55 0x2049A000 -out imx9_fspi.bin
+imx9_nand16k|imx9_nand.bin|$MK -soc IMX9 -dev nand 16K -append ahab.img -c -ap u-boot-spl-ddr.bin a55 0x2049A000 -out imx9_nand.bin
+imx9_atf|imx9_atf.img|$MK -soc IMX9 -c -ap bl31.bin a55 0x204E0000 -ap u-boot-nodtb.bin a55 0x80200000 -out imx9_atf.img
+imx9_kernel|imx9_kernel.bin|$MK -soc IMX9 -c -ap Image a55 0x80200000 -data board.dtb a55 0x83000000 -out imx9_kernel.bin
+imx9_parse|imx9_sd.bin|$MK -soc IMX9 -parse imx9_sd.bin
+qx_extract|extracted_imgs/container2_img1.bin|$MK -soc QX -rev B0 -extract qx_sd.bin
+m8_fit_gen|u-boot.itb|$MK8M -fit_gen u-boot.itb -fit_data_pos 0x5000 -fit_uboot u-boot-nodtb.bin 0x40200000 -fit_atf bl31.bin 0x00920000 -fit_fdt board.dtb
+m8_sd|m8_sd.bin|$MK8M -fit -loader u-boot-spl-ddr.bin 0x7E1000 -second_loader u-boot.itb 0x40200000 0x60000 -out m8_sd.bin
+m8_emmc_fast|m8_emmc.bin|$MK8M -dev emmc_fastboot -fit -loader u-boot-spl-ddr.bin 0x7E1000 -second_loader u-boot.itb 0x40200000 0x60000 -out m8_emmc.bin
+m8_flexspi|m8_fspi.bin|$MK8M -version v2 -dev flexspi -fit -loader u-boot-spl-ddr.bin 0x08000000 -second_loader u-boot.itb 0x40200000 0x60000 -out m8_fspi.bin
+m8_fit_ivt|u-boot-ivt.itb|$MK8M -fit_ivt u-boot.itb 0x40200000 0x0 -out u-boot-ivt.itb
+m8_fit_hab|u-boot.itb|$MK8M -print_fit_hab u-boot.itb 0x60000
+EOF
+)
+
+now_ns() {
+	date +%s%N
+}
+
+# percentile P (0-100) of the sorted numbers on stdin
+percentile() {
+	awk -v p="$1" '{ v[NR] = $1 } END {
+		i = int((p * NR + 99) / 100); if (i < 1) i = 1; print v[i] }'
+}
+
+run_case() {
+	name=$1 outputs=$2 cmd=$3
+	samples=$WORK/samples.$name
+	: > "$samples"
+
+	run=0
+	while [ $run -lt "$RUNS" ]; do
+		start=$(now_ns)
+		$cmd > "$WORK/log.$name" 2>&1
+		rc=$?
+		end=$(now_ns)
+		if [ $rc -ne 0 ]; then
+			echo "$name: failed (rc=$rc), see $WORK/log.$name" >&2
+			return 1
+		fi
+		echo $(( (end - start) / 1000 )) >> "$samples"
+
+		# verify: every run produces exactly the same outputs
+		sums=$(md5sum $outputs | awk '{ print $1 }')
+		if [ $run -eq 0 ]; then
+			first=$sums
+		elif [ "$sums" != "$first" ]; then
+			echo "$name: output of run $run differs from run 0" >&2
+			return 1
+		fi
+		run=$((run + 1))
+	done
+
+	bytes=$(cat $outputs | wc -c)
+	sort -n "$samples" > "$samples.sorted"
+	p50=$(percentile 50 < "$samples.sorted")
+	p90=$(percentile 90 < "$samples.sorted")
+	p99=$(percentile 99 < "$samples.sorted")
+	mbps=$(awk -v b="$bytes" -v t="$p50" 'BEGIN { printf "%.1f", t ? b / t : 0 }')
+
+	printf "%-14s %10d %10d %10d %10s\n" "$name" "$p50" "$p90" "$p99" "$mbps"
+	echo "$name $p50 $p90 $p99 $bytes" >> "$RESULTS"
+	rm -f "$samples" "$samples.sorted"
+}
+
+mkdir -p "$WORK/run"
+cp "$WORK/in/"* "$WORK/run/"
+cd "$WORK/run"
+: > "$RESULTS"
+
+echo "$RUNS runs per case, latency in us, throughput in MB/s at p50"
+printf "%-14s %10s %10s %10s %10s\n" case p50 p90 p99 MB/s
+echo "$CASES" | while IFS='|' read -r name outputs cmd; do
+	run_case "$name" "$outputs" "$cmd" || exit 1
+done || exit 1
+
+if [ ! -f "$BASELINE" ] || [ -n "$BENCH_UPDATE" ]; then
+	cp "$RESULTS" "$BASELINE"
+	echo "Baseline written to $BASELINE"
+	exit 0
+fi
+
+awk -v tol="$TOLERANCE" -v noise="$NOISE_US" '
+	NR == FNR { base[$1] = $2; next }
+	!($1 in base) { next }
+	$2 > base[$1] * (100 + tol) / 100 + noise {
+		printf "REGRESSION %s: p50 %d us, baseline %d us\n", $1, $2, base[$1]
+		bad = 1
+	}
+	END { exit bad }' "$BASELINE" "$RESULTS" || {
+	echo "Benchmark regressed against $BASELINE (BENCH_TOLERANCE=$TOLERANCE%, BENCH_NOISE_US=$NOISE_US)" >&2
+	exit 1
+}
+
+echo "No regression against $BASELINE"
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Write a deterministic set of synthetic boot images for the benchmark
+ * suite (see scripts/bench/bench.sh). The contents only have to look
+ * like firmware to mkimage: a mix of incompressible code, repetitive
+ * tables and zero runs, seeded from the file name so that every run and
+ * every host produces the same bytes.
+ *
+ * usage: gen_inputs DIR [NAME=SIZE ...]
+ *
+ * SIZE takes a K or M suffix, eg. "gen_inputs out kernel=64M".
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define SCFW_DCD_PTR		0x240
+#define SCFW_DCD_ADDR		0x1FFE2000
+#define FDT_MAGIC		0xd00dfeed
+
+typedef struct {
+	const char *name;	/* size key on the command line */
+	const char *filename;
+	size_t size;
+} bench_input_t;
+
+static bench_input_t inputs[] = {
+	{ "ahab",	"sentinel.bin",		0x20000 },
+	{ "scfw",	"scfw_tcm.bin",		0x30000 },
+	{ "spl",	"u-boot-spl.bin",	0x30000 },
+	{ "bl31",	"bl31.bin",		0x18000 },
+	{ "uboot",	"u-boot-nodtb.bin",	0x100000 },
+	{ "dtb",	"board.dtb",		0xC000 },
+	{ "m33",	"m33_image.bin",	0x20000 },
+	{ "m7",		"m7_image.bin",		0x40000 },
+	{ "upower",	"upower.bin",		0x10000 },
+	{ "kernel",	"Image",		0x2000000 },
+	{ "ddr_imem",	"lpddr4_pmu_train_1d_imem.bin",	0x7E00 },
+	{ "ddr_dmem",	"lpddr4_pmu_train_1d_dmem.bin",	0x3200 },
+	{ "ddr_imem2",	"lpddr4_pmu_train_2d_imem.bin",	0x7A00 },
+	{ "ddr_dmem2",	"lpddr4_pmu_train_2d_dmem.bin",	0x0900 },
+};
+
+#define INPUT_COUNT	(sizeof(inputs) / sizeof(inputs[0]))
+
+static uint64_t rnd_state;
+
+static uint64_t rnd(void)
+{
+	/* xorshift64* */
+	rnd_state ^= rnd_state >> 12;
+	rnd_state ^= rnd_state << 25;
+	rnd_state ^= rnd_state >> 27;
+	return rnd_state * 0x2545F4914F6CDD1DULL;
+}
+
+static void rnd_seed(const char *s)
+{
+	/* FNV-1a of the file name, never zero */
+	rnd_state = 0xcbf29ce484222325ULL;
+	while (*s)
+		rnd_state = (rnd_state ^ (uint8_t)*s++) * 0x100000001b3ULL;
+	rnd_state |= 1;
+}
+
+/*
+ * Fill buf 4 KB at a time: roughly half code-like random bytes, a
+ * quarter repeating 32-bit tables and a quarter zero runs, which is
+ * close to the LZ4 ratio of a real u-boot or TEE binary.
+ */
+static void fill_firmware(uint8_t *buf, size_t len)
+{
+	for (size_t off = 0; off < len; off += 4096) {
+		size_t n = len - off < 4096 ? len - off : 4096;
+		uint64_t kind = rnd() & 3;
+		uint32_t word = (uint32_t)rnd();
+
+		for (size_t i = 0; i < n; i++) {
+			if (kind < 2)
+				buf[off + i] = (uint8_t)(rnd() >> 56);
+			else if (kind == 2)
+				buf[off + i] = (uint8_t)(word >> ((i & 3) * 8)) + (i >> 6);
+			else
+				buf[off + i] = 0;
+		}
+	}
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static size_t parse_size(const char *arg, const char *val)
+{
+	char *end;
+	unsigned long long v;
+
+	errno = 0;
+	v = strtoull(val, &end, 0);
+	if (*end == 'K' || *end == 'k')
+		v <<= 10, end++;
+	else if (*end == 'M' || *end == 'm')
+		v <<= 20, end++;
+	if (errno || end == val || *end || !v) {
+		fprintf(stderr, "gen_inputs: invalid size in '%s'\n", arg);
+		exit(EXIT_FAILURE);
+	}
+
+	return v;
+}
+
+static void set_size(const char *arg)
+{
+	const char *eq = strchr(arg, '=');
+
+	for (unsigned int i = 0; eq && i < INPUT_COUNT; i++) {
+		if (strlen(inputs[i].name) == (size_t)(eq - arg) &&
+		    !strncmp(inputs[i].name, arg, eq - arg)) {
+			inputs[i].size = parse_size(arg, eq + 1);
+			return;
+		}
+	}
+
+	fprintf(stderr, "gen_inputs: unknown input '%s', valid are:", arg);
+	for (unsigned int i = 0; i < INPUT_COUNT; i++)
+		fprintf(stderr, " %s", inputs[i].name);
+	fprintf(stderr, "\n");
+	exit(EXIT_FAILURE);
+}
+
+static void write_input(const char *dir, bench_input_t *in)
+{
+	char path[4096];
+	uint8_t *buf;
+	FILE *f;
+
+	buf = malloc(in->size);
+	if (!buf) {
+		fprintf(stderr, "gen_inputs: failed to allocate %zu bytes\n", in->size);
+		exit(EXIT_FAILURE);
+	}
+
+	rnd_seed(in->filename);
+	fill_firmware(buf, in->size);
+
+	/* The SCU ROM finds the DDR DCD through a pointer inside the SCFW */
+	if (!strcmp(in->name, "scfw") && in->size >= SCFW_DCD_PTR + 4)
+		put_le32(buf + SCFW_DCD_PTR, SCFW_DCD_ADDR);
+
+	/* Only the FDT header is looked at when a dtb goes into a FIT */
+	if (!strcmp(in->name, "dtb") && in->size >= 8) {
+		put_be32(buf, FDT_MAGIC);
+		put_be32(buf + 4, in->size);
+	}
+
+	snprintf(path, sizeof(path), "%s/%s", dir, in->filename);
+	f = fopen(path, "wb");
+	if (!f || fwrite(buf, 1, in->size, f) != in->size || fclose(f)) {
+		fprintf(stderr, "gen_inputs: %s: %s\n", path, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stdout, "\t0x%08zx %s\n", in->size, in->filename);
+	free(buf);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s DIR [NAME=SIZE ...]\n", argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (mkdir(argv[1], 0755) && errno != EEXIST) {
+		fprintf(stderr, "gen_inputs: %s: %s\n", argv[1], strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	for (int i = 2; i < argc; i++)
+		set_size(argv[i]);
+
+	for (unsigned int i = 0; i < INPUT_COUNT; i++)
+		write_input(argv[1], &inputs[i]);
+
+	return 0;
+}
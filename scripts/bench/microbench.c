@@ -0,0 +1,531 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Microbenchmarks of the hot kernels of mkimage, run by 'make microbench':
+ * the hash and CRC32 backends, zero padding vs holes, the ways of copying
+ * an image into the output file and the container header flattening.
+ * Each kernel is swept over input sizes, with the page cache hot and/or
+ * cold, on one pinned CPU. The popen + dd + sha256sum pipeline that
+ * set_image_hash() used to run is kept as the reference point.
+ *
+ * usage: microbench [-d DIR] [-s MIN] [-S MAX] [-c CPU] [-m hot|cold|both]
+ *                   [-k KERNEL[,KERNEL...]]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+
+/* The kernels under test are static, build them into this file */
+#include "crc32.c"
+#include "imx8qxb0.c"
+
+#define MB_MIN_TIME_NS		200000000ULL
+#define MB_MIN_ITERS		3
+#define MB_MAX_ITERS		10000
+#define MB_COLD_ITERS		3
+#define MB_MAX_SAMPLES		MB_MAX_ITERS
+#define MB_CHUNK		(1 << 20)
+
+/* a kernel returns -1 when the host does not support it (eg. reflink) */
+typedef struct {
+	const char *name;
+	int (*run)(size_t len);
+	void (*prep)(size_t len);	/* untimed, before each run */
+	bool file_input;		/* reads the input file, cold cache applies */
+	bool fixed_size;		/* ignores the size sweep */
+} mb_kernel_t;
+
+static char in_path[4096], out_path[4096];
+static const char *work_dir = ".";
+static int in_fd = -1;
+static bool cold;
+static uint64_t samples[MB_MAX_SAMPLES];
+
+static void die(const char *what)
+{
+	fprintf(stderr, "microbench: %s: %s\n", what, strerror(errno));
+	exit(EXIT_FAILURE);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void write_all(int fd, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+
+	while (len) {
+		ssize_t n = write(fd, p, len);
+
+		if (n <= 0)
+			die("write");
+		p += n;
+		len -= n;
+	}
+}
+
+/* Input of exactly len pseudo random bytes, flushed so it can be dropped */
+static void make_input(size_t len)
+{
+	uint64_t x = 0x9E3779B97F4A7C15ULL;
+	uint64_t *buf = malloc(MB_CHUNK);
+
+	if (!buf)
+		die("malloc");
+
+	if (in_fd >= 0)
+		close(in_fd);
+	in_fd = open(in_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (in_fd < 0)
+		die(in_path);
+
+	for (size_t off = 0; off < len; off += MB_CHUNK) {
+		size_t n = len - off < MB_CHUNK ? len - off : MB_CHUNK;
+
+		for (size_t i = 0; i < MB_CHUNK / 8; i++) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			buf[i] = x;
+		}
+		write_all(in_fd, buf, n);
+	}
+
+	if (fdatasync(in_fd))
+		die("fdatasync");
+	free(buf);
+}
+
+static const uint8_t *map_input(size_t len)
+{
+	void *p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, in_fd, 0);
+
+	if (p == MAP_FAILED)
+		die("mmap");
+	madvise(p, len, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+	return p;
+}
+
+static int open_output(void)
+{
+	int fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0)
+		die(out_path);
+
+	return fd;
+}
+
+/* Hashing, as input_digest() does it: over a mapping of the file */
+static int run_hash(int algo, size_t len)
+{
+	uint8_t digest[HASH_DIGEST_MAX];
+	const uint8_t *p = map_input(len);
+
+	hash_buffer(algo, p, len, len, digest);
+	munmap((void *)p, len);
+
+	return 0;
+}
+
+static int run_sha256(size_t len) { return run_hash(HASH_ALGO_SHA256, len); }
+static int run_sha384(size_t len) { return run_hash(HASH_ALGO_SHA384, len); }
+static int run_sha512(size_t len) { return run_hash(HASH_ALGO_SHA512, len); }
+static int run_sm3(size_t len) { return run_hash(HASH_ALGO_SM3, len); }
+
+/* The set_image_hash() pipeline before the hashes moved in-process */
+static int run_popen_dd(size_t len)
+{
+	char cmd[8192], line[256];
+	FILE *fp;
+
+	snprintf(cmd, sizeof(cmd), "cd '%s' && dd if=/dev/zero of=tmp_pad bs=%zu count=1 2>/dev/null;"
+		 "dd if='%s' of=tmp_pad conv=notrunc 2>/dev/null;"
+		 "sha256sum tmp_pad; rm -f tmp_pad", work_dir, len, in_path);
+
+	fp = popen(cmd, "r");
+	if (!fp)
+		die("popen");
+	if (!fgets(line, sizeof(line), fp) || strlen(line) < 64) {
+		fprintf(stderr, "microbench: no digest from '%s'\n", cmd);
+		exit(EXIT_FAILURE);
+	}
+	pclose(fp);
+
+	return 0;
+}
+
+/* CRC32: the dispatching entry point and the portable fallback alone */
+static int run_crc32(size_t len)
+{
+	const uint8_t *p = map_input(len);
+	volatile uint32_t crc = crc32_update(0, p, len);
+
+	(void)crc;
+	munmap((void *)p, len);
+
+	return 0;
+}
+
+static int run_crc32_slice8(size_t len)
+{
+	const uint8_t *p = map_input(len);
+	volatile uint32_t crc = ~crc32_slice8(~0U, p, len);
+
+	(void)crc;
+	munmap((void *)p, len);
+
+	return 0;
+}
+
+/* Padding: writing the zeros, leaving a hole, punching an existing range */
+static int run_zero_write(size_t len)
+{
+	static const uint8_t zeros[4096];
+	int fd = open_output();
+
+	for (size_t off = 0; off < len; off += sizeof(zeros))
+		write_all(fd, zeros, len - off < sizeof(zeros) ? len - off : sizeof(zeros));
+	close(fd);
+
+	return 0;
+}
+
+static int run_hole_seek(size_t len)
+{
+	int fd = open_output();
+
+	if (ftruncate(fd, len))
+		die("ftruncate");
+	close(fd);
+
+	return 0;
+}
+
+static void prep_punch(size_t len)
+{
+	run_zero_write(len);
+}
+
+static int run_punch(size_t len)
+{
+	int fd = open(out_path, O_RDWR);
+	int ret = 0;
+
+	if (fd < 0)
+		die(out_path);
+	if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, len))
+		ret = -1;
+	close(fd);
+
+	return ret;
+}
+
+/* Copying an image into the output */
+static int run_copy_rw(size_t len)
+{
+	uint8_t *buf = malloc(MB_CHUNK);
+	int fd = open_output();
+	ssize_t n;
+
+	if (!buf)
+		die("malloc");
+
+	lseek(in_fd, 0, SEEK_SET);
+	while ((n = read(in_fd, buf, MB_CHUNK)) > 0)
+		write_all(fd, buf, n);
+	if (n < 0)
+		die("read");
+
+	close(fd);
+	free(buf);
+
+	return 0;
+}
+
+static int run_copy_mmap(size_t len)
+{
+	const uint8_t *p = map_input(len);
+	int fd = open_output();
+
+	write_all(fd, p, len);
+	close(fd);
+	munmap((void *)p, len);
+
+	return 0;
+}
+
+static int run_copy_file_range(size_t len)
+{
+	int fd = open_output();
+	loff_t in_off = 0;
+	int ret = 0;
+
+	while (in_off < (loff_t)len) {
+		ssize_t n = copy_file_range(in_fd, &in_off, fd, NULL, len - in_off, 0);
+
+		if (n <= 0) {
+			ret = -1;
+			break;
+		}
+	}
+	close(fd);
+
+	return ret;
+}
+
+static int run_reflink(size_t len)
+{
+	int fd = open_output();
+	int ret = ioctl(fd, FICLONE, in_fd) ? -1 : 0;
+
+	close(fd);
+
+	return ret;
+}
+
+/* Header flattening of three full containers, output to /dev/null */
+static imx_header_v3_t mb_header;
+static size_t mb_flat_size;
+
+static void prep_flatten(size_t len)
+{
+	memset(&mb_header, 0, sizeof(mb_header));
+	for (int i = 0; i < MAX_NUM_OF_CONTAINER; i++) {
+		flash_header_v3_t *c = &mb_header.fhdr[i];
+
+		set_imx_hdr_v3(&mb_header, 0, 0, 0, i);
+		c->num_images = MAX_NUM_IMGS;
+		c->padding = 0x400;
+		for (int j = 0; j < MAX_NUM_IMGS; j++) {
+			c->img[j].offset = 0x2000 + j * 0x10000;
+			c->img[j].size = 0x10000;
+		}
+	}
+}
+
+static int run_flatten(size_t len)
+{
+	static int null_fd = -1;
+	int saved = dup(STDOUT_FILENO);
+	uint32_t size;
+	uint8_t *flat;
+
+	if (null_fd < 0)
+		null_fd = open("/dev/null", O_WRONLY);
+
+	fflush(stdout);
+	dup2(null_fd, STDOUT_FILENO);
+	flat = flatten_container_header(&mb_header, MAX_NUM_OF_CONTAINER, &size, 0);
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	mb_flat_size = size;
+	free(flat);
+
+	return 0;
+}
+
+static const mb_kernel_t kernels[] = {
+	{ "sha256",		run_sha256,		NULL,		true,	false },
+	{ "sha384",		run_sha384,		NULL,		true,	false },
+	{ "sha512",		run_sha512,		NULL,		true,	false },
+	{ "sm3",		run_sm3,		NULL,		true,	false },
+	{ "popen_dd_sha256",	run_popen_dd,		NULL,		true,	false },
+	{ "crc32",		run_crc32,		NULL,		true,	false },
+	{ "crc32_slice8",	run_crc32_slice8,	NULL,		true,	false },
+	{ "zero_write",		run_zero_write,		NULL,		false,	false },
+	{ "hole_seek",		run_hole_seek,		NULL,		false,	false },
+	{ "hole_punch",		run_punch,		prep_punch,	false,	false },
+	{ "copy_rw",		run_copy_rw,		NULL,		true,	false },
+	{ "copy_mmap",		run_copy_mmap,		NULL,		true,	false },
+	{ "copy_file_range",	run_copy_file_range,	NULL,		true,	false },
+	{ "copy_reflink",	run_reflink,		NULL,		true,	false },
+	{ "flatten",		run_flatten,		prep_flatten,	false,	true },
+};
+
+#define KERNEL_COUNT	(sizeof(kernels) / sizeof(kernels[0]))
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void bench_kernel(const mb_kernel_t *k, size_t len)
+{
+	uint64_t total = 0, median;
+	int iters = 0;
+
+	while (iters < MB_MAX_ITERS) {
+		uint64_t start;
+
+		if (cold && iters >= MB_COLD_ITERS)
+			break;
+		if (!cold && iters >= MB_MIN_ITERS && total >= MB_MIN_TIME_NS)
+			break;
+
+		if (k->prep)
+			k->prep(len);
+		if (cold)
+			posix_fadvise(in_fd, 0, 0, POSIX_FADV_DONTNEED);
+
+		start = now_ns();
+		if (k->run(len) < 0) {
+			printf("%-16s %10zu %5s %8s %12s %10s\n", k->name, len,
+			       cold ? "cold" : "hot", "-", "n/a", "n/a");
+			return;
+		}
+		samples[iters] = now_ns() - start;
+		total += samples[iters++];
+	}
+
+	if (k->fixed_size)
+		len = mb_flat_size;
+
+	qsort(samples, iters, sizeof(samples[0]), cmp_u64);
+	median = samples[iters / 2];
+	printf("%-16s %10zu %5s %8d %12.1f %10.1f\n", k->name, len,
+	       cold ? "cold" : "hot", iters, median / 1000.0,
+	       median ? len * 1000.0 / median : 0.0);
+	fflush(stdout);
+}
+
+static bool kernel_selected(const char *list, const char *name)
+{
+	size_t n = strlen(name);
+
+	if (!list)
+		return true;
+
+	for (const char *p = list; p; p = strchr(p, ',')) {
+		if (*p == ',')
+			p++;
+		if (!strncmp(p, name, n) && (p[n] == ',' || !p[n]))
+			return true;
+	}
+
+	return false;
+}
+
+static size_t parse_size(const char *val)
+{
+	char *end;
+	unsigned long long v = strtoull(val, &end, 0);
+
+	if (*end == 'K' || *end == 'k')
+		v <<= 10, end++;
+	else if (*end == 'M' || *end == 'm')
+		v <<= 20, end++;
+	if (end == val || *end || !v) {
+		fprintf(stderr, "microbench: invalid size '%s'\n", val);
+		exit(EXIT_FAILURE);
+	}
+
+	return v;
+}
+
+int main(int argc, char **argv)
+{
+	size_t min = 4 << 10, max = 256 << 20;
+	const char *list = NULL, *mode = "both";
+	int cpu = -1, c;
+	cpu_set_t set;
+
+	while ((c = getopt(argc, argv, "d:s:S:c:m:k:")) != -1) {
+		switch (c) {
+		case 'd':
+			work_dir = optarg;
+			break;
+		case 's':
+			min = parse_size(optarg);
+			break;
+		case 'S':
+			max = parse_size(optarg);
+			break;
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'm':
+			mode = optarg;
+			break;
+		case 'k':
+			list = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d DIR] [-s MIN] [-S MAX] [-c CPU] [-m hot|cold|both] [-k KERNEL,...]\n",
+				argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (strcmp(mode, "hot") && strcmp(mode, "cold") && strcmp(mode, "both")) {
+		fprintf(stderr, "microbench: -m must be hot, cold or both\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* One CPU for the whole run, the current one unless -c says otherwise */
+	if (cpu < 0)
+		cpu = sched_getcpu();
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set))
+		die("sched_setaffinity");
+
+	snprintf(in_path, sizeof(in_path), "%s/microbench.in", work_dir);
+	snprintf(out_path, sizeof(out_path), "%s/microbench.out", work_dir);
+
+	printf("pinned to CPU %d, latency is the median in us, throughput in MB/s\n", cpu);
+	printf("%-16s %10s %5s %8s %12s %10s\n", "kernel", "bytes", "cache", "iters", "us", "MB/s");
+
+	for (size_t len = min; len <= max; len *= 4) {
+		make_input(len);
+
+		for (unsigned int i = 0; i < KERNEL_COUNT; i++) {
+			const mb_kernel_t *k = &kernels[i];
+
+			if (!kernel_selected(list, k->name))
+				continue;
+			if (k->fixed_size && len != min)
+				continue;
+
+			if (strcmp(mode, "cold")) {
+				cold = false;
+				bench_kernel(k, len);
+			}
+			if (strcmp(mode, "hot") && k->file_input) {
+				cold = true;
+				bench_kernel(k, len);
+			}
+		}
+	}
+
+	unlink(in_path);
+	unlink(out_path);
+
+	return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * AES (FIPS-197) in CBC mode for encrypt=. x86: AES-NI. arm64: the ARMv8
+ * AESE/AESMC instructions. Otherwise a byte oriented implementation. CBC
+ * encryption chains every block on the one before it, so there are no
+ * independent lanes to interleave; the instructions are what pays off.
+ */
+
+#include <string.h>
+
+#include "aes.h"
+
+static const uint8_t aes_sbox[256] = {
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static const uint8_t aes_rcon[10] = {
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36,
+};
+
+void aes_setkey(aes_ctx_t *ctx, const uint8_t *key, size_t key_len)
+{
+	int nk = key_len / 4;
+	int words;
+
+	ctx->rounds = nk + 6;
+	words = 4 * (ctx->rounds + 1);
+	memcpy(ctx->rk, key, key_len);
+
+	for (int i = nk; i < words; i++) {
+		uint8_t t[4];
+
+		memcpy(t, ctx->rk + 4 * (i - 1), 4);
+		if (i % nk == 0) {
+			uint8_t t0 = t[0];
+
+			t[0] = aes_sbox[t[1]] ^ aes_rcon[i / nk - 1];
+			t[1] = aes_sbox[t[2]];
+			t[2] = aes_sbox[t[3]];
+			t[3] = aes_sbox[t0];
+		} else if (nk > 6 && i % nk == 4) {
+			for (int j = 0; j < 4; j++)
+				t[j] = aes_sbox[t[j]];
+		}
+		for (int j = 0; j < 4; j++)
+			ctx->rk[4 * i + j] = ctx->rk[4 * (i - nk) + j] ^ t[j];
+	}
+}
+
+static inline uint8_t aes_xtime(uint8_t a)
+{
+	return (a << 1) ^ ((a & 0x80) ? 0x1b : 0);
+}
+
+/* s is the state, column by column */
+static void aes_encrypt_block(const aes_ctx_t *ctx, uint8_t *s)
+{
+	const uint8_t *rk = ctx->rk;
+	uint8_t t[16];
+
+	for (int i = 0; i < 16; i++)
+		s[i] ^= rk[i];
+
+	for (int round = 1; round <= ctx->rounds; round++) {
+		/* SubBytes and ShiftRows, row r rotated left by r */
+		for (int c = 0; c < 4; c++) {
+			for (int r = 0; r < 4; r++)
+				t[4 * c + r] = aes_sbox[s[4 * ((c + r) & 3) + r]];
+		}
+
+		if (round == ctx->rounds) {
+			memcpy(s, t, 16);
+		} else {
+			for (int c = 0; c < 4; c++) {
+				uint8_t *a = t + 4 * c;
+				uint8_t x = a[0] ^ a[1] ^ a[2] ^ a[3];
+
+				s[4 * c + 0] = a[0] ^ x ^ aes_xtime(a[0] ^ a[1]);
+				s[4 * c + 1] = a[1] ^ x ^ aes_xtime(a[1] ^ a[2]);
+				s[4 * c + 2] = a[2] ^ x ^ aes_xtime(a[2] ^ a[3]);
+				s[4 * c + 3] = a[3] ^ x ^ aes_xtime(a[3] ^ a[0]);
+			}
+		}
+
+		rk += 16;
+		for (int i = 0; i < 16; i++)
+			s[i] ^= rk[i];
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+__attribute__((target("aes,sse2")))
+static void aes_cbc_aesni(const aes_ctx_t *ctx, uint8_t *iv, uint8_t *p, size_t len)
+{
+	__m128i rk[15], c;
+	int n = ctx->rounds;
+
+	for (int i = 0; i <= n; i++)
+		rk[i] = _mm_loadu_si128((const __m128i *)(ctx->rk + 16 * i));
+
+	c = _mm_loadu_si128((const __m128i *)iv);
+	for (; len; p += 16, len -= 16) {
+		c = _mm_xor_si128(c, _mm_loadu_si128((const __m128i *)p));
+		c = _mm_xor_si128(c, rk[0]);
+		for (int i = 1; i < n; i++)
+			c = _mm_aesenc_si128(c, rk[i]);
+		c = _mm_aesenclast_si128(c, rk[n]);
+		_mm_storeu_si128((__m128i *)p, c);
+	}
+	_mm_storeu_si128((__m128i *)iv, c);
+}
+
+static int aes_cbc_hw(const aes_ctx_t *ctx, uint8_t *iv, uint8_t *p, size_t len)
+{
+	static int has_aesni = -1;
+
+	if (has_aesni < 0) {
+		__builtin_cpu_init();
+		has_aesni = __builtin_cpu_supports("aes");
+	}
+
+	if (!has_aesni)
+		return 0;
+
+	aes_cbc_aesni(ctx, iv, p, len);
+	return 1;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_AES)
+#include <arm_neon.h>
+
+static int aes_cbc_hw(const aes_ctx_t *ctx, uint8_t *iv, uint8_t *p, size_t len)
+{
+	uint8x16_t rk[15], c;
+	int n = ctx->rounds;
+
+	for (int i = 0; i <= n; i++)
+		rk[i] = vld1q_u8(ctx->rk + 16 * i);
+
+	c = vld1q_u8(iv);
+	for (; len; p += 16, len -= 16) {
+		c = veorq_u8(c, vld1q_u8(p));
+		/* AESE is AddRoundKey, SubBytes and ShiftRows */
+		for (int i = 0; i < n - 1; i++)
+			c = vaesmcq_u8(vaeseq_u8(c, rk[i]));
+		c = veorq_u8(vaeseq_u8(c, rk[n - 1]), rk[n]);
+		vst1q_u8(p, c);
+	}
+	vst1q_u8(iv, c);
+
+	return 1;
+}
+
+#else
+
+static int aes_cbc_hw(const aes_ctx_t *ctx, uint8_t *iv, uint8_t *p, size_t len)
+{
+	return 0;
+}
+
+#endif
+
+void aes_cbc_encrypt(const aes_ctx_t *ctx, uint8_t *iv, uint8_t *data, size_t len)
+{
+	if (aes_cbc_hw(ctx, iv, data, len))
+		return;
+
+	for (; len; data += AES_BLOCK_SIZE, len -= AES_BLOCK_SIZE) {
+		for (int i = 0; i < AES_BLOCK_SIZE; i++)
+			data[i] ^= iv[i];
+		aes_encrypt_block(ctx, data);
+		memcpy(iv, data, AES_BLOCK_SIZE);
+	}
+}
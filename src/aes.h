@@ -0,0 +1,30 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * AES-CBC encryption of the images given encrypt=
+ */
+
+#ifndef __MKIMAGE_AES_H__
+#define __MKIMAGE_AES_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define AES_BLOCK_SIZE		16
+
+typedef struct {
+	int rounds;			/* 10, 12 or 14 */
+	uint8_t rk[16 * 15];		/* round keys, FIPS-197 byte order */
+} aes_ctx_t;
+
+/* key_len is 16, 24 or 32 bytes */
+void aes_setkey(aes_ctx_t *ctx, const uint8_t *key, size_t key_len);
+/*
+ * Encrypts data[0..len) in place, len a multiple of AES_BLOCK_SIZE. iv is
+ * updated to the last ciphertext block so a stream can be fed in pieces.
+ */
+void aes_cbc_encrypt(const aes_ctx_t *ctx, uint8_t *iv, uint8_t *data, size_t len);
+
+#endif /* __MKIMAGE_AES_H__ */
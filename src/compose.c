@@ -0,0 +1,324 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Build an image in memory from a list of parts. This replaces the
+ * objcopy --pad-to / cat / dd conv=sync / dd seek recipes used to glue
+ * SPL, DDR firmware and size headers together before they are handed to
+ * mkimage. The composed blob is referenced as '@name' wherever an image
+ * filename is expected.
+ */
+
+#include "mkimage_common.h"
+#include "aes.h"
+#include "hash.h"
+#include "lz4.h"
+#include "trace.h"
+
+#include <inttypes.h>
+
+#define MAX_MEM_IMAGES		8
+
+static mem_image_t mem_images[MAX_MEM_IMAGES];
+static int mem_image_count;
+
+mem_image_t *mem_image_find(const char *filename)
+{
+	if (!filename || filename[0] != MEM_IMAGE_PREFIX)
+		return NULL;
+
+	for (int i = 0; i < mem_image_count; i++) {
+		if (!strcmp(mem_images[i].name, filename + 1))
+			return &mem_images[i];
+	}
+
+	fprintf(stderr, "%s: no such composed image\n", filename);
+	exit(EXIT_FAILURE);
+}
+
+static mem_image_t *mem_image_new(const char *name)
+{
+	mem_image_t *m;
+
+	for (int i = 0; i < mem_image_count; i++) {
+		if (!strcmp(mem_images[i].name, name)) {
+			fprintf(stderr, "compose: image @%s defined twice\n", name);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (mem_image_count >= MAX_MEM_IMAGES) {
+		fprintf(stderr, "compose: too many composed images (max %d)\n",
+			MAX_MEM_IMAGES);
+		exit(EXIT_FAILURE);
+	}
+
+	m = &mem_images[mem_image_count++];
+	memset(m, 0, sizeof(*m));
+	m->name = strdup(name);
+
+	return m;
+}
+
+/* Grow the blob to new_size, filling the new bytes with fill */
+static void blob_extend(mem_image_t *m, size_t new_size, uint8_t fill)
+{
+	uint8_t *p;
+
+	if (new_size <= m->size)
+		return;
+
+	p = realloc(m->data, new_size);
+	if (!p) {
+		fprintf(stderr, "compose: failed to allocate %zu bytes\n", new_size);
+		exit(EXIT_FAILURE);
+	}
+
+	memset(p + m->size, fill, new_size - m->size);
+	m->data = p;
+	m->size = new_size;
+}
+
+static off_t file_size(const char *filename)
+{
+	input_t *in = input_get(filename);
+
+	input_set_composed(in);
+	return input_size(in);
+}
+
+static void blob_read_file(mem_image_t *m, const char *filename, size_t off)
+{
+	input_t *in = input_get(filename);
+	off_t size = input_size(in);
+
+	input_set_composed(in);
+	blob_extend(m, off + size, 0);
+	if (size)
+		memcpy(m->data + off, input_data(in), size);
+}
+
+static uint64_t compose_value(const char *spec, const char *val)
+{
+	char *end;
+	uint64_t v;
+
+	errno = 0;
+	v = strtoull(val, &end, 0);
+	if (errno || end == val || *end) {
+		fprintf(stderr, "compose: invalid value in '%s'\n", spec);
+		exit(EXIT_FAILURE);
+	}
+
+	return v;
+}
+
+/*
+ * A part is one command line token:
+ *
+ *   FILE[,opt...]        contents of FILE
+ *   size32=FILE[,opt...] 32-bit little endian size of FILE
+ *   align=N[,fill=B]     pad the blob composed so far to a multiple of N
+ *   pad=N[,fill=B]       pad the blob composed so far to N bytes
+ *
+ * Part options: at=OFF (fixed offset in the blob), pad=N (pad the part to
+ * N bytes), align=N (pad the part to a multiple of N), fill=B (byte used
+ * for padding and for the gap in front of a fixed offset part).
+ */
+static void compose_part(mem_image_t *m, const char *spec)
+{
+	char *tmp = strdup(spec);
+	char *tok, *saveptr;
+	char *filename = NULL;
+	bool size_hdr = false, blob_op = false;
+	uint64_t at = UINT64_MAX, pad = 0, align = 0;
+	uint8_t fill = 0;
+	size_t start, len;
+
+	for (tok = strtok_r(tmp, ",", &saveptr); tok;
+	     tok = strtok_r(NULL, ",", &saveptr)) {
+		char *eq = strchr(tok, '=');
+
+		if (!filename && !blob_op && !eq) {
+			filename = tok;
+		} else if (!filename && !blob_op && !strncmp(tok, "size32=", 7)) {
+			filename = tok + 7;
+			size_hdr = true;
+		} else if (!eq) {
+			fprintf(stderr, "compose: unexpected '%s' in '%s'\n", tok, spec);
+			exit(EXIT_FAILURE);
+		} else if (!strncmp(tok, "at=", 3)) {
+			at = compose_value(spec, eq + 1);
+		} else if (!strncmp(tok, "pad=", 4)) {
+			pad = compose_value(spec, eq + 1);
+		} else if (!strncmp(tok, "align=", 6)) {
+			align = compose_value(spec, eq + 1);
+			if (!align || (align & (align - 1))) {
+				fprintf(stderr, "compose: align must be a power of 2 in '%s'\n", spec);
+				exit(EXIT_FAILURE);
+			}
+		} else if (!strncmp(tok, "fill=", 5)) {
+			fill = compose_value(spec, eq + 1) & 0xFF;
+		} else {
+			fprintf(stderr, "compose: unknown option '%s' in '%s'\n", tok, spec);
+			exit(EXIT_FAILURE);
+		}
+
+		/* A leading option without a file applies to the whole blob */
+		if (!filename)
+			blob_op = true;
+	}
+
+	if (!filename && at != UINT64_MAX) {
+		fprintf(stderr, "compose: at= needs a file in '%s'\n", spec);
+		exit(EXIT_FAILURE);
+	}
+
+	start = filename ? m->size : 0;
+	if (at != UINT64_MAX) {
+		if (at < m->size) {
+			fprintf(stderr, "compose: '%s' at 0x%" PRIx64 " overlaps previous parts ending at 0x%zx\n",
+				spec, at, m->size);
+			exit(EXIT_FAILURE);
+		}
+		blob_extend(m, at, fill);
+		start = at;
+	}
+
+	if (size_hdr) {
+		uint32_t size = cpu_to_le32((uint32_t)file_size(filename));
+
+		blob_extend(m, start + sizeof(size), 0);
+		memcpy(m->data + start, &size, sizeof(size));
+	} else if (filename) {
+		blob_read_file(m, filename, start);
+	}
+
+	len = m->size - start;
+	if (pad) {
+		if (len > pad) {
+			fprintf(stderr, "compose: '%s' is 0x%zx bytes, larger than pad=0x%" PRIx64 "\n",
+				spec, len, pad);
+			exit(EXIT_FAILURE);
+		}
+		len = pad;
+	}
+	if (align)
+		len = ALIGN(len, align);
+	blob_extend(m, start + len, fill);
+
+	fprintf(stdout, "\t0x%08zx 0x%08zx %s\n", start, len, spec);
+	free(tmp);
+}
+
+void compose_image(char *name, int argc, char **argv, int *optind_p)
+{
+	mem_image_t *m = mem_image_new(name);
+
+	while (*optind_p < argc && *argv[*optind_p] != '-')
+		compose_part(m, argv[(*optind_p)++]);
+
+	if (!m->size) {
+		fprintf(stderr, "compose: @%s has no parts\n", name);
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stdout, "\t@%s size = 0x%zx\n", name, m->size);
+}
+
+/*
+ * Replace an image by its compressed copy, padded to 16 bytes like
+ * scripts/pad_image.sh does. The input file itself is left untouched.
+ * Returns the '@name' to use as the image filename.
+ */
+char *compress_image(char *filename, const char *method)
+{
+	mem_image_t raw = { 0 }, *m;
+	char *name;
+	uint8_t *data;
+	size_t size;
+
+	if (strcmp(method, "lz4hc") && strcmp(method, "lz4")) {
+		fprintf(stderr, "%s: unsupported compression '%s'\n", filename, method);
+		exit(EXIT_FAILURE);
+	}
+
+	name = malloc(strlen(filename) + sizeof("@.lz4"));
+	if (!name) {
+		fprintf(stderr, "compress: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	sprintf(name, "%c%s.lz4", MEM_IMAGE_PREFIX, filename);
+
+	/* The same payload may be listed in several containers */
+	for (int i = 0; i < mem_image_count; i++) {
+		if (!strcmp(mem_images[i].name, name + 1))
+			return name;
+	}
+
+	blob_read_file(&raw, filename, 0);
+	trace_begin("lz4", "compress", filename);
+	data = lz4_compress_frame(raw.data, raw.size, &size);
+	trace_end();
+
+	m = mem_image_new(name + 1);
+	m->data = data;
+	m->size = size;
+	blob_extend(m, ALIGN(size, 16), 0);
+
+	fprintf(stdout, "\tlz4: 0x%zx -> 0x%zx bytes\n", raw.size, m->size);
+	free(raw.data);
+
+	return name;
+}
+
+/*
+ * The DEK of encrypt=, 16, 24 or 32 raw bytes like CST's dek.bin. The
+ * payload is only encrypted as it is written, so a change to the DEK
+ * starts --watch over like one to a composed image part.
+ */
+char *encrypt_key(char *keyfile)
+{
+	input_t *key = input_get(keyfile);
+
+	input_set_composed(key);
+	if (input_size(key) != 16 && input_size(key) != 24 && input_size(key) != 32) {
+		fprintf(stderr, "%s: a DEK is 16, 24 or 32 bytes\n", keyfile);
+		exit(EXIT_FAILURE);
+	}
+
+	return keyfile;
+}
+
+/*
+ * AES-CBC encrypted copy of an image zero padded to size, its size in the
+ * container, a multiple of the AES block size. The IV field of the image
+ * array entry is the SHA-256 of the padded plain image, the second half of
+ * it is the CBC IV. The image hash stays the one of the plain image, what
+ * the ROM checks once decrypted. Returns the copy, to be freed.
+ */
+uint8_t *encrypt_image(const char *filename, const char *keyfile, size_t size)
+{
+	input_t *in = input_get(filename), *key = input_get(keyfile);
+	uint8_t iv[HASH_DIGEST_MAX];
+	aes_ctx_t ctx;
+	uint8_t *data;
+
+	data = calloc(1, size);
+	if (!data) {
+		fprintf(stderr, "encrypt: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(data, input_data(in), (size_t)input_size(in) < size ? (size_t)input_size(in) : size);
+	input_digest(in, HASH_ALGO_SHA256, size, iv);
+
+	trace_begin("aes", "encrypt", filename);
+	aes_setkey(&ctx, input_data(key), input_size(key));
+	aes_cbc_encrypt(&ctx, iv + AES_BLOCK_SIZE, data, size);
+	trace_end();
+
+	fprintf(stdout, "\taes-%d-cbc: %s 0x%zx bytes\n", (int) input_size(key) * 8, filename, size);
+
+	return data;
+}
@@ -0,0 +1,21 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * CRC-32 (ISO-HDLC, the zlib/uImage polynomial)
+ */
+
+#ifndef __MKIMAGE_CRC32_H__
+#define __MKIMAGE_CRC32_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Same convention as zlib crc32(): start with crc = 0 and feed the data in
+ * as many pieces as needed, passing the previous return value back in.
+ */
+uint32_t crc32_update(uint32_t crc, const void *buf, size_t len);
+
+#endif /* __MKIMAGE_CRC32_H__ */
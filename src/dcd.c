@@ -0,0 +1,520 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * DCD cfg compiler shared by the mkimage tools. The cfg is read once and
+ * tokenized in a single pass, keywords are looked up in a perfect hash
+ * table and hex fields are converted as they are scanned. Compiled tables can be
+ * kept in a cache directory keyed by the cfg contents, so that the many
+ * DDR timing variants built from unchanged cfgs are not parsed again.
+ */
+
+#include "mkimage_common.h"
+#include "dcd.h"
+#include "hash.h"
+
+#include <ctype.h>
+
+#define DCD_CACHE_MAGIC		0x43444344	/* "DCDC" */
+#define DCD_CACHE_VERSION	1
+#define DCD_CMD_HDR_LEN		4
+#define DCD_ENTRY_LEN		8
+
+enum dcd_fld {
+	FLD_COMMAND,
+	FLD_REG_SIZE,
+	FLD_REG_ADDRESS,
+	FLD_REG_VALUE
+};
+
+enum dcd_cmd {
+	CMD_INVALID,
+	CMD_IMAGE_VERSION,
+	CMD_BOOT_FROM,
+	CMD_BOOT_OFFSET,
+	CMD_WRITE_DATA,
+	CMD_WRITE_CLR_BIT,
+	CMD_WRITE_SET_BIT,
+	CMD_CHECK_BITS_SET,
+	CMD_CHECK_BITS_CLR,
+	CMD_CHECK_ANY_BIT_SET,
+	CMD_CHECK_ANY_BIT_CLR,
+	CMD_CSF,
+};
+
+typedef struct {
+	const char *name;
+	int cmd;
+	uint8_t tag;
+	uint8_t param;
+} dcd_keyword_t;
+
+/*
+ * Indexed by dcd_keyword(): length + first + last character, case
+ * folded, modulo 32 is collision free for the keywords below.
+ */
+#define DCD_KEYWORD_SLOTS	32
+
+static const dcd_keyword_t dcd_keywords[DCD_KEYWORD_SLOTS] = {
+	[24] = { "BOOT_FROM",		CMD_BOOT_FROM },
+	[1]  = { "BOOT_OFFSET",		CMD_BOOT_OFFSET },
+	[9]  = { "DATA",		CMD_WRITE_DATA,
+		 DCD_WRITE_DATA_COMMAND_TAG, DCD_WRITE_DATA_PARAM },
+	[30] = { "CLR_BIT",		CMD_WRITE_CLR_BIT,
+		 DCD_WRITE_DATA_COMMAND_TAG, DCD_WRITE_CLR_BIT_PARAM },
+	[14] = { "SET_BIT",		CMD_WRITE_SET_BIT,
+		 DCD_WRITE_DATA_COMMAND_TAG, DCD_WRITE_SET_BIT_PARAM },
+	[5]  = { "CHECK_BITS_SET",	CMD_CHECK_BITS_SET,
+		 DCD_CHECK_DATA_COMMAND_TAG, DCD_CHECK_BITS_SET_PARAM },
+	[3]  = { "CHECK_BITS_CLR",	CMD_CHECK_BITS_CLR,
+		 DCD_CHECK_DATA_COMMAND_TAG, DCD_CHECK_BITS_CLR_PARAM },
+	[8]  = { "CHECK_ANY_BIT_SET",	CMD_CHECK_ANY_BIT_SET,
+		 DCD_CHECK_DATA_COMMAND_TAG, DCD_CHECK_ANY_BIT_SET_PARAM },
+	[6]  = { "CHECK_ANY_BIT_CLR",	CMD_CHECK_ANY_BIT_CLR,
+		 DCD_CHECK_DATA_COMMAND_TAG, DCD_CHECK_ANY_BIT_CLR_PARAM },
+	[12] = { "CSF",			CMD_CSF },
+	[4]  = { "IMAGE_VERSION",	CMD_IMAGE_VERSION },
+};
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t max_entries;
+	uint32_t size;
+	dcd_info_t info;
+} dcd_cache_hdr_t;
+
+typedef struct {
+	const char *filename;
+	int lineno;
+	uint8_t *table;
+	size_t table_size;
+	uint32_t max_entries;
+	uint8_t version;	/* DCD header version */
+	uint32_t len;		/* bytes used in table */
+	uint8_t *cmd;		/* last command, NULL before the first one */
+	dcd_info_t info;
+} dcd_state_t;
+
+static const char *cache_dir;
+
+void dcd_set_cache_dir(const char *dir)
+{
+	cache_dir = dir;
+}
+
+static const dcd_keyword_t *dcd_keyword(const char *s, size_t len)
+{
+	const dcd_keyword_t *k;
+
+	k = &dcd_keywords[(len + tolower((unsigned char)s[0]) +
+			   tolower((unsigned char)s[len - 1])) % DCD_KEYWORD_SLOTS];
+	if (!k->name || strlen(k->name) != len || strncasecmp(k->name, s, len))
+		return NULL;
+
+	return k;
+}
+
+static uint32_t dcd_value(dcd_state_t *st, const char *s, size_t len)
+{
+	uint64_t v = 0;
+	size_t i = 0, digits = 0;
+
+	if (len > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+		i = 2;
+
+	for (; i < len && isxdigit((unsigned char)s[i]); i++, digits++) {
+		int c = tolower((unsigned char)s[i]);
+
+		v = (v << 4) | (c <= '9' ? c - '0' : c - 'a' + 10);
+	}
+
+	if (!digits || digits > 16) {
+		fprintf(stderr, "Error: %s[%d] - Invalid hex data(%.*s)\n",
+			st->filename, st->lineno, (int)len, s);
+		exit(EXIT_FAILURE);
+	}
+
+	return (uint32_t)v;
+}
+
+static void dcd_put(dcd_state_t *st, uint32_t len)
+{
+	if (st->len + len > st->table_size) {
+		fprintf(stderr, "Error: %s[%d] - DCD table exceeds %zu bytes\n",
+			st->filename, st->lineno, st->table_size);
+		exit(EXIT_FAILURE);
+	}
+	st->len += len;
+}
+
+/* Append one address/value pair, opening a new command when needed */
+static void dcd_entry(dcd_state_t *st, const dcd_keyword_t *k,
+		      uint32_t addr, uint32_t value)
+{
+	write_dcd_command_t *c = (write_dcd_command_t *)st->cmd;
+	uint32_t be;
+
+	if (++st->info.entries > st->max_entries) {
+		fprintf(stderr, "Error: %s[%d] -DCD table exceeds maximum size(%d)\n",
+			st->filename, st->lineno, st->max_entries);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Check data commands only support one entry */
+	if (!c || k->tag == DCD_CHECK_DATA_COMMAND_TAG ||
+	    c->tag != k->tag || c->param != k->param) {
+		st->cmd = st->table + st->len;
+		dcd_put(st, DCD_CMD_HDR_LEN);
+		c = (write_dcd_command_t *)st->cmd;
+		c->tag = k->tag;
+		c->length = cpu_to_be16(DCD_CMD_HDR_LEN);
+		c->param = k->param;
+	}
+
+	dcd_put(st, DCD_ENTRY_LEN);
+	be = cpu_to_be32(addr);
+	memcpy(st->table + st->len - DCD_ENTRY_LEN, &be, 4);
+	be = cpu_to_be32(value);
+	memcpy(st->table + st->len - 4, &be, 4);
+	c->length = cpu_to_be16(be16_to_cpu(c->length) + DCD_ENTRY_LEN);
+}
+
+static void dcd_parse(dcd_state_t *st, const char *p, const char *end)
+{
+	int version_first = ~0;
+
+	st->len = sizeof(ivt_header_t);
+	st->info.version = 0;
+	st->info.boot_offset = UNDEFINED;
+	st->info.csf_size = UNDEFINED;
+
+	while (p < end) {
+		const dcd_keyword_t *k = NULL;
+		uint32_t addr = 0;
+		int fld = FLD_COMMAND;
+
+		st->lineno++;
+
+		/* One line: whitespace separated fields, '#' starts a comment */
+		while (p < end && *p != '\n') {
+			const char *tok;
+			size_t len;
+
+			if (*p == ' ' || *p == '\t' || *p == '\r') {
+				p++;
+				continue;
+			}
+			if (*p == '#') {
+				while (p < end && *p != '\n')
+					p++;
+				break;
+			}
+
+			tok = p;
+			while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+				p++;
+			len = p - tok;
+
+			switch (fld++) {
+			case FLD_COMMAND:
+				k = dcd_keyword(tok, len);
+				if (!k) {
+					fprintf(stderr, "Error: %s[%d] - Invalid command(%.*s)\n",
+						st->filename, st->lineno, (int)len, tok);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case FLD_REG_SIZE:
+				switch (k->cmd) {
+				case CMD_IMAGE_VERSION:
+					st->info.version = dcd_value(st, tok, len);
+					if (version_first == 0) {
+						fprintf(stderr, "Error: %s[%d] - IMAGE_VERSION "
+							"command need be the first before other "
+							"valid command in the file\n",
+							st->filename, st->lineno);
+						exit(EXIT_FAILURE);
+					}
+					version_first = 1;
+					break;
+				case CMD_BOOT_OFFSET:
+					st->info.boot_offset = dcd_value(st, tok, len);
+					break;
+				case CMD_CSF:
+					if (st->info.version != 2) {
+						fprintf(stderr, "Error: %s[%d] - CSF only supported for VERSION 2(%.*s)\n",
+							st->filename, st->lineno, (int)len, tok);
+						exit(EXIT_FAILURE);
+					}
+					st->info.csf_size = dcd_value(st, tok, len);
+					break;
+				case CMD_BOOT_FROM:
+					break;
+				default:
+					/* register width, only 32-bit accesses are emitted */
+					dcd_value(st, tok, len);
+					break;
+				}
+				if (k->cmd != CMD_IMAGE_VERSION && k->cmd != CMD_BOOT_FROM &&
+				    version_first != 1)
+					version_first = 0;
+				break;
+			case FLD_REG_ADDRESS:
+				if (k->tag)
+					addr = dcd_value(st, tok, len);
+				break;
+			case FLD_REG_VALUE:
+				if (k->tag)
+					dcd_entry(st, k, addr, dcd_value(st, tok, len));
+				break;
+			default:
+				break;
+			}
+		}
+		p++;
+	}
+
+	((ivt_header_t *)st->table)->tag = DCD_HEADER_TAG;
+	((ivt_header_t *)st->table)->length = cpu_to_be16(st->len);
+	((ivt_header_t *)st->table)->version = st->version;
+}
+
+static char *dcd_cache_path(const uint8_t *cfg, size_t len, dcd_state_t *st)
+{
+	uint8_t digest[HASH_DIGEST_MAX];
+	hash_ctx_t ctx;
+	uint32_t key[3] = { DCD_CACHE_VERSION, st->max_entries, st->version };
+	char *path, *q;
+	size_t n;
+
+	hash_init(&ctx, HASH_ALGO_SHA256);
+	hash_update(&ctx, key, sizeof(key));
+	hash_update(&ctx, cfg, len);
+	n = hash_final(&ctx, digest);
+
+	path = malloc(strlen(cache_dir) + 2 * n + sizeof("/.dcd"));
+	if (!path) {
+		fprintf(stderr, "DCD: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	q = path + sprintf(path, "%s/", cache_dir);
+	for (size_t i = 0; i < n; i++)
+		q += sprintf(q, "%02x", digest[i]);
+	strcpy(q, ".dcd");
+
+	return path;
+}
+
+static bool dcd_cache_load(const char *path, dcd_state_t *st)
+{
+	dcd_cache_hdr_t hdr;
+	bool ok = false;
+	FILE *f;
+
+	f = fopen(path, "rb");
+	if (!f)
+		return false;
+
+	if (fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == DCD_CACHE_MAGIC &&
+	    hdr.version == DCD_CACHE_VERSION && hdr.max_entries == st->max_entries &&
+	    hdr.size <= st->table_size &&
+	    fread(st->table, 1, hdr.size, f) == hdr.size) {
+		st->len = hdr.size;
+		st->info = hdr.info;
+		ok = true;
+	}
+	fclose(f);
+
+	return ok;
+}
+
+/* Written under a temporary name and renamed, parallel builds may race */
+static void dcd_cache_store(const char *path, dcd_state_t *st)
+{
+	dcd_cache_hdr_t hdr = {
+		.magic = DCD_CACHE_MAGIC,
+		.version = DCD_CACHE_VERSION,
+		.max_entries = st->max_entries,
+		.size = st->len,
+		.info = st->info,
+	};
+	char *tmp = malloc(strlen(path) + 32);
+	FILE *f;
+
+	if (!tmp)
+		return;
+	sprintf(tmp, "%s.%d", path, (int)getpid());
+
+	mkdir(cache_dir, 0755);
+	f = fopen(tmp, "wb");
+	if (!f) {
+		fprintf(stderr, "DCD cache: %s: %s\n", tmp, strerror(errno));
+		free(tmp);
+		return;
+	}
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+	    fwrite(st->table, 1, st->len, f) != st->len ||
+	    fclose(f) || rename(tmp, path)) {
+		fprintf(stderr, "DCD cache: %s: %s\n", path, strerror(errno));
+		unlink(tmp);
+	}
+	free(tmp);
+}
+
+uint32_t dcd_compile(const char *filename, uint8_t version, void *table,
+		     size_t table_size, uint32_t max_entries, dcd_info_t *info)
+{
+	dcd_state_t st = {
+		.filename = filename,
+		.version = version,
+		.table = table,
+		.table_size = table_size,
+		.max_entries = max_entries,
+	};
+	struct stat sbuf;
+	char *cfg, *path = NULL;
+	int fd;
+
+	fd = open(filename, O_RDONLY | O_BINARY);
+	if (fd < 0 || fstat(fd, &sbuf) < 0) {
+		fprintf(stderr, "Error: %s - Can't open DCD file\n", filename);
+		exit(EXIT_FAILURE);
+	}
+
+	cfg = malloc(sbuf.st_size + 1);
+	if (!cfg || read(fd, cfg, sbuf.st_size) != sbuf.st_size) {
+		fprintf(stderr, "Error: %s - Can't read DCD file\n", filename);
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+
+	memset(table, 0, table_size);
+
+	if (cache_dir) {
+		path = dcd_cache_path((uint8_t *)cfg, sbuf.st_size, &st);
+		if (dcd_cache_load(path, &st)) {
+			fprintf(stderr, "DCD cache hit: %s\n", path);
+			goto out;
+		}
+	}
+
+	dcd_parse(&st, cfg, cfg + sbuf.st_size);
+
+	if (path)
+		dcd_cache_store(path, &st);
+out:
+	if (info)
+		*info = st.info;
+	free(path);
+	free(cfg);
+
+	return st.len;
+}
+
+typedef struct {
+	uint8_t tag;
+	uint8_t param;
+	uint32_t addr;		/* big endian, as stored in the table */
+	uint32_t value;
+	bool dead;
+} dcd_op_t;
+
+/*
+ * Only writes that are redundant whatever the hardware does are dropped: a
+ * DATA, CLR_BIT or SET_BIT entry directly followed by a DATA write of the
+ * same register, which overwrites it, or by the very same entry again.
+ * Anything in between, even a write of another register, keeps both: the
+ * register may be a command or unlock that the writes in between depend
+ * on (eg. DDRC SWCTL=0 ... SWCTL=1). The remaining entries are re-emitted
+ * in order with adjacent writes of the same kind merged into one command.
+ * CHECK commands keep their place, one entry each.
+ */
+uint32_t dcd_optimize(void *table)
+{
+	ivt_header_t *hdr = table;
+	uint8_t *p = (uint8_t *)table + sizeof(ivt_header_t);
+	uint8_t *end = (uint8_t *)table + be16_to_cpu(hdr->length);
+	uint32_t size_in = be16_to_cpu(hdr->length), size_out;
+	write_dcd_command_t *d = NULL;
+	int count = 0, dead = 0, cmds_in = 0, cmds_out = 0;
+	dcd_op_t *ops;
+
+	ops = calloc(size_in / DCD_ENTRY_LEN + 1, sizeof(*ops));
+	if (!ops) {
+		fprintf(stderr, "DCD optimizer: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	while (p + DCD_CMD_HDR_LEN < end) {
+		write_dcd_command_t *cmd = (write_dcd_command_t *)p;
+		int len = be16_to_cpu(cmd->length);
+
+		if (len < DCD_CMD_HDR_LEN)
+			break;
+
+		for (int i = 0; i < (len - DCD_CMD_HDR_LEN) / DCD_ENTRY_LEN; i++) {
+			uint8_t *e = p + DCD_CMD_HDR_LEN + i * DCD_ENTRY_LEN;
+
+			ops[count].tag = cmd->tag;
+			ops[count].param = cmd->param;
+			memcpy(&ops[count].addr, e, 4);
+			memcpy(&ops[count].value, e + 4, 4);
+			count++;
+		}
+		cmds_in++;
+		p += len;
+	}
+
+	for (int i = 0; i + 1 < count; i++) {
+		dcd_op_t *next = &ops[i + 1];
+
+		if (ops[i].tag != DCD_WRITE_DATA_COMMAND_TAG ||
+		    next->tag != DCD_WRITE_DATA_COMMAND_TAG ||
+		    next->addr != ops[i].addr)
+			continue;
+
+		if (next->param == DCD_WRITE_DATA_PARAM ||
+		    (next->param == ops[i].param && next->value == ops[i].value)) {
+			ops[i].dead = true;
+			dead++;
+		}
+	}
+
+	p = (uint8_t *)table + sizeof(ivt_header_t);
+	memset(p, 0, end - p);
+	for (int i = 0; i < count; i++) {
+		int len;
+
+		if (ops[i].dead)
+			continue;
+
+		if (!d || ops[i].tag == DCD_CHECK_DATA_COMMAND_TAG ||
+		    d->tag != ops[i].tag || d->param != ops[i].param) {
+			if (d)
+				p += be16_to_cpu(d->length);
+			d = (write_dcd_command_t *)p;
+			d->tag = ops[i].tag;
+			d->length = cpu_to_be16(DCD_CMD_HDR_LEN);
+			d->param = ops[i].param;
+			cmds_out++;
+		}
+
+		len = be16_to_cpu(d->length);
+		memcpy((uint8_t *)d + len, &ops[i].addr, 4);
+		memcpy((uint8_t *)d + len + 4, &ops[i].value, 4);
+		d->length = cpu_to_be16(len + DCD_ENTRY_LEN);
+	}
+	if (d)
+		p += be16_to_cpu(d->length);
+
+	size_out = p - (uint8_t *)table;
+	hdr->length = cpu_to_be16(size_out);
+
+	fprintf(stderr, "DCD optimizer: %d -> %d entries (%d dead writes), %d -> %d commands, %u -> %u bytes\n",
+		count, count - dead, dead, cmds_in, cmds_out, size_in, size_out);
+	free(ops);
+
+	return size_out;
+}
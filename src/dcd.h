@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * imximage style DCD cfg compiler
+ */
+
+#ifndef __MKIMAGE_DCD_H__
+#define __MKIMAGE_DCD_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+	uint32_t version;	/* IMAGE_VERSION, 0 when absent */
+	uint32_t boot_offset;	/* BOOT_OFFSET, UNDEFINED when absent */
+	uint32_t csf_size;	/* CSF, UNDEFINED when absent */
+	uint32_t entries;	/* address/value pairs in the table */
+} dcd_info_t;
+
+/*
+ * Compile a cfg file into a DCD table (header first with the given HAB
+ * version, big endian) of at most table_size bytes and max_entries
+ * address/value pairs. Returns the
+ * table length in bytes. With a cache directory set, the compiled table is
+ * looked up by the SHA-256 of the cfg contents first and stored there on a
+ * miss.
+ */
+uint32_t dcd_compile(const char *filename, uint8_t version, void *table,
+		     size_t table_size, uint32_t max_entries, dcd_info_t *info);
+
+/*
+ * Drop writes that are overwritten before any CHECK and merge adjacent
+ * commands of the same kind. Returns the new table length in bytes.
+ */
+uint32_t dcd_optimize(void *table);
+
+void dcd_set_cache_dir(const char *dir);
+
+#endif /* __MKIMAGE_DCD_H__ */
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Boot time model. A ROM read request costs a fixed command time, then the
+ * transfer of whole units (SD/eMMC blocks, NAND pages, FlexSPI bursts),
+ * each with a fixed setup time (NAND tR, FlexSPI command/address/dummy
+ * cycles) and its bytes at bus * clock * (ddr ? 2 : 1) bits per us. The
+ * defaults are nominal datasheet figures, pass measured ones for real
+ * numbers.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "estimate.h"
+#include "hash.h"
+
+typedef struct {
+	const char *dev;
+	double bus;		/* data lines */
+	double clk;		/* MHz */
+	double ddr;		/* 1 or 2 transfers per clock */
+	double unit;		/* transfer unit, bytes */
+	double unit_us;		/* setup per unit */
+	double cmd_us;		/* setup per read request */
+} estimate_dev_t;
+
+static const estimate_dev_t estimate_devs[] = {
+	/* SD high speed, CMD18 multi block reads */
+	{ "sd",		4, 50,  1, 512,   0,    50 },
+	/* eMMC HS52, 8 bit */
+	{ "emmc",	8, 52,  1, 512,   0,    50 },
+	/* quad SPI NOR, 256 byte IP command reads, 1S-4S-4S with 8 dummy cycles */
+	{ "flexspi",	4, 133, 1, 256,   0.3,  0 },
+	/* SLC NAND, 8 bit ONFI async at 20 MT/s, 4K pages */
+	{ "nand",	8, 20,  1, 4096,  25,   0 },
+};
+
+static estimate_dev_t model;
+/* MB/s per HASH_ALGO_*, ELE/SECO hash engine defaults */
+static double hash_mbps[] = { 200, 150, 150, 80 };
+static const char *hash_names[] = { "sha256", "sha384", "sha512", "sm3" };
+static double auth_us;
+
+static double estimate_number(const char *key, const char *val)
+{
+	char *end;
+	double v = strtod(val, &end);
+
+	if (end == val || *end || v < 0) {
+		fprintf(stderr, "-estimate: bad value for %s: %s\n", key, val);
+		exit(EXIT_FAILURE);
+	}
+
+	return v;
+}
+
+void estimate_model(const char *spec)
+{
+	char *s, *key, *save;
+	size_t i;
+
+	s = strdup(spec);
+	if (!s) {
+		fprintf(stderr, "-estimate: out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	key = strtok_r(s, ",", &save);
+	if (key && !strcmp(key, "emmc_fast"))
+		key = "emmc";
+	for (i = 0; key && i < sizeof(estimate_devs) / sizeof(estimate_devs[0]); i++) {
+		if (!strcmp(key, estimate_devs[i].dev))
+			break;
+	}
+	if (!key || i == sizeof(estimate_devs) / sizeof(estimate_devs[0])) {
+		fprintf(stderr, "-estimate: boot device must be sd, emmc, flexspi or nand\n");
+		exit(EXIT_FAILURE);
+	}
+	model = estimate_devs[i];
+
+	while ((key = strtok_r(NULL, ",", &save))) {
+		char *val = strchr(key, '=');
+		double v;
+
+		if (!val) {
+			fprintf(stderr, "-estimate: expected key=value: %s\n", key);
+			exit(EXIT_FAILURE);
+		}
+		*val++ = '\0';
+		v = estimate_number(key, val);
+
+		if (!strcmp(key, "bus"))
+			model.bus = v;
+		else if (!strcmp(key, "clk"))
+			model.clk = v;
+		else if (!strcmp(key, "ddr"))
+			model.ddr = v ? 2 : 1;
+		else if (!strcmp(key, "unit") || !strcmp(key, "page") || !strcmp(key, "burst"))
+			model.unit = v;
+		else if (!strcmp(key, "unit_us") || !strcmp(key, "tr"))
+			model.unit_us = v;
+		else if (!strcmp(key, "cmd_us"))
+			model.cmd_us = v;
+		else if (!strcmp(key, "auth_us"))
+			auth_us = v;
+		else {
+			for (i = 0; i < 4; i++) {
+				if (!strcmp(key, hash_names[i]))
+					break;
+			}
+			if (i == 4) {
+				fprintf(stderr, "-estimate: unknown key %s\n", key);
+				exit(EXIT_FAILURE);
+			}
+			hash_mbps[i] = v;
+		}
+	}
+
+	if (!model.bus || !model.clk || model.unit < 1) {
+		fprintf(stderr, "-estimate: bus, clk and unit must not be 0\n");
+		exit(EXIT_FAILURE);
+	}
+
+	free(s);
+}
+
+void estimate_print_model(FILE *f)
+{
+	fprintf(f, "Model:\t%s, %g bit %g MHz%s, %g byte units, %g us/unit, %g us/read\n",
+		model.dev, model.bus, model.clk, model.ddr > 1 ? " DDR" : "",
+		model.unit, model.unit_us, model.cmd_us);
+	fprintf(f, "Hash:\tsha256 %g MB/s, sha384 %g MB/s, sha512 %g MB/s, sm3 %g MB/s\n",
+		hash_mbps[0], hash_mbps[1], hash_mbps[2], hash_mbps[3]);
+}
+
+double estimate_read(uint64_t offset, uint64_t size, uint64_t *bytes)
+{
+	uint64_t unit = model.unit;
+	uint64_t first = offset / unit;
+	uint64_t last = (offset + size + unit - 1) / unit;
+	uint64_t span = (last - first) * unit;
+
+	if (bytes)
+		*bytes = span;
+	if (!size)
+		return 0;
+
+	return model.cmd_us + (last - first) * model.unit_us +
+		span * 8 / (model.bus * model.clk * model.ddr);
+}
+
+double estimate_hash(int algo, uint64_t size)
+{
+	if (algo < 0 || algo > HASH_ALGO_SM3 || !hash_mbps[algo])
+		return 0;
+
+	return size / hash_mbps[algo];
+}
+
+double estimate_auth(void)
+{
+	return auth_us;
+}
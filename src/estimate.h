@@ -0,0 +1,29 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Boot device and hash engine model of the ROM load, -estimate
+ */
+
+#ifndef __MKIMAGE_ESTIMATE_H__
+#define __MKIMAGE_ESTIMATE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* spec is "dev[,key=value...]", see -estimate in the README */
+void estimate_model(const char *spec);
+void estimate_print_model(FILE *f);
+
+/*
+ * Time in us to read size bytes at offset, in one ROM read request. bytes,
+ * if not NULL, gets what is transferred once rounded to blocks/pages/bursts.
+ */
+double estimate_read(uint64_t offset, uint64_t size, uint64_t *bytes);
+/* Time in us to hash size bytes with a HASH_ALGO_* */
+double estimate_hash(int algo, uint64_t size);
+/* Time in us to authenticate one signed container header */
+double estimate_auth(void);
+
+#endif /* __MKIMAGE_ESTIMATE_H__ */
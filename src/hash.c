@@ -0,0 +1,335 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Portable SHA-256, SHA-384, SHA-512 (FIPS 180-4) and SM3 (GB/T 32905)
+ * implementations. They replace the sha*sum/sm3sum helper processes
+ * for images that only exist in memory.
+ */
+
+#include <string.h>
+
+#include "hash.h"
+
+#define ROR32(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+#define ROL32(x, n)	(((x) << ((n) & 31)) | ((x) >> ((32 - ((n) & 31)) & 31)))
+#define ROR64(x, n)	(((x) >> (n)) | ((x) << (64 - (n))))
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint64_t sha512_k[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+static uint32_t get_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+	       ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t get_be64(const uint8_t *p)
+{
+	return ((uint64_t)get_be32(p) << 32) | get_be32(p + 4);
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void put_be64(uint8_t *p, uint64_t v)
+{
+	put_be32(p, v >> 32);
+	put_be32(p + 4, v);
+}
+
+static void sha256_block(uint32_t *s, const uint8_t *p)
+{
+	uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = get_be32(p + 4 * i);
+	for (; i < 64; i++) {
+		uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	a = s[0]; b = s[1]; c = s[2]; d = s[3];
+	e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+	for (i = 0; i < 64; i++) {
+		t1 = h + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) +
+		     ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+		t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) +
+		     ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	s[0] += a; s[1] += b; s[2] += c; s[3] += d;
+	s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+}
+
+static void sha512_block(uint64_t *s, const uint8_t *p)
+{
+	uint64_t w[80], a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = get_be64(p + 8 * i);
+	for (; i < 80; i++) {
+		uint64_t s0 = ROR64(w[i - 15], 1) ^ ROR64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+		uint64_t s1 = ROR64(w[i - 2], 19) ^ ROR64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	a = s[0]; b = s[1]; c = s[2]; d = s[3];
+	e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+	for (i = 0; i < 80; i++) {
+		t1 = h + (ROR64(e, 14) ^ ROR64(e, 18) ^ ROR64(e, 41)) +
+		     ((e & f) ^ (~e & g)) + sha512_k[i] + w[i];
+		t2 = (ROR64(a, 28) ^ ROR64(a, 34) ^ ROR64(a, 39)) +
+		     ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+
+	s[0] += a; s[1] += b; s[2] += c; s[3] += d;
+	s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+}
+
+#define SM3_P0(x)	((x) ^ ROL32((x), 9) ^ ROL32((x), 17))
+#define SM3_P1(x)	((x) ^ ROL32((x), 15) ^ ROL32((x), 23))
+
+static void sm3_block(uint32_t *s, const uint8_t *p)
+{
+	uint32_t w[68], a, b, c, d, e, f, g, h, ss1, ss2, tt1, tt2, t;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = get_be32(p + 4 * i);
+	for (; i < 68; i++)
+		w[i] = SM3_P1(w[i - 16] ^ w[i - 9] ^ ROL32(w[i - 3], 15)) ^
+		       ROL32(w[i - 13], 7) ^ w[i - 6];
+
+	a = s[0]; b = s[1]; c = s[2]; d = s[3];
+	e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+	for (i = 0; i < 64; i++) {
+		t = (i < 16) ? 0x79cc4519 : 0x7a879d8a;
+		ss1 = ROL32(ROL32(a, 12) + e + ROL32(t, i), 7);
+		ss2 = ss1 ^ ROL32(a, 12);
+		if (i < 16) {
+			tt1 = (a ^ b ^ c) + d + ss2 + (w[i] ^ w[i + 4]);
+			tt2 = (e ^ f ^ g) + h + ss1 + w[i];
+		} else {
+			tt1 = ((a & b) | (a & c) | (b & c)) + d + ss2 + (w[i] ^ w[i + 4]);
+			tt2 = ((e & f) | (~e & g)) + h + ss1 + w[i];
+		}
+		d = c; c = ROL32(b, 9); b = a; a = tt1;
+		h = g; g = ROL32(f, 19); f = e; e = SM3_P0(tt2);
+	}
+
+	s[0] ^= a; s[1] ^= b; s[2] ^= c; s[3] ^= d;
+	s[4] ^= e; s[5] ^= f; s[6] ^= g; s[7] ^= h;
+}
+
+static size_t hash_block_len(int algo)
+{
+	return (algo == HASH_ALGO_SHA384 || algo == HASH_ALGO_SHA512) ? 128 : 64;
+}
+
+size_t hash_digest_len(int algo)
+{
+	switch (algo) {
+	case HASH_ALGO_SHA384:
+		return 48;
+	case HASH_ALGO_SHA512:
+		return 64;
+	default:
+		return 32;
+	}
+}
+
+static void hash_block(hash_ctx_t *ctx, const uint8_t *p)
+{
+	switch (ctx->algo) {
+	case HASH_ALGO_SHA384:
+	case HASH_ALGO_SHA512:
+		sha512_block(ctx->state.s64, p);
+		break;
+	case HASH_ALGO_SM3:
+		sm3_block(ctx->state.s32, p);
+		break;
+	default:
+		sha256_block(ctx->state.s32, p);
+		break;
+	}
+}
+
+void hash_init(hash_ctx_t *ctx, int algo)
+{
+	static const uint32_t sha256_iv[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+	static const uint32_t sm3_iv[8] = {
+		0x7380166f, 0x4914b2b9, 0x172442d7, 0xda8a0600,
+		0xa96f30bc, 0x163138aa, 0xe38dee4d, 0xb0fb0e4e,
+	};
+	static const uint64_t sha384_iv[8] = {
+		0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+		0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL, 0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL,
+	};
+	static const uint64_t sha512_iv[8] = {
+		0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+		0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+	};
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->algo = algo;
+
+	switch (algo) {
+	case HASH_ALGO_SHA384:
+		memcpy(ctx->state.s64, sha384_iv, sizeof(sha384_iv));
+		break;
+	case HASH_ALGO_SHA512:
+		memcpy(ctx->state.s64, sha512_iv, sizeof(sha512_iv));
+		break;
+	case HASH_ALGO_SM3:
+		memcpy(ctx->state.s32, sm3_iv, sizeof(sm3_iv));
+		break;
+	default:
+		ctx->algo = HASH_ALGO_SHA256;
+		memcpy(ctx->state.s32, sha256_iv, sizeof(sha256_iv));
+		break;
+	}
+}
+
+void hash_update(hash_ctx_t *ctx, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t bl = hash_block_len(ctx->algo);
+
+	ctx->total += len;
+
+	if (ctx->buf_len) {
+		size_t n = bl - ctx->buf_len;
+
+		if (n > len)
+			n = len;
+		memcpy(ctx->buf + ctx->buf_len, p, n);
+		ctx->buf_len += n;
+		p += n;
+		len -= n;
+		if (ctx->buf_len < bl)
+			return;
+		hash_block(ctx, ctx->buf);
+		ctx->buf_len = 0;
+	}
+
+	while (len >= bl) {
+		hash_block(ctx, p);
+		p += bl;
+		len -= bl;
+	}
+
+	if (len) {
+		memcpy(ctx->buf, p, len);
+		ctx->buf_len = len;
+	}
+}
+
+void hash_update_zero(hash_ctx_t *ctx, size_t len)
+{
+	static const uint8_t zeros[4096];
+
+	while (len) {
+		size_t n = len > sizeof(zeros) ? sizeof(zeros) : len;
+
+		hash_update(ctx, zeros, n);
+		len -= n;
+	}
+}
+
+size_t hash_final(hash_ctx_t *ctx, uint8_t *digest)
+{
+	size_t bl = hash_block_len(ctx->algo);
+	size_t ll = (bl == 128) ? 16 : 8;	/* length field size */
+	uint64_t bits = ctx->total << 3;
+	size_t dlen = hash_digest_len(ctx->algo);
+	int i;
+
+	ctx->buf[ctx->buf_len++] = 0x80;
+	if (ctx->buf_len > bl - ll) {
+		memset(ctx->buf + ctx->buf_len, 0, bl - ctx->buf_len);
+		hash_block(ctx, ctx->buf);
+		ctx->buf_len = 0;
+	}
+	memset(ctx->buf + ctx->buf_len, 0, bl - ctx->buf_len);
+	/* upper bits of the 128-bit length are always zero here */
+	if (ll == 16)
+		put_be64(ctx->buf + bl - 16, ctx->total >> 61);
+	put_be64(ctx->buf + bl - 8, bits);
+	hash_block(ctx, ctx->buf);
+
+	if (bl == 128) {
+		for (i = 0; i < (int)(dlen / 8); i++)
+			put_be64(digest + 8 * i, ctx->state.s64[i]);
+	} else {
+		for (i = 0; i < 8; i++)
+			put_be32(digest + 4 * i, ctx->state.s32[i]);
+	}
+
+	return dlen;
+}
+
+size_t hash_buffer(int algo, const void *data, size_t len, size_t padded_len,
+		   uint8_t *digest)
+{
+	hash_ctx_t ctx;
+
+	hash_init(&ctx, algo);
+	hash_update(&ctx, data, len);
+	if (padded_len > len)
+		hash_update_zero(&ctx, padded_len - len);
+
+	return hash_final(&ctx, digest);
+}
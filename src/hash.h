@@ -0,0 +1,44 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * In-process message digests used for the image array hashes
+ */
+
+#ifndef __MKIMAGE_HASH_H__
+#define __MKIMAGE_HASH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HASH_ALGO_SHA256	0
+#define HASH_ALGO_SHA384	1
+#define HASH_ALGO_SHA512	2
+#define HASH_ALGO_SM3		3
+
+#define HASH_DIGEST_MAX		64
+#define HASH_BLOCK_MAX		128
+
+typedef struct {
+	int algo;
+	union {
+		uint32_t s32[8];	/* sha256, sm3 */
+		uint64_t s64[8];	/* sha384, sha512 */
+	} state;
+	uint64_t total;			/* bytes consumed so far */
+	uint8_t buf[HASH_BLOCK_MAX];
+	size_t buf_len;
+} hash_ctx_t;
+
+void hash_init(hash_ctx_t *ctx, int algo);
+void hash_update(hash_ctx_t *ctx, const void *data, size_t len);
+void hash_update_zero(hash_ctx_t *ctx, size_t len);
+size_t hash_final(hash_ctx_t *ctx, uint8_t *digest);
+size_t hash_digest_len(int algo);
+
+/* One shot digest of data[0..len) followed by (padded_len - len) zero bytes */
+size_t hash_buffer(int algo, const void *data, size_t len, size_t padded_len,
+		   uint8_t *digest);
+
+#endif /* __MKIMAGE_HASH_H__ */
@@ -7,6 +7,13 @@
  */
 
 #include "mkimage_common.h"
+#include "aes.h"
+#include "hash.h"
+#include "stats.h"
+#include "trace.h"
+#include "probes.h"
+#include "estimate.h"
+#include "sign.h"
 
 #include <inttypes.h>
 #include <stdio.h>
@@ -27,8 +34,8 @@
 #define IMG_FLAG_HASH_SHA512		0x200
 #define IMG_FLAG_HASH_SM3		0x300
 
-#define IMG_FLAG_ENCRYPTED_MASK		0x400
-#define IMG_FLAG_ENCRYPTED_SHIFT	0x0A
+#define IMG_FLAG_ENCRYPTED_MASK		0x800
+#define IMG_FLAG_ENCRYPTED_SHIFT	0x0B
 
 #define IMG_FLAG_BOOTFLAGS_MASK		0xFFFF0000
 #define IMG_FLAG_BOOTFLAGS_SHIFT	0x10
@@ -52,6 +59,7 @@
 #define DCD_ENTRY_ADDR_IN_SCFW		0x240
 
 #define CONTAINER_ALIGNMENT		0x400
+#define FLEXSPI_PREFETCH_SIZE		0x400
 #define CONTAINER_FUSE_DEFAULT		0x0
 
 #define SIGNATURE_BLOCK_HEADER_LENGTH	0x10
@@ -69,7 +77,7 @@
 #define HASH_TYPE_SHIFT	0x8
 #define HASH_TYPE_MASK	0x7
 
-#define IMAGE_ENCRYPTED_SHIFT	0x11
+#define IMAGE_ENCRYPTED_SHIFT	0x0B
 #define IMAGE_ENCRYPTED_MASK	0x1
 
 #define IMAGE_A35_DEFAULT_META(PART, SC_R_MU)	(((PART == 0 ) ? PARTITION_ID_AP : PART)  << BOOT_IMG_META_PART_ID_SHIFT |\
@@ -107,17 +115,6 @@ typedef struct {
 	uint16_t boot_flags;
 } img_flags_t;
 
-typedef struct {
-	uint8_t version;
-	uint16_t length;
-	uint8_t tag;
-	uint16_t srk_table_offset;
-	uint16_t cert_offset;
-	uint16_t blob_offset;
-	uint16_t signature_offset;
-	uint32_t reserved;
-} __attribute__((packed)) sig_blk_hdr_t;
-
 typedef struct {
 	uint32_t offset;
 	uint32_t size;
@@ -152,46 +149,27 @@ typedef struct {
 
 uint32_t custom_partition = 0;
 
+/* encrypt=, the DEK the images of each container share, or NULL */
+static const char *container_dek[MAX_NUM_OF_CONTAINER];
+
 static void copy_file_aligned (int ifd, const char *datafile, int offset, int align)
 {
-	int dfd;
-	struct stat sbuf;
-	unsigned char *ptr;
+	input_t *in = input_get(datafile);
+	const uint8_t *ptr;
 	uint8_t zeros[0x4000];
-	int size;
+	int size, len;
 	int ret;
 
-	if (align > 0x4000) {
-		fprintf (stderr, "Wrong alignment requested %d\n",
-			align);
-		exit (EXIT_FAILURE);
-	}
-
 	memset(zeros, 0, sizeof(zeros));
 
-	if ((dfd = open(datafile, O_RDONLY|O_BINARY)) < 0) {
-		fprintf (stderr, "Can't open %s: %s\n",
-			datafile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-
-	if (fstat(dfd, &sbuf) < 0) {
-		fprintf (stderr, "Can't stat %s: %s\n",
-			datafile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
+	size = input_size(in);
+	if (size == 0)
+		return;
 
-	if(sbuf.st_size == 0)
-		goto close;
+	stats_begin(STATS_COPY, datafile);
+	MKIMAGE_PROBE(copy__start, datafile, offset, size);
+	ptr = input_data(in);
 
-	ptr = mmap(0, sbuf.st_size, PROT_READ, MAP_SHARED, dfd, 0);
-	if (ptr == MAP_FAILED) {
-		fprintf (stderr, "Can't read %s: %s\n",
-			datafile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-
-	size = sbuf.st_size;
 	ret = lseek(ifd, offset, SEEK_SET);
 	if (ret < 0) {
 		fprintf(stderr, "%s: lseek error %s\n",
@@ -205,18 +183,45 @@ static void copy_file_aligned (int ifd, const char *datafile, int offset, int al
 		exit (EXIT_FAILURE);
 	}
 
+	stats_add(STATS_BYTES_WRITTEN, size);
+
 	align = ALIGN(size, align) - size;
 
-	if (write(ifd, (char *)&zeros, align) != align) {
-		fprintf(stderr, "Write error: %s\n",
-			strerror(errno));
-		exit(EXIT_FAILURE);
+	stats_begin(STATS_PAD, NULL);
+	for (int left = align; left > 0; left -= len) {
+		len = left < (int)sizeof(zeros) ? left : (int)sizeof(zeros);
+		if (write(ifd, (char *)&zeros, len) != len) {
+			fprintf(stderr, "Write error: %s\n",
+				strerror(errno));
+			exit(EXIT_FAILURE);
+		}
 	}
+	stats_add(STATS_BYTES_WRITTEN, align);
+	stats_add(STATS_ZERO_WRITTEN, align);
+	stats_end(STATS_PAD);
+	MKIMAGE_PROBE(copy__end, datafile, offset, size + align);
+	stats_end(STATS_COPY);
+}
+
+/* encrypt=, the image zero padded to len is written encrypted */
+static void copy_encrypted(int ofd, image_t *img, uint64_t len)
+{
+	uint8_t *data;
 
-	(void) munmap((void *)ptr, sbuf.st_size);
-close:
-	(void) close (dfd);
+	if (!len)
+		return;
 
+	stats_begin(STATS_COPY, img->filename);
+	MKIMAGE_PROBE(copy__start, img->filename, img->src, len);
+	data = encrypt_image(img->filename, img->dek, len);
+	if (pwrite(ofd, data, len, img->src) != (ssize_t)len) {
+		fprintf(stderr, "Write error %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	free(data);
+	stats_add(STATS_BYTES_WRITTEN, len);
+	MKIMAGE_PROBE(copy__end, img->filename, img->src, len);
+	stats_end(STATS_COPY);
 }
 
 static void set_imx_hdr_v3(imx_header_v3_t *imxhdr, uint32_t dcd_len,
@@ -231,32 +236,24 @@ static void set_imx_hdr_v3(imx_header_v3_t *imxhdr, uint32_t dcd_len,
 
 void set_image_hash(boot_img_t *img, char *filename, uint32_t hash_type)
 {
-	FILE *fp = NULL;
-	char sha_command[512];
-	char digest_type[10];
-	char hash[2 * HASH_MAX_LEN + 1];
-	int digest_length=0;
+	int algo;
 
 	switch(hash_type) {
 	case HASH_TYPE_SHA_256:
 		img->hab_flags |= IMG_FLAG_HASH_SHA256;
-		strcpy(digest_type, "sha256sum" );
-		digest_length = 64;
+		algo = HASH_ALGO_SHA256;
 		break;
 	case HASH_TYPE_SHA_384:
 		img->hab_flags |= IMG_FLAG_HASH_SHA384;
-		strcpy(digest_type, "sha384sum" );
-		digest_length = 96;
+		algo = HASH_ALGO_SHA384;
 		break;
 	case HASH_TYPE_SHA_512:
 		img->hab_flags |= IMG_FLAG_HASH_SHA512;
-		strcpy(digest_type, "sha512sum" );
-		digest_length = 128;
+		algo = HASH_ALGO_SHA512;
 		break;
 	case HASH_TYPE_SM3:
 		img->hab_flags |= IMG_FLAG_HASH_SM3;
-		strcpy(digest_type, "sm3sum" );
-		digest_length = 64;
+		algo = HASH_ALGO_SM3;
 		break;
 	default:
 		fprintf(stderr, "Wrong hash type selected (%d) !!!\n\n",
@@ -265,36 +262,22 @@ void set_image_hash(boot_img_t *img, char *filename, uint32_t hash_type)
 		break;
 	}
 
-	if (img->size == 0)
-		sprintf(sha_command, "%s /dev/null", digest_type);
-	else
-		sprintf(sha_command, "dd if=/dev/zero of=tmp_pad bs=%d count=1;\
-				dd if=\'%s\' of=tmp_pad conv=notrunc;\
-				%s tmp_pad; rm -f tmp_pad",
-			img->size, filename, digest_type);
-
+	/* The image is hashed zero padded to its size in the container */
+	stats_begin(STATS_HASH, filename);
 	memset(img->hash, 0, HASH_MAX_LEN);
-
-	fp = popen(sha_command, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "Failed to run command hash\n" );
-		exit(EXIT_FAILURE);
-	}
-
-	if(fgets(hash, digest_length + 1, fp) == NULL) {
-		fprintf(stderr, "Failed to hash file: %s\n", filename);
-		exit(EXIT_FAILURE);
-	}
-
-	for(int i = 0; i < strlen(hash)/2; i++){
-		sscanf(hash + 2*i, "%02hhx", &img->hash[i]);
-	}
-
-	pclose(fp);
+	input_digest(input_get(filename), algo, img->size, img->hash);
+	stats_end(STATS_HASH);
 }
 
 #define append(p, s, l) do {memcpy(p, (uint8_t *)s, l); p += l; } while (0)
 
+/* DEK blob the target makes for encrypt=, 72/80/88 bytes for AES-128/192/256 */
+static uint32_t dek_blob_size(int container)
+{
+	return container_dek[container] ?
+	       56 + input_size(input_get(container_dek[container])) : 0;
+}
+
 uint8_t *flatten_container_header(imx_header_v3_t *imx_header,
 					uint8_t containers_count,
 					uint32_t *size_out, uint32_t file_offset)
@@ -303,6 +286,9 @@ uint8_t *flatten_container_header(imx_header_v3_t *imx_header,
 	uint8_t *ptr = NULL;
 	uint16_t size = 0;
 
+	stats_begin(STATS_FLATTEN, NULL);
+	MKIMAGE_PROBE(flatten__start, containers_count);
+
 	/* Compute size of all container headers */
 	for (int i = 0; i < containers_count; i++) {
 
@@ -313,14 +299,19 @@ uint8_t *flatten_container_header(imx_header_v3_t *imx_header,
 
 		container->length = HEADER_IMG_ARRAY_OFFSET +
 			(IMG_ARRAY_ENTRY_SIZE * container->num_images) + sizeof(sig_blk_hdr_t);
+		if (sign_enabled()) {
+			container->flags = sign_container_flags(container->flags);
+			container->length += sign_block_size(dek_blob_size(i)) -
+					     sizeof(sig_blk_hdr_t);
+		}
 
 		/* Print info needed by CST to sign the container header */
 		fprintf(stdout, "CST: CONTAINER %d offset: 0x%x\n", i, file_offset + size);
 		fprintf(stdout, "CST: CONTAINER %d: Signature Block: offset is at 0x%x\n", i,
-						file_offset + size + container->length - SIGNATURE_BLOCK_HEADER_LENGTH);
+						file_offset + size + container->sig_blk_offset);
 
 		fprintf(stdout, "\tOffsets = \t0x%x \t0x%x\n", file_offset + size,
-						file_offset + size + container->length - SIGNATURE_BLOCK_HEADER_LENGTH);
+						file_offset + size + container->sig_blk_offset);
 
 		size += ALIGN(container->length, container->padding);
 	}
@@ -351,44 +342,38 @@ uint8_t *flatten_container_header(imx_header_v3_t *imx_header,
 			append(ptr, &container->img[j], sizeof(boot_img_t));
 		}
 
-		append(ptr, &container->sig_blk_hdr, sizeof(sig_blk_hdr_t));
+		if (sign_enabled()) {
+			sign_container(flat + container_start_offset, container->sig_blk_offset,
+				       dek_blob_size(i));
+			memcpy(&container->sig_blk_hdr, ptr, sizeof(sig_blk_hdr_t));
+			ptr += container->sig_blk_hdr.length;
+			if (container->sig_blk_hdr.blob_offset)
+				fprintf(stdout, "DEK blob: CONTAINER %d: 0x%x bytes at 0x%x\n", i,
+					dek_blob_size(i), file_offset + container_start_offset +
+					container->sig_blk_offset + container->sig_blk_hdr.blob_offset);
+		} else {
+			append(ptr, &container->sig_blk_hdr, sizeof(sig_blk_hdr_t));
+		}
 
 		/* Padding for container (if necessary) */
 		ptr += ALIGN(container->length, container->padding) - container->length;
 	}
 
+	MKIMAGE_PROBE(flatten__end, containers_count, size);
+	stats_end(STATS_FLATTEN);
 	return flat;
 }
 
 uint64_t read_dcd_offset(char *filename)
 {
-	int dfd;
-	struct stat sbuf;
-	uint8_t *ptr;
-	uint64_t offset = 0;
-
-	dfd = open(filename, O_RDONLY|O_BINARY);
-	if (dfd < 0) {
-		fprintf(stderr, "Can't open %s: %s\n", filename, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
-	if (fstat(dfd, &sbuf) < 0) {
-		fprintf(stderr, "Can't stat %s: %s\n", filename, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	uint32_t offset;
 
-	ptr = mmap(0, sbuf.st_size, PROT_READ, MAP_SHARED, dfd, 0);
-	if (ptr == MAP_FAILED) {
-		fprintf(stderr, "Can't read %s: %s\n", filename, strerror(errno));
+	if (input_read(input_get(filename), &offset, sizeof(offset),
+		       DCD_ENTRY_ADDR_IN_SCFW) != sizeof(offset)) {
+		fprintf(stderr, "%s: too small for a SCFW image\n", filename);
 		exit(EXIT_FAILURE);
 	}
 
-	offset = *(uint32_t *)(ptr + DCD_ENTRY_ADDR_IN_SCFW);
-
-	(void) munmap((void *)ptr, sbuf.st_size);
-	(void) close(dfd);
-
 	return offset;
 }
 
@@ -451,6 +436,12 @@ void set_image_array_entry(flash_header_v3_t *container, soc_type_t soc,
 		set_image_hash(img, tmp_filename, get_hash_algo(images_hash));
 	}
 
+	/* encrypt=, the payload is encrypted when written, see encrypt_image() */
+	if (image_stack->dek) {
+		input_digest(input_get(tmp_filename), HASH_ALGO_SHA256, size, img->iv);
+		img->hab_flags |= IMG_FLAG_ENCRYPTED_MASK;
+	}
+
 	switch(type) {
 	case SECO:
 		if (container->num_images > 0) {
@@ -670,7 +661,7 @@ int get_container_image_start_pos(image_t *image_stack, uint32_t align, soc_type
 {
 	image_t *img_sp = image_stack;
     /*8K total container header*/
-	int file_off = CONTAINER_IMAGE_ARRAY_START_OFFSET,  ofd = -1;
+	int file_off = CONTAINER_IMAGE_ARRAY_START_OFFSET;
 	flash_header_v3_t header;
 
 
@@ -678,24 +669,12 @@ int get_container_image_start_pos(image_t *image_stack, uint32_t align, soc_type
 		if (img_sp->option == APPEND) {
 			int i = 0;
 			do {
-				ofd = open(img_sp->filename, O_RDONLY);
-				if (ofd < 0) {
-					printf("Failure open first container file %s\n", img_sp->filename);
-					break;
-				}
-
-				if(lseek(ofd,  i * CONTAINER_ALIGNMENT, SEEK_SET) < 0) {
-					printf("Failure Skip SECO header \n");
-						exit(EXIT_FAILURE);
-				}
-
-				if(read(ofd, &header, sizeof(header)) != sizeof(header)) {
+				if (input_read(input_get(img_sp->filename), &header, sizeof(header),
+					       i * CONTAINER_ALIGNMENT) != sizeof(header)) {
 					printf("Failure Read header \n");
 					exit(EXIT_FAILURE);
 				}
 
-				close(ofd);
-
 				if (header.tag != IVT_HEADER_TAG_B0) {
 					printf("header tag missmatched %x\n", header.tag);
 					break;
@@ -720,9 +699,331 @@ int get_container_image_start_pos(image_t *image_stack, uint32_t align, soc_type
 }
 
 
+/* Payload alignment of an image, align= or -image_align, else the sector size */
+static uint32_t image_align(image_t *img, uint32_t sector_size)
+{
+	return img->align ? img->align : sector_size;
+}
+
+/*
+ * File offset of an xip= image. Its entry address is where it runs in the
+ * FlexSPI window at img->xip, and the output is programmed at ivt_offset in
+ * the flash. The offset must also sit on the AHB prefetch boundary, or the
+ * first fetches of every burst straddle two prefetch lines.
+ */
+static uint32_t xip_file_off(image_t *img, uint32_t ivt_offset, uint32_t sector_size)
+{
+	uint32_t align = sector_size > FLEXSPI_PREFETCH_SIZE ? sector_size : FLEXSPI_PREFETCH_SIZE;
+	uint64_t off;
+
+	if (img->entry < img->xip + ivt_offset) {
+		fprintf(stderr, "%s: XIP address 0x%" PRIx64 " is below FlexSPI base 0x%" PRIx64
+			" + 0x%x, where the first container is\n",
+			img->filename, img->entry, img->xip, ivt_offset);
+		exit(EXIT_FAILURE);
+	}
+
+	off = img->entry - img->xip - ivt_offset;
+	if (off != ALIGN(off, align)) {
+		fprintf(stderr, "%s: XIP address 0x%" PRIx64 " is at flash offset 0x%" PRIx64
+			", which is not aligned to 0x%x\n",
+			img->filename, img->entry, off + ivt_offset, align);
+		exit(EXIT_FAILURE);
+	}
+
+	return off;
+}
+
+/*
+ * With an explicit alignment anywhere, every image offset is aligned to its
+ * own alignment. Without, offsets stay as placed, as they always were.
+ */
+static bool stack_has_align(image_t *image_stack)
+{
+	for (image_t *img_sp = image_stack; img_sp->option != NO_IMG; img_sp++) {
+		if (img_sp->align)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Layout optimizer (-layout_opt)
+ *
+ * The container image arrays are left in command line order, which is the
+ * order the ROM and the SCFW process them in, only the payloads move. An
+ * image right after -fileoff or with xip= keeps its offset, a -hold stays
+ * glued to the image before it and SECO/SENTINEL stay in place. The other
+ * images are placed largest first in the lowest gap they fit in, so the
+ * holes left before -fileoff images get filled.
+ */
+typedef struct {
+	int first;		/* image stack index */
+	int last;		/* last -hold glued to it */
+	uint32_t orig;		/* offset in command line order */
+	uint32_t size;		/* including glued -hold regions */
+	uint32_t align;		/* 1 when offsets are not realigned */
+	uint32_t off;
+	bool pinned;
+} layout_group_t;
+
+static int layout_group_cmp(const void *a, const void *b)
+{
+	const layout_group_t *ga = a, *gb = b;
+
+	if (ga->pinned != gb->pinned)
+		return ga->pinned ? -1 : 1;
+	if (ga->size != gb->size)
+		return ga->size > gb->size ? -1 : 1;
+	return ga->first - gb->first;
+}
+
+/*
+ * Returns the file offset of every image stack entry, or NULL when command
+ * line order is already the smallest layout (or invalid, the build pass
+ * reports why).
+ */
+static uint32_t *plan_layout(image_t *image_stack, uint32_t start, uint32_t sector_size,
+			     uint32_t ivt_offset)
+{
+	layout_group_t *groups, *g;
+	uint32_t *plan, file_off = start, orig_end = start, new_end = start;
+	bool pin_next = false, glue = false, realign = stack_has_align(image_stack);
+	uint32_t align;
+	struct stat sbuf;
+	int count, n = 0, i, j;
+
+	for (count = 0; image_stack[count].option != NO_IMG; count++)
+		;
+
+	plan = calloc(count, sizeof(*plan));
+	groups = calloc(count, sizeof(*groups));
+	if (!plan || !groups) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* command line order, as the build pass computes it */
+	for (i = 0; i < count; i++) {
+		image_t *img_sp = &image_stack[i];
+		uint32_t size;
+		bool pinned = false;
+
+		align = 1;
+		plan[i] = file_off;
+
+		switch (img_sp->option) {
+		case FCB:
+		case OEI:
+		case AP:
+		case M4:
+		case M7:
+		case SCFW:
+		case DATA:
+		case UPOWER:
+		case MSG_BLOCK:
+		case SENTINEL:
+			check_file(&sbuf, img_sp->filename);
+			size = ALIGN(sbuf.st_size + img_sp->slack, image_align(img_sp, sector_size));
+			if (img_sp->xip) {
+				uint32_t xip_off = xip_file_off(img_sp, ivt_offset, sector_size);
+
+				if (file_off > xip_off)
+					goto keep;
+				file_off = xip_off;
+				plan[i] = file_off;
+				pin_next = true;
+			} else if (realign) {
+				align = image_align(img_sp, sector_size);
+				file_off = ALIGN(file_off, align);
+				plan[i] = file_off;
+			}
+			pinned = img_sp->option == SENTINEL;
+			break;
+		case SECO:
+			check_file(&sbuf, img_sp->filename);
+			size = sbuf.st_size;
+			pinned = true;
+			break;
+		case HOLD:
+			size = ALIGN(img_sp->entry, sector_size);
+			if (glue && !pin_next) {
+				groups[n - 1].last = i;
+				groups[n - 1].size += size;
+				file_off += size;
+				continue;
+			}
+			pinned = true;
+			break;
+		case FILEOFF:
+			if (file_off > img_sp->dst)
+				goto keep;
+			file_off = img_sp->dst;
+			pin_next = true;
+			glue = false;
+			continue;
+		case NEW_CONTAINER:
+			glue = false;
+			continue;
+		default:
+			continue;
+		}
+
+		g = &groups[n++];
+		g->first = g->last = i;
+		g->orig = file_off;
+		g->size = size;
+		g->align = align;
+		g->pinned = pinned || pin_next;
+		pin_next = false;
+		glue = true;
+		file_off += size;
+		if (file_off > orig_end)
+			orig_end = file_off;
+	}
+
+	/* pinned groups first, in stack order, then largest first */
+	qsort(groups, n, sizeof(*groups), layout_group_cmp);
+
+	for (i = 0; i < n; i++) {
+		g = &groups[i];
+		if (g->pinned) {
+			g->off = g->orig;
+		} else {
+			/* groups[0..i) are placed, sorted by offset below */
+			g->off = ALIGN(start, g->align);
+			for (j = 0; j < i; j++) {
+				if (g->off + g->size <= groups[j].off)
+					break;
+				if (groups[j].off + groups[j].size > g->off)
+					g->off = ALIGN(groups[j].off + groups[j].size, g->align);
+			}
+		}
+		if (g->off + g->size > new_end)
+			new_end = g->off + g->size;
+
+		/* keep the placed groups sorted by offset */
+		for (j = i; j > 0 && groups[j - 1].off > groups[j].off; j--) {
+			layout_group_t tmp = groups[j];
+
+			groups[j] = groups[j - 1];
+			groups[j - 1] = tmp;
+		}
+	}
+
+	if (new_end >= orig_end)
+		goto keep;
+
+	for (i = 0; i < n; i++) {
+		g = &groups[i];
+		for (j = g->first; j <= g->last; j++)
+			plan[j] += g->off - g->orig;
+	}
+	/* zero sized entries (V2X dummy) must not point past the new end */
+	for (i = 0; i < count; i++) {
+		if (image_stack[i].option == DUMMY_V2X && plan[i] > new_end)
+			plan[i] = new_end;
+	}
+
+	fprintf(stdout, "Layout optimizer: end 0x%x -> 0x%x, %u bytes saved\n",
+		orig_end, new_end, orig_end - new_end);
+	free(groups);
+	return plan;
+
+keep:
+	fprintf(stdout, "Layout optimizer: keeping command line order\n");
+	free(groups);
+	free(plan);
+	return NULL;
+}
+
+/* Bytes the output phase writes for an image stack entry, 0 for none */
+static uint64_t image_out_len(image_t *img, uint32_t sector_size)
+{
+	uint64_t size;
+
+	switch (img->option) {
+	case M4:
+	case AP:
+	case DATA:
+	case SCD:
+	case SCFW:
+	case SECO:
+	case MSG_BLOCK:
+	case UPOWER:
+	case SENTINEL:
+	case FCB:
+	case OEI:
+	case M7:
+		size = input_size(input_get(img->filename));
+		return size ? ALIGN(size, image_align(img, sector_size)) : 0;
+	case HOLD:
+		if (!img->filename || !strlen(img->filename))
+			return 0;
+		size = input_size(input_get(img->filename));
+		return size ? ALIGN(size, (uint64_t)sector_size) : 0;
+	case APPEND:
+	case APPEND_PAGE:
+		return input_size(input_get(img->filename));
+	default:
+		return 0;
+	}
+}
+
+/* What the last build left in the output, for --watch rebuilds */
+static struct {
+	bool built;
+	dev_t dev;
+	ino_t ino;
+	uint8_t *hdr;
+	uint32_t hdr_size;
+} last_out;
+
+/*
+ * In a rebuild, true when img is already in the output as it is now. If
+ * it is not and its slot shrank, the bytes past its new end are zeroed.
+ */
+static bool image_in_output(int ofd, image_t *img, uint64_t len, bool rebuild)
+{
+	static const uint8_t zeros[0x4000];
+
+	if (!rebuild)
+		return false;
+	if (img->out_gen == input_gen(input_get(img->filename)))
+		return true;
+
+	for (uint64_t off = len; off < img->out_len; ) {
+		size_t todo = img->out_len - off < sizeof(zeros) ? img->out_len - off : sizeof(zeros);
+
+		if (pwrite(ofd, zeros, todo, img->src + off) != (ssize_t)todo) {
+			fprintf(stderr, "Write error: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		stats_add(STATS_BYTES_WRITTEN, todo);
+		stats_add(STATS_ZERO_WRITTEN, todo);
+		off += todo;
+	}
+
+	return false;
+}
+
+/* Image stack step names, for the trace */
+static const char *option_names[] = {
+	[NO_IMG] = "none", [DCD] = "dcd", [SCFW] = "scfw", [SECO] = "seco",
+	[M4] = "m4", [M7] = "m7", [AP] = "ap", [OUTPUT] = "out", [SCD] = "scd",
+	[CSF] = "csf", [FLAG] = "flags", [DEVICE] = "dev",
+	[NEW_CONTAINER] = "container", [APPEND] = "append", [DATA] = "data",
+	[PARTITION] = "partition", [FILEOFF] = "fileoff", [MSG_BLOCK] = "msg_blk",
+	[DUMMY_V2X] = "dummy", [SENTINEL] = "sentinel", [UPOWER] = "upower",
+	[FCB] = "fcb", [OEI] = "oei", [MSEL] = "msel", [HOLD] = "hold",
+	[APPEND_PAGE] = "append_at_page",
+};
+
 int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_offset, char *out_file,
 				bool emmc_fastboot, image_t *image_stack, bool dcd_skip, uint8_t fuse_version,
-				uint16_t sw_version, uint32_t cntr_flags, char *images_hash)
+				uint16_t sw_version, uint32_t cntr_flags, char *images_hash,
+				bool layout_opt)
 {
 	int file_off, ofd = -1;
 	unsigned int dcd_len = 0;
@@ -737,8 +1038,15 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 
 	int container = -1;
 	int cont_img_count = 0; /* indexes to arrange the container */
+	uint32_t *layout = NULL, off, align;
+	bool realign = stack_has_align(image_stack);
+	uint64_t out_end;
+	bool rebuild;
 
+	stats_begin(STATS_LAYOUT, NULL);
 	memset((char *)&imx_header, 0, sizeof(imx_header_v3_t));
+	memset(container_dek, 0, sizeof(container_dek));
+	custom_partition = 0;
 
 	if (image_stack == NULL) {
 		fprintf(stderr, "Empty image stack ");
@@ -766,10 +1074,15 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 
 	printf("csf_off \t0x%x\n", ivt_offset + file_off);
 
+	if (layout_opt)
+		layout = plan_layout(image_stack, file_off, sector_size, ivt_offset);
+
 	/* step through image stack and generate the header */
 	img_sp = image_stack;
 
 	while (img_sp->option != NO_IMG) { /* stop once we reach null terminator */
+		trace_begin("image", option_names[img_sp->option], img_sp->filename);
+		off = layout ? layout[img_sp - image_stack] : (uint32_t)file_off;
 		switch (img_sp->option) {
 		case FCB:
 		case OEI:
@@ -787,17 +1100,50 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 			}
 			check_file(&sbuf, img_sp->filename);
 			tmp_filename = img_sp->filename;
+			align = image_align(img_sp, sector_size);
+			if (img_sp->xip) {
+				uint32_t xip_off = xip_file_off(img_sp, ivt_offset, sector_size);
+
+				if (file_off > xip_off) {
+					fprintf(stderr, "%s: XIP file offset 0x%x overlaps the images before it, which end at 0x%x\n",
+						img_sp->filename, xip_off, file_off);
+					exit(EXIT_FAILURE);
+				}
+				fprintf(stdout, "XIP: %s at 0x%" PRIx64 ", file offset 0x%x\n",
+					img_sp->filename, img_sp->entry, xip_off);
+				file_off = xip_off;
+				if (!layout)
+					off = file_off;
+			} else if (realign) {
+				file_off = ALIGN(file_off, align);
+				if (!layout)
+					off = file_off;
+			}
+			/* The ROM decrypts the image over its whole size in the container */
+			if (img_sp->dek && align % AES_BLOCK_SIZE) {
+				fprintf(stderr, "%s: encrypted, its alignment 0x%x must be a multiple of %d\n",
+					img_sp->filename, align, AES_BLOCK_SIZE);
+				exit(EXIT_FAILURE);
+			}
+			if (img_sp->dek && container_dek[container] &&
+			    strcmp(container_dek[container], img_sp->dek)) {
+				fprintf(stderr, "Error: %s: the images of a container share one DEK, not %s and %s\n",
+					img_sp->filename, container_dek[container], img_sp->dek);
+				exit(EXIT_FAILURE);
+			}
+			if (img_sp->dek)
+				container_dek[container] = img_sp->dek;
 			set_image_array_entry(&imx_header.fhdr[container],
 						soc,
 						img_sp,
-						file_off,
-						ALIGN(sbuf.st_size, sector_size),
+						off,
+						ALIGN(sbuf.st_size, align),
 						tmp_filename,
 						dcd_skip,
 						images_hash);
-			img_sp->src = file_off;
+			img_sp->src = off;
 
-			file_off += ALIGN(sbuf.st_size, sector_size);
+			file_off += ALIGN(sbuf.st_size + img_sp->slack, align);
 			cont_img_count++;
 			break;
 
@@ -810,12 +1156,12 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 			set_image_array_entry(&imx_header.fhdr[container],
 						soc,
 						img_sp,
-						file_off,
+						off,
 						0,
 						tmp_filename,
 						dcd_skip,
 						images_hash);
-			img_sp->src = file_off;
+			img_sp->src = off;
 
 			cont_img_count++;
 			break;
@@ -833,8 +1179,8 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 						img_sp->filename, sbuf.st_size, img_sp->entry);
 					exit(EXIT_FAILURE);
 				}
-				img_sp->src = file_off;
 			}
+			img_sp->src = off;
 			file_off += ALIGN(img_sp->entry, sector_size);
 			break;
 
@@ -848,12 +1194,12 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 			set_image_array_entry(&imx_header.fhdr[container],
 						soc,
 						img_sp,
-						file_off,
+						off,
 						sbuf.st_size,
 						tmp_filename,
 						dcd_skip,
 						"sha384");
-			img_sp->src = file_off;
+			img_sp->src = off;
 
 			file_off += sbuf.st_size;
 			cont_img_count++;
@@ -873,6 +1219,10 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 		case APPEND:
 			/* nothing to do here, the container is appended in the output */
 			break;
+		case APPEND_PAGE:
+			/* written after the images, at the next page boundary */
+			check_file(&sbuf, img_sp->filename);
+			break;
 		case FLAG:
 			/* override the flags for scfw in current container */
 			scfw_flags = img_sp->entry & 0xFFFF0000;/* mask off bottom 16 bits */
@@ -900,11 +1250,57 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 			fprintf(stderr, "unrecognized option in input stack (%d)\n", img_sp->option);
 			exit(EXIT_FAILURE);
 		}
+		trace_end();
 		img_sp++;/* advance index */
 	}
 
+	/* Note: Image offset are not contained in the image */
+	uint8_t *tmp = flatten_container_header(&imx_header, container + 1, &size, file_padding);
+
+	/* The signature blocks grow the headers, they must still end before the images */
+	for (img_sp = image_stack; sign_enabled() && img_sp->option != NO_IMG; img_sp++) {
+		if (img_sp->filename && img_sp->option != APPEND &&
+		    img_sp->option != APPEND_PAGE && img_sp->src < file_padding + size) {
+			fprintf(stderr, "Signed container headers end at 0x%x, past %s at 0x%" PRIx64 "\n",
+				file_padding + size, img_sp->filename, img_sp->src);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* End of the output, the containers to boot next go at the next page past it */
+	out_end = file_padding + size;
+	for (img_sp = image_stack; img_sp->option != NO_IMG; img_sp++) {
+		uint64_t len = image_out_len(img_sp, sector_size);
+
+		if (img_sp->option != APPEND_PAGE && len && img_sp->src + len > out_end)
+			out_end = img_sp->src + len;
+	}
+	for (img_sp = image_stack; img_sp->option != NO_IMG; img_sp++) {
+		uint64_t len = image_out_len(img_sp, sector_size);
+
+		if (img_sp->option != APPEND_PAGE)
+			continue;
+		img_sp->src = (out_end + img_sp->entry - 1) / img_sp->entry * img_sp->entry;
+		if (len)
+			out_end = img_sp->src + len;
+	}
+
+	/*
+	 * A --watch rebuild keeps the output when nothing moved and only
+	 * writes the images that changed, the headers if they did.
+	 */
+	rebuild = last_out.built && !stat(out_file, &sbuf) &&
+		  sbuf.st_dev == last_out.dev && sbuf.st_ino == last_out.ino;
+	for (img_sp = image_stack; rebuild && img_sp->option != NO_IMG; img_sp++) {
+		/* The appended container lies under the headers, all goes again */
+		if (img_sp->option == APPEND)
+			rebuild = img_sp->out_gen == input_gen(input_get(img_sp->filename));
+		else if (image_out_len(img_sp, sector_size) || img_sp->out_len)
+			rebuild = img_sp->out_gen && img_sp->out_src == img_sp->src;
+	}
+
 	/* Open output file */
-	ofd = open(out_file, O_RDWR|O_CREAT|O_TRUNC|O_BINARY, 0666);
+	ofd = open(out_file, O_RDWR|O_CREAT|(rebuild ? 0 : O_TRUNC)|O_BINARY, 0666);
 	if (ofd < 0) {
 		fprintf(stderr, "%s: Can't open: %s\n",
 				out_file, strerror(errno));
@@ -914,30 +1310,34 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 	/* Append container (if specified) */
 	img_sp = image_stack;
 	do {
-		if (img_sp->option == APPEND) {
+		if (img_sp->option == APPEND &&
+		    !image_in_output(ofd, img_sp, image_out_len(img_sp, sector_size), rebuild)) {
 			copy_file(ofd, img_sp->filename, 0, 0);
 		}
 		img_sp++;
 	} while (img_sp->option != NO_IMG);
 
-	/* Add padding or skip appended container */
-	ret = lseek(ofd, file_padding, SEEK_SET);
-	if (ret < 0) {
-		fprintf(stderr, "%s: lseek error %s\n",
-			__func__, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	if (!rebuild || size != last_out.hdr_size || memcmp(tmp, last_out.hdr, size)) {
+		/* Add padding or skip appended container */
+		ret = lseek(ofd, file_padding, SEEK_SET);
+		if (ret < 0) {
+			fprintf(stderr, "%s: lseek error %s\n",
+				__func__, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
 
-	/* Note: Image offset are not contained in the image */
-	uint8_t *tmp = flatten_container_header(&imx_header, container + 1, &size, file_padding);
-	/* Write image header */
-	if (write(ofd, tmp, size) != size) {
-		fprintf(stderr, "error writing image hdr\n");
-		exit(1);
+		/* Write image header */
+		if (write(ofd, tmp, size) != size) {
+			fprintf(stderr, "error writing image hdr\n");
+			exit(1);
+		}
+		stats_add(STATS_BYTES_WRITTEN, size);
 	}
 
-	/* Clean-up memory used by the headers */
-	free(tmp);
+	/* Kept to compare with the next rebuild's */
+	free(last_out.hdr);
+	last_out.hdr = tmp;
+	last_out.hdr_size = size;
 
 	if (emmc_fastboot)
 		ivt_offset = 0;/*set ivt offset to 0 if emmc */
@@ -945,6 +1345,13 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 	/* step through the image stack again this time copying images to final bin */
 	img_sp = image_stack;
 	while (img_sp->option != NO_IMG) { /* stop once we reach null terminator */
+		uint64_t len = image_out_len(img_sp, sector_size);
+
+		if ((len || img_sp->out_len) && image_in_output(ofd, img_sp, len, rebuild)) {
+			img_sp++;
+			continue;
+		}
+
 		switch (img_sp->option) {
 		case M4:
 		case AP:
@@ -958,7 +1365,11 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 		case FCB:
 		case OEI:
 		case M7:
-			copy_file_aligned(ofd, img_sp->filename, img_sp->src, sector_size);
+			if (img_sp->dek)
+				copy_encrypted(ofd, img_sp, len);
+			else
+				copy_file_aligned(ofd, img_sp->filename, img_sp->src,
+						  image_align(img_sp, sector_size));
 			break;
 		case HOLD:
 			/** in this case file is optional */
@@ -972,8 +1383,39 @@ int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_
 		img_sp++;
 	}
 
+	/* Place the containers to boot next, each at the next page past the end */
+	for (img_sp = image_stack; img_sp->option != NO_IMG; img_sp++) {
+		if (img_sp->option != APPEND_PAGE)
+			continue;
+		fprintf(stdout, "append %s at %" PRIu64 " KB, psize=%" PRIu64 "\n",
+			img_sp->filename, img_sp->src / 1024, img_sp->entry);
+		if (!image_in_output(ofd, img_sp, image_out_len(img_sp, sector_size), rebuild))
+			copy_file(ofd, img_sp->filename, 0, img_sp->src);
+	}
+
+	/* Whatever followed the images last time goes */
+	if (rebuild && ftruncate(ofd, out_end) < 0) {
+		fprintf(stderr, "%s: Can't truncate: %s\n", out_file, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	for (img_sp = image_stack; img_sp->option != NO_IMG; img_sp++) {
+		img_sp->out_len = image_out_len(img_sp, sector_size);
+		img_sp->out_src = img_sp->src;
+		img_sp->out_gen = img_sp->out_len ? input_gen(input_get(img_sp->filename)) : 0;
+	}
+	if (fstat(ofd, &sbuf) < 0) {
+		fprintf(stderr, "%s: Can't stat: %s\n", out_file, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	last_out.built = true;
+	last_out.dev = sbuf.st_dev;
+	last_out.ino = sbuf.st_ino;
+
 	/* Close output file */
 	close(ofd);
+	free(layout);
+	stats_end(STATS_LAYOUT);
 	return 0;
 }
 
@@ -1260,6 +1702,12 @@ void print_image_array_fields(flash_header_v3_t *container_hdrs, soc_type_t soc,
 
 			fprintf(stdout, " (%s)\n", hash_name);
 
+			if (img_flags.encrypted) {
+				fprintf(stdout, "IV: ");
+				for (int i = 0; i < IV_MAX_LEN; i++)
+					fprintf(stdout, "%02x", img.iv[i]);
+				fprintf(stdout, "\n");
+			}
 		}
 		fprintf(stdout, "\n");
 	}
@@ -1427,6 +1875,7 @@ int extract_container_images(flash_header_v3_t *container_hdr, char *ifname, int
 			/* first get the image offset and size from the container header */
 			img_offset = container_hdr->img[j].offset;
 			img_size = container_hdr->img[j].size;
+			MKIMAGE_PROBE(extract__image, i, j, img_offset, img_size);
 
 			if (!img_size) { /* check for images with zero size (DDR Init) */
 				continue;
@@ -1537,22 +1986,16 @@ int extract_container_images(flash_header_v3_t *container_hdr, char *ifname, int
 	return 0;
 }
 
-int parse_container_hdrs_qx_qm_b0(char *ifname, bool extract, soc_type_t soc, off_t file_off)
+/* Reads the ROM loaded containers starting at file_off, returns how many */
+static int read_container_hdrs(int ifd, off_t file_off, int max_containers,
+			       flash_header_v3_t *container_headers)
 {
-	int ifd; /* container file descriptor */
-	int max_containers = (soc == DXL) ? 3 : 2;
 	int cntr_num = 0; /* number of containers in binary */
 	int img_array_entries = 0; /* number of images in container */
 	ssize_t rd_err;
-	flash_header_v3_t container_headers[MAX_NUM_OF_CONTAINER];
-	flash_header_v3_t app_container_header;
-	int app_cntr_off;
 
 	/* initialize region of memory where flash header will be stored */
-	memset((void *)container_headers, 0, sizeof(container_headers));
-
-	/* open container binary */
-	ifd = open(ifname, O_RDONLY|O_BINARY);
+	memset((void *)container_headers, 0, max_containers * sizeof(*container_headers));
 
 	if (file_off) /* inital offset within container binary */
 		lseek(ifd, file_off, SEEK_SET);
@@ -1576,6 +2019,8 @@ int parse_container_hdrs_qx_qm_b0(char *ifname, bool extract, soc_type_t soc, of
 			exit(EXIT_FAILURE);
 		}
 
+		MKIMAGE_PROBE(parse__container, cntr_num, container_headers[cntr_num].num_images);
+
 		/* compute the size of the image array */
 		img_array_entries = container_headers[cntr_num].num_images * sizeof(boot_img_t);
 
@@ -1604,6 +2049,22 @@ int parse_container_hdrs_qx_qm_b0(char *ifname, bool extract, soc_type_t soc, of
 		cntr_num++;
 	}
 
+	return cntr_num;
+}
+
+int parse_container_hdrs_qx_qm_b0(char *ifname, bool extract, soc_type_t soc, off_t file_off)
+{
+	int ifd; /* container file descriptor */
+	int max_containers = (soc == DXL) ? 3 : 2;
+	int cntr_num = 0; /* number of containers in binary */
+	flash_header_v3_t container_headers[MAX_NUM_OF_CONTAINER];
+	flash_header_v3_t app_container_header;
+	int app_cntr_off;
+
+	/* open container binary */
+	ifd = open(ifname, O_RDONLY|O_BINARY);
+
+	cntr_num = read_container_hdrs(ifd, file_off, max_containers, container_headers);
 
 	print_container_hdr_fields(container_headers, cntr_num, soc, false);
 
@@ -1623,3 +2084,204 @@ int parse_container_hdrs_qx_qm_b0(char *ifname, bool extract, soc_type_t soc, of
 	return 0;
 
 }
+
+/*
+ * -estimate: predicted ROM time for the containers the ROM loads itself
+ * (not the app container, SPL loads that), per container header and image,
+ * in the order the ROM processes them: header, signature, then each image
+ * loaded and hashed.
+ */
+int estimate_boot_qx_qm_b0(char *ifname, soc_type_t soc, off_t file_off)
+{
+	static const char *hash_names[] = { "sha256", "sha384", "sha512", "sm3" };
+	static const int hash_algos[] = {
+		HASH_ALGO_SHA256, HASH_ALGO_SHA384, HASH_ALGO_SHA512, HASH_ALGO_SM3
+	};
+	int max_containers = (soc == DXL) ? 3 : 2;
+	flash_header_v3_t container_headers[MAX_NUM_OF_CONTAINER];
+	double load_total = 0, verify_total = 0;
+	uint64_t read_total = 0, bytes;
+	off_t cntr_off = file_off;
+	int ifd, cntr_num;
+
+	ifd = open(ifname, O_RDONLY|O_BINARY);
+	if (ifd < 0) {
+		fprintf(stderr, "%s: Can't open: %s\n", ifname, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	cntr_num = read_container_hdrs(ifd, file_off, max_containers, container_headers);
+	close(ifd);
+
+	if (!cntr_num) {
+		fprintf(stderr, "%s: no container found at 0x%lx\n", ifname, (long)file_off);
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stdout, "\nBoot time estimate: %s\n", ifname);
+	estimate_print_model(stdout);
+	fprintf(stdout, "%-14s %10s %10s %10s %8s %12s %12s\n",
+		"", "offset", "size", "read", "hash", "load us", "verify us");
+
+	for (int i = 0; i < cntr_num; i++) {
+		flash_header_v3_t *hdr = &container_headers[i];
+		uint32_t len = hdr->length;
+		double load, verify = 0;
+		char name[32];
+
+		/* header, image array and signature block in one read */
+		if (hdr->sig_blk_offset && hdr->sig_blk_offset + hdr->sig_blk_hdr.length > len)
+			len = hdr->sig_blk_offset + hdr->sig_blk_hdr.length;
+		load = estimate_read(cntr_off, len, &bytes);
+		if (hdr->sig_blk_hdr.signature_offset)
+			verify = estimate_auth();
+		fprintf(stdout, "%-14s %#10lx %#10x %#10" PRIx64 " %8s %12.1f %12.1f\n",
+			"container", (long)cntr_off, len, bytes, "", load, verify);
+		load_total += load;
+		verify_total += verify;
+		read_total += bytes;
+
+		for (int j = 0; j < hdr->num_images; j++) {
+			boot_img_t *img = &hdr->img[j];
+			int h = (img->hab_flags >> 8) & 0x3;
+
+			if (!img->size) /* DCD, V2X dummy: nothing to load */
+				continue;
+
+			load = estimate_read(cntr_off + img->offset, img->size, &bytes);
+			verify = estimate_hash(hash_algos[h], img->size);
+			snprintf(name, sizeof(name), "  image %d.%d", i, j);
+			fprintf(stdout, "%-14s %#10lx %#10x %#10" PRIx64 " %8s %12.1f %12.1f\n",
+				name, (long)(cntr_off + img->offset), img->size, bytes,
+				hash_names[h], load, verify);
+			load_total += load;
+			verify_total += verify;
+			read_total += bytes;
+		}
+
+		cntr_off += ALIGN(hdr->length, CONTAINER_ALIGNMENT);
+	}
+
+	fprintf(stdout, "%-14s %10s %10s %#10" PRIx64 " %8s %12.1f %12.1f\n",
+		"total", "", "", read_total, "", load_total, verify_total);
+	fprintf(stdout, "ROM load + verify: %.3f ms\n", (load_total + verify_total) / 1000);
+
+	return 0;
+}
+
+/*
+ * Region map (-erase_block, -region_map): the erase blocks each part of the
+ * output covers and a digest of their contents. A field update compares
+ * the maps of the running and the new image and only erases and rewrites
+ * the blocks of the rows whose digest differs.
+ */
+static void region_digest(int fd, uint64_t start, uint64_t end, char *hex)
+{
+	uint8_t buf[0x10000], digest[HASH_DIGEST_MAX];
+	hash_ctx_t ctx;
+	size_t n;
+
+	hash_init(&ctx, HASH_ALGO_SHA256);
+	while (start < end) {
+		ssize_t len = pread(fd, buf, end - start < sizeof(buf) ? end - start : sizeof(buf), start);
+
+		if (len < 0) {
+			fprintf(stderr, "region map: read error %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (!len) {	/* past the end, blocks read back erased to 0 here */
+			hash_update_zero(&ctx, end - start);
+			break;
+		}
+		hash_update(&ctx, buf, len);
+		start += len;
+	}
+	n = hash_final(&ctx, digest);
+	for (size_t i = 0; i < n; i++)
+		hex += sprintf(hex, "%02x", digest[i]);
+}
+
+static void region_row(FILE *map, int fd, uint32_t block, const char *name,
+		       uint64_t offset, uint64_t size, uint64_t slot)
+{
+	uint64_t first = offset / block;
+	uint64_t last = (ALIGN(offset + slot, block) - 1) / block;
+	char hex[2 * HASH_DIGEST_MAX + 1];
+
+	region_digest(fd, first * block, (last + 1) * block, hex);
+	fprintf(map, "%6" PRIu64 " %6" PRIu64 " %#10" PRIx64 " %#10" PRIx64 " %#10" PRIx64 " %s %s\n",
+		first, last, offset, size, slot, hex, name);
+}
+
+int write_region_map(char *out_file, image_t *image_stack, uint32_t block, char *map_file)
+{
+	uint64_t first_image = UINT64_MAX;
+	struct stat sbuf;
+	FILE *map;
+	int fd;
+
+	fd = open(out_file, O_RDONLY|O_BINARY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: Can't open: %s\n", out_file, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	map = fopen(map_file, "w");
+	if (!map) {
+		fprintf(stderr, "%s: Can't open: %s\n", map_file, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	for (image_t *img_sp = image_stack; img_sp->option != NO_IMG; img_sp++) {
+		if (img_sp->filename && img_sp->option != APPEND && img_sp->src < first_image)
+			first_image = img_sp->src;
+	}
+	fstat(fd, &sbuf);
+	if (first_image == UINT64_MAX)
+		first_image = sbuf.st_size;
+
+	fprintf(map, "# %s, erase block 0x%x, sha256 of the blocks of each row\n",
+		out_file, block);
+	fprintf(map, "# %4s %6s %10s %10s %10s %-64s %s\n",
+		"first", "last", "offset", "size", "slot", "sha256", "name");
+
+	/* appended containers and the container headers */
+	region_row(map, fd, block, "headers", 0, first_image, first_image);
+
+	for (image_t *img_sp = image_stack; img_sp->option != NO_IMG; img_sp++) {
+		uint64_t size;
+
+		switch (img_sp->option) {
+		case FCB:
+		case OEI:
+		case AP:
+		case M4:
+		case M7:
+		case SCFW:
+		case DATA:
+		case UPOWER:
+		case MSG_BLOCK:
+		case SENTINEL:
+		case SECO:
+			check_file(&sbuf, img_sp->filename);
+			size = sbuf.st_size;
+			break;
+		case HOLD:
+			size = img_sp->entry;
+			break;
+		case APPEND_PAGE:
+			check_file(&sbuf, img_sp->filename);
+			size = sbuf.st_size;
+			break;
+		default:
+			continue;
+		}
+
+		region_row(map, fd, block, img_sp->filename ? img_sp->filename : option_names[img_sp->option],
+			   img_sp->src, size, size + img_sp->slack);
+	}
+
+	fclose(map);
+	close(fd);
+	fprintf(stdout, "Region map:\t%s\n", map_file);
+
+	return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Registry of the input files of one run. Every file is opened and
+ * stat'ed once, mapped once when its contents are first needed, and its
+ * digests are kept so that an image listed twice is only hashed once.
+ * Composed '@name' images go through the same interface. With --watch a
+ * file is reloaded when it changes on disk, which drops its digests.
+ */
+
+#include "mkimage_common.h"
+#include "hash.h"
+#include "stats.h"
+#include "probes.h"
+
+#define INPUT_DIGESTS		4
+
+typedef struct {
+	int algo;
+	size_t padded_len;
+	size_t len;
+	uint8_t digest[HASH_DIGEST_MAX];
+} input_digest_t;
+
+struct input {
+	struct input *next;
+	char *name;
+	int fd;
+	struct stat sbuf;
+	unsigned int gen;
+	bool composed;
+	mem_image_t *mem;
+	uint8_t *map;
+	input_digest_t digests[INPUT_DIGESTS];
+	int digest_count;
+};
+
+static input_t *inputs;
+
+input_t *input_get(const char *filename)
+{
+	input_t *in;
+
+	for (in = inputs; in; in = in->next) {
+		if (!strcmp(in->name, filename))
+			return in;
+	}
+
+	in = calloc(1, sizeof(*in));
+	if (!in) {
+		fprintf(stderr, "%s: out of memory\n", filename);
+		exit(EXIT_FAILURE);
+	}
+	in->name = strdup(filename);
+	in->fd = -1;
+	in->gen = 1;
+
+	in->mem = mem_image_find(filename);
+	if (in->mem) {
+		in->sbuf.st_size = in->mem->size;
+	} else {
+		in->fd = open(filename, O_RDONLY | O_BINARY);
+		if (in->fd < 0) {
+			fprintf(stderr, "%s: Can't open: %s\n",
+				filename, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+
+		if (fstat(in->fd, &in->sbuf) < 0) {
+			fprintf(stderr, "%s: Can't stat: %s\n",
+				filename, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	in->next = inputs;
+	inputs = in;
+
+	MKIMAGE_PROBE(input__open, in->name, (long long)in->sbuf.st_size);
+
+	return in;
+}
+
+const struct stat *input_stat(input_t *in)
+{
+	return &in->sbuf;
+}
+
+off_t input_size(input_t *in)
+{
+	return in->sbuf.st_size;
+}
+
+/* Contents of the input, NULL if it is empty (eg. /dev/null) */
+const uint8_t *input_data(input_t *in)
+{
+	if (in->mem)
+		return in->mem->data;
+
+	if (in->map || !in->sbuf.st_size)
+		return in->map;
+
+	in->map = mmap(0, in->sbuf.st_size, PROT_READ, MAP_SHARED, in->fd, 0);
+	if (in->map == MAP_FAILED) {
+		fprintf(stderr, "Can't read %s: %s\n", in->name, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	stats_add(STATS_BYTES_READ, in->sbuf.st_size);
+
+	/* Images are copied and hashed front to back, start reading ahead */
+	(void) madvise(in->map, in->sbuf.st_size, MADV_SEQUENTIAL);
+	(void) madvise(in->map, in->sbuf.st_size, MADV_WILLNEED);
+
+	return in->map;
+}
+
+/* Read up to len bytes at off without mapping the file, returns the count */
+size_t input_read(input_t *in, void *buf, size_t len, off_t off)
+{
+	size_t done = 0;
+
+	if (off >= in->sbuf.st_size)
+		return 0;
+	if (len > in->sbuf.st_size - off)
+		len = in->sbuf.st_size - off;
+
+	if (in->mem || in->map) {
+		memcpy(buf, input_data(in) + off, len);
+		return len;
+	}
+
+	stats_add(STATS_BYTES_READ, len);
+
+	while (done < len) {
+		ssize_t ret = pread(in->fd, (uint8_t *)buf + done, len - done, off + done);
+
+		if (ret < 0) {
+			fprintf(stderr, "%s: read error: %s\n", in->name, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (!ret)
+			break;
+		done += ret;
+	}
+
+	return done;
+}
+
+/* Digest of the input zero padded to padded_len bytes */
+size_t input_digest(input_t *in, int algo, size_t padded_len, uint8_t *digest)
+{
+	input_digest_t *d;
+
+	for (int i = 0; i < in->digest_count; i++) {
+		d = &in->digests[i];
+		if (d->algo == algo && d->padded_len == padded_len) {
+			MKIMAGE_PROBE(digest__hit, in->name, algo);
+			memcpy(digest, d->digest, d->len);
+			return d->len;
+		}
+	}
+
+	MKIMAGE_PROBE(digest__miss, in->name, algo);
+	d = &in->digests[in->digest_count % INPUT_DIGESTS];
+	if (in->digest_count < INPUT_DIGESTS)
+		in->digest_count++;
+
+	d->algo = algo;
+	d->padded_len = padded_len;
+	MKIMAGE_PROBE(hash__start, in->name, padded_len, algo);
+	d->len = hash_buffer(algo, input_data(in), input_size(in), padded_len, d->digest);
+	MKIMAGE_PROBE(hash__end, in->name, padded_len, algo);
+	stats_add(STATS_BYTES_HASHED, padded_len > input_size(in) ? padded_len : input_size(in));
+	memcpy(digest, d->digest, d->len);
+
+	return d->len;
+}
+
+/* Iterate over the inputs opened so far, in = NULL gets the first one */
+input_t *input_next(input_t *in)
+{
+	return in ? in->next : inputs;
+}
+
+const char *input_name(input_t *in)
+{
+	return in->name;
+}
+
+/* Bumped each time the file is reloaded */
+unsigned int input_gen(input_t *in)
+{
+	return in->gen;
+}
+
+/* The input is a part of a composed '@name' image rather than an image */
+void input_set_composed(input_t *in)
+{
+	in->composed = true;
+}
+
+bool input_composed(input_t *in)
+{
+	return in->composed;
+}
+
+bool input_is_file(input_t *in)
+{
+	return !in->mem;
+}
+
+/*
+ * Reopen the file if it is no longer the one opened (replaced, resized or
+ * modified since). Returns true when it was reloaded. A file that can't be
+ * opened right now, eg. half way through being replaced, is left as is.
+ */
+bool input_reload(input_t *in)
+{
+	struct stat sbuf;
+	int fd;
+
+	if (in->mem || stat(in->name, &sbuf) < 0)
+		return false;
+
+	if (sbuf.st_dev == in->sbuf.st_dev && sbuf.st_ino == in->sbuf.st_ino &&
+	    sbuf.st_size == in->sbuf.st_size &&
+	    sbuf.st_mtim.tv_sec == in->sbuf.st_mtim.tv_sec &&
+	    sbuf.st_mtim.tv_nsec == in->sbuf.st_mtim.tv_nsec)
+		return false;
+
+	fd = open(in->name, O_RDONLY | O_BINARY);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &sbuf) < 0) {
+		close(fd);
+		return false;
+	}
+
+	if (in->map)
+		munmap(in->map, in->sbuf.st_size);
+	close(in->fd);
+	in->map = NULL;
+	in->fd = fd;
+	in->sbuf = sbuf;
+	in->digest_count = 0;
+	in->gen++;
+
+	MKIMAGE_PROBE(input__open, in->name, (long long)in->sbuf.st_size);
+
+	return true;
+}
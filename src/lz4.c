@@ -0,0 +1,404 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * LZ4 frame encoder with a hash chain (HC) match finder.
+ *
+ * The frame is split into independent blocks so that every block can be
+ * compressed by its own thread; the decoders used by U-Boot and OP-TEE
+ * only support independent blocks anyway. See the LZ4 frame and block
+ * format descriptions in the lz4 project for the on-disk layout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "lz4.h"
+#include "trace.h"
+
+#define LZ4_MAGIC		0x184D2204
+#define LZ4_FLG_VERSION		(1 << 6)
+#define LZ4_FLG_BLOCK_INDEP	(1 << 5)
+#define LZ4_FLG_CONTENT_CSUM	(1 << 2)
+#define LZ4_BD_256KB		(5 << 4)
+#define LZ4_BLOCK_SIZE		(256 * 1024)
+#define LZ4_BLOCK_UNCOMPRESSED	0x80000000U
+
+#define MINMATCH		4
+#define MFLIMIT			12	/* last match must start this far from the end */
+#define LASTLITERALS		5	/* last bytes of a block are always literals */
+#define MAX_DISTANCE		65535
+#define ML_BITS			4
+#define ML_MASK			((1U << ML_BITS) - 1)
+#define RUN_MASK		((1U << (8 - ML_BITS)) - 1)
+
+#define HC_HASH_LOG		15
+#define HC_CHAIN_SIZE		65536
+#define HC_MAX_ATTEMPTS		256	/* same search depth as lz4 -9 */
+
+#define MAX_THREADS		64
+
+/* xxHash32, used for the frame descriptor and content checksums */
+#define XXH_PRIME32_1		0x9E3779B1U
+#define XXH_PRIME32_2		0x85EBCA77U
+#define XXH_PRIME32_3		0xC2B2AE3DU
+#define XXH_PRIME32_4		0x27D4EB2FU
+#define XXH_PRIME32_5		0x165667B1U
+
+static inline uint32_t rotl32(uint32_t x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t read_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void write_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static inline uint32_t xxh32_round(uint32_t acc, uint32_t input)
+{
+	acc += input * XXH_PRIME32_2;
+	acc = rotl32(acc, 13);
+	return acc * XXH_PRIME32_1;
+}
+
+static uint32_t xxh32(const uint8_t *p, size_t len, uint32_t seed)
+{
+	const uint8_t *end = p + len;
+	uint32_t h;
+
+	if (len >= 16) {
+		const uint8_t *limit = end - 16;
+		uint32_t v1 = seed + XXH_PRIME32_1 + XXH_PRIME32_2;
+		uint32_t v2 = seed + XXH_PRIME32_2;
+		uint32_t v3 = seed;
+		uint32_t v4 = seed - XXH_PRIME32_1;
+
+		do {
+			v1 = xxh32_round(v1, read_le32(p));
+			v2 = xxh32_round(v2, read_le32(p + 4));
+			v3 = xxh32_round(v3, read_le32(p + 8));
+			v4 = xxh32_round(v4, read_le32(p + 12));
+			p += 16;
+		} while (p <= limit);
+
+		h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+	} else {
+		h = seed + XXH_PRIME32_5;
+	}
+
+	h += (uint32_t)len;
+
+	while (p + 4 <= end) {
+		h += read_le32(p) * XXH_PRIME32_3;
+		h = rotl32(h, 17) * XXH_PRIME32_4;
+		p += 4;
+	}
+
+	while (p < end) {
+		h += (*p++) * XXH_PRIME32_5;
+		h = rotl32(h, 11) * XXH_PRIME32_1;
+	}
+
+	h ^= h >> 15;
+	h *= XXH_PRIME32_2;
+	h ^= h >> 13;
+	h *= XXH_PRIME32_3;
+	h ^= h >> 16;
+
+	return h;
+}
+
+typedef struct {
+	uint32_t hash[1 << HC_HASH_LOG];	/* last position + 1, 0 = empty */
+	uint16_t chain[HC_CHAIN_SIZE];		/* distance to previous position */
+} hc_tables_t;
+
+static inline uint32_t hc_hash(const uint8_t *p)
+{
+	return (read_le32(p) * 2654435761U) >> (32 - HC_HASH_LOG);
+}
+
+static void hc_insert(hc_tables_t *t, const uint8_t *base, uint32_t *next, uint32_t target)
+{
+	uint32_t pos;
+
+	for (pos = *next; pos < target; pos++) {
+		uint32_t h = hc_hash(base + pos);
+		uint32_t delta = t->hash[h] ? pos - (t->hash[h] - 1) : 0;
+
+		if (delta > MAX_DISTANCE)
+			delta = 0;
+		t->chain[pos & (HC_CHAIN_SIZE - 1)] = delta;
+		t->hash[h] = pos + 1;
+	}
+
+	*next = target;
+}
+
+/* Longest match for base[pos..] ending no later than base[match_end] */
+static uint32_t hc_find(hc_tables_t *t, const uint8_t *base, uint32_t *next,
+			uint32_t pos, uint32_t match_end, uint32_t *ref)
+{
+	uint32_t best = 0;
+	uint32_t cand;
+	int attempts = HC_MAX_ATTEMPTS;
+
+	hc_insert(t, base, next, pos);
+
+	cand = t->hash[hc_hash(base + pos)];
+	if (!cand)
+		return 0;
+	cand--;
+
+	while (attempts-- > 0 && pos - cand <= MAX_DISTANCE) {
+		if (base[cand + best] == base[pos + best] &&
+		    read_le32(base + cand) == read_le32(base + pos)) {
+			uint32_t len = MINMATCH;
+
+			while (pos + len < match_end && base[cand + len] == base[pos + len])
+				len++;
+			if (len > best) {
+				best = len;
+				*ref = cand;
+				if (pos + len >= match_end)
+					break;
+			}
+		}
+
+		uint16_t delta = t->chain[cand & (HC_CHAIN_SIZE - 1)];
+
+		if (!delta || delta > cand)
+			break;
+		cand -= delta;
+	}
+
+	return best;
+}
+
+static uint8_t *lz4_put_length(uint8_t *op, uint32_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+
+	return op;
+}
+
+static uint8_t *lz4_put_sequence(uint8_t *op, const uint8_t *lit, uint32_t lit_len,
+				 uint32_t offset, uint32_t match_len)
+{
+	uint8_t *token = op++;
+
+	if (lit_len >= RUN_MASK) {
+		*token = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, lit_len - RUN_MASK);
+	} else {
+		*token = lit_len << ML_BITS;
+	}
+
+	memcpy(op, lit, lit_len);
+	op += lit_len;
+
+	if (!match_len)
+		return op;	/* last literals */
+
+	*op++ = offset;
+	*op++ = offset >> 8;
+
+	match_len -= MINMATCH;
+	if (match_len >= ML_MASK) {
+		*token |= ML_MASK;
+		op = lz4_put_length(op, match_len - ML_MASK);
+	} else {
+		*token |= match_len;
+	}
+
+	return op;
+}
+
+/* Worst case output size of lz4_compress_block() */
+static size_t lz4_block_bound(size_t len)
+{
+	return len + len / 255 + 16;
+}
+
+/* Compress one independent block, return the compressed size */
+static size_t lz4_compress_block(hc_tables_t *t, const uint8_t *src, uint32_t len,
+				 uint8_t *dst)
+{
+	uint8_t *op = dst;
+	uint32_t anchor = 0, pos = 0, next = 0;
+	uint32_t mflimit = len > MFLIMIT ? len - MFLIMIT : 0;
+	uint32_t match_end = len > LASTLITERALS ? len - LASTLITERALS : 0;
+
+	memset(t->hash, 0, sizeof(t->hash));
+
+	while (pos < mflimit) {
+		uint32_t ref = 0, ref2 = 0;
+		uint32_t len1 = hc_find(t, src, &next, pos, match_end, &ref);
+
+		if (len1 < MINMATCH) {
+			pos++;
+			continue;
+		}
+
+		/* Lazy evaluation: prefer a longer match starting one byte later */
+		while (pos + 1 < mflimit) {
+			uint32_t len2 = hc_find(t, src, &next, pos + 1, match_end, &ref2);
+
+			if (len2 <= len1)
+				break;
+			pos++;
+			len1 = len2;
+			ref = ref2;
+		}
+
+		op = lz4_put_sequence(op, src + anchor, pos - anchor, pos - ref, len1);
+		pos += len1;
+		anchor = pos;
+	}
+
+	return lz4_put_sequence(op, src + anchor, len - anchor, 0, 0) - dst;
+}
+
+typedef struct {
+	const uint8_t *src;
+	size_t len;
+	size_t nblocks;
+	uint8_t **out;		/* per block: 4 byte block size + data */
+	size_t *out_len;
+	size_t next_block;
+	pthread_mutex_t lock;
+} lz4_job_t;
+
+static void *lz4_worker(void *arg)
+{
+	lz4_job_t *job = arg;
+	hc_tables_t *t = malloc(sizeof(*t));
+
+	if (!t) {
+		fprintf(stderr, "lz4: failed to allocate match tables\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (;;) {
+		size_t i, off, blen, clen;
+		uint8_t *buf;
+
+		pthread_mutex_lock(&job->lock);
+		i = job->next_block++;
+		pthread_mutex_unlock(&job->lock);
+		if (i >= job->nblocks)
+			break;
+
+		trace_begin("lz4", "block", NULL);
+		off = i * LZ4_BLOCK_SIZE;
+		blen = job->len - off < LZ4_BLOCK_SIZE ? job->len - off : LZ4_BLOCK_SIZE;
+		buf = malloc(4 + lz4_block_bound(blen));
+		if (!buf) {
+			fprintf(stderr, "lz4: failed to allocate block buffer\n");
+			exit(EXIT_FAILURE);
+		}
+
+		clen = lz4_compress_block(t, job->src + off, blen, buf + 4);
+		if (clen >= blen) {
+			/* Incompressible, store as is */
+			memcpy(buf + 4, job->src + off, blen);
+			write_le32(buf, blen | LZ4_BLOCK_UNCOMPRESSED);
+			clen = blen;
+		} else {
+			write_le32(buf, clen);
+		}
+
+		job->out[i] = buf;
+		job->out_len[i] = 4 + clen;
+		trace_end();
+	}
+
+	free(t);
+	return NULL;
+}
+
+uint8_t *lz4_compress_frame(const uint8_t *src, size_t len, size_t *out_len)
+{
+	lz4_job_t job;
+	pthread_t threads[MAX_THREADS];
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	uint8_t *frame, *p;
+	size_t total = 7 + 4 + 4;	/* header, end mark, content checksum */
+
+	memset(&job, 0, sizeof(job));
+	job.src = src;
+	job.len = len;
+	job.nblocks = (len + LZ4_BLOCK_SIZE - 1) / LZ4_BLOCK_SIZE;
+	job.out = calloc(job.nblocks + 1, sizeof(*job.out));
+	job.out_len = calloc(job.nblocks + 1, sizeof(*job.out_len));
+	if (!job.out || !job.out_len) {
+		fprintf(stderr, "lz4: failed to allocate block list\n");
+		exit(EXIT_FAILURE);
+	}
+	pthread_mutex_init(&job.lock, NULL);
+
+	if (nthreads > (long)job.nblocks)
+		nthreads = job.nblocks;
+	if (nthreads > MAX_THREADS)
+		nthreads = MAX_THREADS;
+
+	if (nthreads <= 1) {
+		lz4_worker(&job);
+	} else {
+		for (long i = 0; i < nthreads; i++) {
+			if (pthread_create(&threads[i], NULL, lz4_worker, &job)) {
+				fprintf(stderr, "lz4: failed to create thread\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		for (long i = 0; i < nthreads; i++)
+			pthread_join(threads[i], NULL);
+	}
+	pthread_mutex_destroy(&job.lock);
+
+	for (size_t i = 0; i < job.nblocks; i++)
+		total += job.out_len[i];
+
+	frame = malloc(total);
+	if (!frame) {
+		fprintf(stderr, "lz4: failed to allocate %zu bytes\n", total);
+		exit(EXIT_FAILURE);
+	}
+
+	p = frame;
+	write_le32(p, LZ4_MAGIC);
+	p[4] = LZ4_FLG_VERSION | LZ4_FLG_BLOCK_INDEP | LZ4_FLG_CONTENT_CSUM;
+	p[5] = LZ4_BD_256KB;
+	p[6] = (xxh32(p + 4, 2, 0) >> 8) & 0xFF;
+	p += 7;
+
+	for (size_t i = 0; i < job.nblocks; i++) {
+		memcpy(p, job.out[i], job.out_len[i]);
+		p += job.out_len[i];
+		free(job.out[i]);
+	}
+
+	write_le32(p, 0);	/* end mark */
+	write_le32(p + 4, xxh32(src, len, 0));
+
+	free(job.out);
+	free(job.out_len);
+
+	*out_len = total;
+	return frame;
+}
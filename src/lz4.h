@@ -0,0 +1,22 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * LZ4 frame compression of image payloads (eg. the TEE)
+ */
+
+#ifndef __MKIMAGE_LZ4_H__
+#define __MKIMAGE_LZ4_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Compress src[0..len) into a standard LZ4 frame (independent blocks,
+ * content checksum), the same format 'lz4 -9' produces. Blocks are
+ * compressed in parallel. Returns a malloc'ed buffer, its length in out_len.
+ */
+uint8_t *lz4_compress_frame(const uint8_t *src, size_t len, size_t *out_len);
+
+#endif /* __MKIMAGE_LZ4_H__ */
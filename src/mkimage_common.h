@@ -55,7 +55,8 @@ typedef enum option_type {
     FCB,
     OEI,
     MSEL,
-    HOLD
+    HOLD,
+    APPEND_PAGE
 } option_type_t;
 
 
@@ -68,6 +69,13 @@ typedef struct {
       uint64_t ext;
       uint64_t mu;
       uint64_t part;
+      uint32_t align;/* payload alignment, 0 for the sector size */
+      uint64_t xip;/* FlexSPI base the image executes in place from, or 0 */
+      uint32_t slack;/* growth room reserved after the payload */
+      char *dek;/* encrypt=, the DEK file the payload is written encrypted with, or NULL */
+      unsigned int out_gen;/* --watch, input generation in the output, 0 if none */
+      uint64_t out_src;/* --watch, where that generation was written */
+      uint64_t out_len;/* --watch, and how many bytes it took */
 } image_t;
 
 typedef enum REVISION_TYPE {
@@ -295,70 +303,8 @@ typedef struct {
 
 #define UNDEFINED 0xFFFFFFFF
 
-#if 0
-enum imximage_fld_types {
-        CFG_INVALID = -1,
-        CFG_COMMAND,
-        CFG_REG_SIZE,
-        CFG_REG_ADDRESS,
-        CFG_REG_VALUE
-};
-
-enum imximage_cmd {
-        CMD_INVALID,
-        CMD_IMAGE_VERSION,
-        CMD_BOOT_FROM,
-        CMD_BOOT_OFFSET,
-        CMD_WRITE_DATA,
-        CMD_WRITE_CLR_BIT,
-        CMD_WRITE_SET_BIT,
-        CMD_CHECK_BITS_SET,
-        CMD_CHECK_BITS_CLR,
-        CMD_CHECK_ANY_BIT_SET,
-        CMD_CHECK_ANY_BIT_CLR,
-        CMD_CSF,
-        CMD_PLUGIN,
-};
-
-typedef struct table_entry {
-        int     id;
-        char    *sname;         /* short (input) name to find table entry */
-        char    *lname;         /* long (output) name to print for messages */
-} table_entry_t;
-
-/*
- * Supported commands for configuration file
- */
-static table_entry_t imximage_cmds[] = {
-        {CMD_BOOT_FROM,         "BOOT_FROM",            "boot command",   },
-        {CMD_BOOT_OFFSET,       "BOOT_OFFSET",          "Boot offset",    },
-        {CMD_WRITE_DATA,        "DATA",                 "Reg Write Data", },
-        {CMD_WRITE_CLR_BIT,     "CLR_BIT",              "Reg clear bit",  },
-        {CMD_WRITE_SET_BIT,     "SET_BIT",              "Reg set bit",  },
-        {CMD_CHECK_BITS_SET,    "CHECK_BITS_SET",   "Reg Check all bits set", },
-        {CMD_CHECK_BITS_CLR,    "CHECK_BITS_CLR",   "Reg Check all bits clr", },
-        {CMD_CHECK_ANY_BIT_SET, "CHECK_ANY_BIT_SET",   "Reg Check any bit set", },
-        {CMD_CHECK_ANY_BIT_CLR, "CHECK_ANY_BIT_CLR",   "Reg Check any bit clr", },
-        {CMD_CSF,               "CSF",           "Command Sequence File", },
-        {CMD_IMAGE_VERSION,     "IMAGE_VERSION",        "image version",  },
-        {-1,                    "",                     "",               },
-};
-#endif
-
 void check_file(struct stat* sbuf,char * filename);
 void copy_file (int ifd, const char *datafile, int pad, int offset);
-uint32_t get_cfg_value(char *token, char *name,  int linenr);
-void set_dcd_param_v2(dcd_v2_t *dcd_v2, uint32_t dcd_len,
-                int32_t cmd);
-void set_dcd_val_v2(dcd_v2_t *dcd_v2, char *name, int lineno,
-                                        int fld, uint32_t value, uint32_t off);
-void set_dcd_rst_v2(dcd_v2_t *dcd_v2, uint32_t dcd_len,
-                                                char *name, int lineno);
-void parse_cfg_cmd(dcd_v2_t *dcd_v2, int32_t cmd, char *token,
-                                char *name, int lineno, int fld, int dcd_len);
-void parse_cfg_fld(dcd_v2_t *dcd_v2, int32_t *cmd,
-                char *token, char *name, int lineno, int fld, int *dcd_len);
-uint32_t parse_cfg_file(dcd_v2_t *dcd_v2, char *name);
 
 int build_container_qm(uint32_t sector_size, uint32_t ivt_offset, char * out_file,
                 bool emmc_fastboot, image_t* image_stack);
@@ -368,6 +314,41 @@ int build_container_qx(uint32_t sector_size, uint32_t ivt_offset, char * out_fil
 
 int build_container_qx_qm_b0(soc_type_t soc, uint32_t sector_size, uint32_t ivt_offset, char * out_file,
                 bool emmc_fastboot, image_t* image_stack, bool dcd_skip, uint8_t fuse_version,
-                uint16_t sw_version, uint32_t cntr_flags, char *images_hash);
+                uint16_t sw_version, uint32_t cntr_flags, char *images_hash,
+                bool layout_opt);
 
 int parse_container_hdrs_qx_qm_b0(char *ifname, bool extract, soc_type_t soc, off_t file_off);
+int estimate_boot_qx_qm_b0(char *ifname, soc_type_t soc, off_t file_off);
+int write_region_map(char *out_file, image_t *image_stack, uint32_t block, char *map_file);
+
+/* Images composed in memory, referenced as '@name' instead of a filename */
+#define MEM_IMAGE_PREFIX	'@'
+
+typedef struct {
+	char *name;
+	uint8_t *data;
+	size_t size;
+} mem_image_t;
+
+mem_image_t *mem_image_find(const char *filename);
+void compose_image(char *name, int argc, char **argv, int *optind_p);
+char *compress_image(char *filename, const char *method);
+char *encrypt_key(char *keyfile);
+uint8_t *encrypt_image(const char *filename, const char *keyfile, size_t size);
+
+/* Input files, opened, stat'ed, mapped and hashed at most once per run */
+typedef struct input input_t;
+
+input_t *input_get(const char *filename);
+const struct stat *input_stat(input_t *in);
+off_t input_size(input_t *in);
+const uint8_t *input_data(input_t *in);
+size_t input_read(input_t *in, void *buf, size_t len, off_t off);
+size_t input_digest(input_t *in, int algo, size_t padded_len, uint8_t *digest);
+input_t *input_next(input_t *in);
+const char *input_name(input_t *in);
+unsigned int input_gen(input_t *in);
+void input_set_composed(input_t *in);
+bool input_composed(input_t *in);
+bool input_is_file(input_t *in);
+bool input_reload(input_t *in);
@@ -27,6 +27,13 @@
 
 #include "mkimage_common.h"
 #include "build_info.h"
+#include "stats.h"
+#include "trace.h"
+#include "estimate.h"
+#include "hash.h"
+#include "sign.h"
+#include "watch.h"
+#include "probes.h"
 
 #ifndef O_BINARY
 #define O_BINARY 0
@@ -35,77 +42,16 @@
 #define CONTAINER_FLAGS_DEFAULT	0x10
 #define IMG_STACK_SIZE			32 /* max of 32 images for commandline images */
 
-enum imximage_fld_types {
-		CFG_INVALID = -1,
-		CFG_COMMAND,
-		CFG_REG_SIZE,
-		CFG_REG_ADDRESS,
-		CFG_REG_VALUE
-};
-
-enum imximage_cmd {
-		CMD_INVALID,
-		CMD_IMAGE_VERSION,
-		CMD_BOOT_FROM,
-		CMD_BOOT_OFFSET,
-		CMD_WRITE_DATA,
-		CMD_WRITE_CLR_BIT,
-		CMD_WRITE_SET_BIT,
-		CMD_CHECK_BITS_SET,
-		CMD_CHECK_BITS_CLR,
-		CMD_CHECK_ANY_BIT_SET,
-		CMD_CHECK_ANY_BIT_CLR,
-		CMD_CSF,
-		CMD_PLUGIN,
-};
-
-typedef struct table_entry {
-		int 	id;
-		char	*sname;			/* short (input) name to find table entry */
-		char	*lname;			/* long (output) name to print for messages */
-} table_entry_t;
-
-/*
- * Supported commands for configuration file
- */
-static table_entry_t imximage_cmds[] = {
-		{CMD_BOOT_FROM,         "BOOT_FROM",            "boot command",   },
-		{CMD_BOOT_OFFSET,       "BOOT_OFFSET",          "Boot offset",    },
-		{CMD_WRITE_DATA,        "DATA",                 "Reg Write Data", },
-		{CMD_WRITE_CLR_BIT,     "CLR_BIT",              "Reg clear bit",  },
-		{CMD_WRITE_SET_BIT,     "SET_BIT",              "Reg set bit",  },
-		{CMD_CHECK_BITS_SET,    "CHECK_BITS_SET",   "Reg Check all bits set", },
-		{CMD_CHECK_BITS_CLR,    "CHECK_BITS_CLR",   "Reg Check all bits clr", },
-		{CMD_CHECK_ANY_BIT_SET, "CHECK_ANY_BIT_SET",   "Reg Check any bit set", },
-		{CMD_CHECK_ANY_BIT_CLR, "CHECK_ANY_BIT_CLR",   "Reg Check any bit clr", },
-		{CMD_CSF,               "CSF",           "Command Sequence File", },
-		{CMD_IMAGE_VERSION,     "IMAGE_VERSION",        "image version",  },
-		{-1,                    "",                     "",               },
-};
-
 void check_file(struct stat* sbuf,char * filename)
 {
-	int tmp_fd  = open(filename, O_RDONLY | O_BINARY);
-	if (tmp_fd < 0) {
-			fprintf(stderr, "%s: Can't open: %s\n",
-							filename, strerror(errno));
-			exit(EXIT_FAILURE);
-	}
-
-	if (fstat(tmp_fd, sbuf) < 0) {
-			fprintf(stderr, "%s: Can't stat: %s\n",
-							filename, strerror(errno));
-			exit(EXIT_FAILURE);
-	}
-	close(tmp_fd);
+	*sbuf = *input_stat(input_get(filename));
 }
 
 void
 copy_file (int ifd, const char *datafile, int pad, int offset)
 {
-	int dfd;
-	struct stat sbuf;
-	unsigned char *ptr;
+	input_t *in = input_get(datafile);
+	const uint8_t *ptr;
 	int tail;
 	int zero = 0;
 	uint8_t zeros[4096];
@@ -113,29 +59,13 @@ copy_file (int ifd, const char *datafile, int pad, int offset)
 
 	memset(zeros, 0, sizeof(zeros));
 
-	if ((dfd = open(datafile, O_RDONLY|O_BINARY)) < 0) {
-		fprintf (stderr, "Can't open %s: %s\n",
-			datafile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-
-	if (fstat(dfd, &sbuf) < 0) {
-		fprintf (stderr, "Can't stat %s: %s\n",
-			datafile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
+	size = input_size(in);
+	if (size == 0)
+		return;
 
-	if(sbuf.st_size == 0)
-		goto close;
-
-	ptr = mmap(0, sbuf.st_size, PROT_READ, MAP_SHARED, dfd, 0);
-	if (ptr == MAP_FAILED) {
-		fprintf (stderr, "Can't read %s: %s\n",
-			datafile, strerror(errno));
-		exit (EXIT_FAILURE);
-	}
-
-	size = sbuf.st_size;
+	stats_begin(STATS_COPY, datafile);
+	MKIMAGE_PROBE(copy__start, datafile, offset, size);
+	ptr = input_data(in);
 	ret = lseek(ifd, offset, SEEK_SET);
 	if (ret < 0) {
 		fprintf(stderr, "%s: lseek error %s\n",
@@ -149,6 +79,8 @@ copy_file (int ifd, const char *datafile, int pad, int offset)
 		exit (EXIT_FAILURE);
 	}
 
+	stats_add(STATS_BYTES_WRITTEN, size);
+
 	tail = size % 4;
 	pad = pad - size;
 	if ((pad == 1) && (tail != 0)) {
@@ -158,6 +90,7 @@ copy_file (int ifd, const char *datafile, int pad, int offset)
 				strerror(errno));
 			exit (EXIT_FAILURE);
 		}
+		stats_add(STATS_ZERO_WRITTEN, 4 - tail);
 	} else if (pad > 1) {
 		while (pad > 0) {
 			int todo = sizeof(zeros);
@@ -169,326 +102,12 @@ copy_file (int ifd, const char *datafile, int pad, int offset)
 					strerror(errno));
 				exit(EXIT_FAILURE);
 			}
+			stats_add(STATS_ZERO_WRITTEN, todo);
 			pad -= todo;
 		}
 	}
-
-	(void) munmap((void *)ptr, sbuf.st_size);
-close:
-	(void) close (dfd);
-}
-
-
-static uint32_t imximage_version;
-static struct dcd_v2_cmd *gd_last_cmd;
-static uint32_t imximage_ivt_offset = UNDEFINED;
-static uint32_t imximage_csf_size = UNDEFINED;
-
-int get_table_entry_id(const table_entry_t *table,
-		const char *table_name, const char *name)
-{
-	const table_entry_t *t;
-
-	for (t = table; t->id >= 0; ++t) {
-		if (t->sname && strcasecmp(t->sname, name) == 0)
-			return (t->id);
-	}
-
-	return -1;
-}
-
-uint32_t get_cfg_value(char *token, char *name,  int linenr)
-{
-	char *endptr;
-	uint32_t value;
-
-	errno = 0;
-	value = strtoul(token, &endptr, 16);
-	if (errno || (token == endptr)) {
-		fprintf(stderr, "Error: %s[%d] - Invalid hex data(%s)\n",
-			name,  linenr, token);
-		exit(EXIT_FAILURE);
-	}
-	return value;
-}
-
-
-void set_dcd_param_v2(dcd_v2_t *dcd_v2, uint32_t dcd_len,
-		int32_t cmd)
-{
-	struct dcd_v2_cmd *d = gd_last_cmd;
-	struct dcd_v2_cmd *d2;
-	int len;
-
-	if (!d)
-		d = &dcd_v2->dcd_cmd;
-	d2 = d;
-	len = be16_to_cpu(d->write_dcd_command.length);
-	if (len > 4)
-		d2 = (struct dcd_v2_cmd *)(((char *)d) + len);
-
-	switch (cmd) {
-	/* Write value: *address = val_msk */
-	case CMD_WRITE_DATA:
-		if ((d->write_dcd_command.tag == DCD_WRITE_DATA_COMMAND_TAG) &&
-			(d->write_dcd_command.param == DCD_WRITE_DATA_PARAM))
-			break;
-		d = d2;
-		d->write_dcd_command.tag = DCD_WRITE_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_WRITE_DATA_PARAM;
-		break;
-	/* Clear bitmask: *address &= ~val_msk */
-	case CMD_WRITE_CLR_BIT:
-		if ((d->write_dcd_command.tag == DCD_WRITE_DATA_COMMAND_TAG) &&
-		    (d->write_dcd_command.param == DCD_WRITE_CLR_BIT_PARAM))
-			break;
-		d = d2;
-		d->write_dcd_command.tag = DCD_WRITE_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_WRITE_CLR_BIT_PARAM;
-		break;
-	/* Set bitmask: *address |= val_msk */
-	case CMD_WRITE_SET_BIT:
-		if ((d->write_dcd_command.tag == DCD_WRITE_DATA_COMMAND_TAG) &&
-			(d->write_dcd_command.param == DCD_WRITE_SET_BIT_PARAM))
-			break;
-		d = d2;
-		d->write_dcd_command.tag = DCD_WRITE_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_WRITE_SET_BIT_PARAM;
-		break;
-	/*
-	 * Check data command only supports one entry,
-	 */
-	/* All bits set: (*address & mask) == mask */
-	case CMD_CHECK_BITS_SET:
-		d = d2;
-		d->write_dcd_command.tag = DCD_CHECK_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_CHECK_BITS_SET_PARAM;
-		break;
-	/* All bits clear: (*address & mask) == 0 */
-	case CMD_CHECK_BITS_CLR:
-		d = d2;
-		d->write_dcd_command.tag = DCD_CHECK_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_CHECK_BITS_CLR_PARAM;
-		break;
-	/* Any bit clear: (*address & mask) != mask */
-	case CMD_CHECK_ANY_BIT_CLR:
-		d = d2;
-		d->write_dcd_command.tag = DCD_CHECK_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_CHECK_ANY_BIT_CLR_PARAM;
-		break;
-	/* Any bit set: (*address & mask) != 0 */
-	case CMD_CHECK_ANY_BIT_SET:
-		d = d2;
-		d->write_dcd_command.tag = DCD_CHECK_DATA_COMMAND_TAG;
-		d->write_dcd_command.length = cpu_to_be16(4);
-		d->write_dcd_command.param = DCD_CHECK_ANY_BIT_SET_PARAM;
-		break;
-	default:
-		break;
-	}
-	gd_last_cmd = d;
-}
-
-void set_dcd_val_v2(dcd_v2_t *dcd_v2, char *name, int lineno,
-					int fld, uint32_t value, uint32_t off)
-{
-	struct dcd_v2_cmd *d = gd_last_cmd;
-	int len;
-
-	len = be16_to_cpu(d->write_dcd_command.length);
-	off = (len - 4) >> 3;
-
-	switch (fld) {
-	case CFG_REG_ADDRESS:
-		d->addr_data[off].addr = cpu_to_be32(value);
-		break;
-	case CFG_REG_VALUE:
-		d->addr_data[off].value = cpu_to_be32(value);
-		off++;
-		d->write_dcd_command.length = cpu_to_be16((off << 3) + 4);
-		break;
-	default:
-		break;
-
-	}
-}
-
-void set_dcd_rst_v2(dcd_v2_t *dcd_v2, uint32_t dcd_len,
-						char *name, int lineno)
-{
-	struct dcd_v2_cmd *d = gd_last_cmd;
-	int len;
-
-	if (!d)
-		d = &dcd_v2->dcd_cmd;
-	len = be16_to_cpu(d->write_dcd_command.length);
-	if (len > 4)
-		d = (struct dcd_v2_cmd *)(((char *)d) + len);
-
-	len = (char *)d - (char *)&dcd_v2->header;
-
-	dcd_v2->header.tag = DCD_HEADER_TAG;
-	dcd_v2->header.length = cpu_to_be16(len);
-	dcd_v2->header.version = DCD_VERSION;
-	printf("dcd size in bytes = %d\n", len);
-}
-
-void parse_cfg_cmd(dcd_v2_t *dcd_v2, int32_t cmd, char *token,
-				char *name, int lineno, int fld, int dcd_len)
-{
-	int value;
-	static int cmd_ver_first = ~0;
-
-	switch (cmd) {
-	case CMD_IMAGE_VERSION:
-		imximage_version = get_cfg_value(token, name, lineno);
-		if (cmd_ver_first == 0) {
-			fprintf(stderr, "Error: %s[%d] - IMAGE_VERSION "
-				"command need be the first before other "
-				"valid command in the file\n", name, lineno);
-			exit(EXIT_FAILURE);
-		}
-		cmd_ver_first = 1;
-		break;
-	case CMD_BOOT_OFFSET:
-		imximage_ivt_offset = get_cfg_value(token, name, lineno);
-		if (cmd_ver_first != 1)
-			cmd_ver_first = 0;
-		break;
-	case CMD_WRITE_DATA:
-	case CMD_WRITE_CLR_BIT:
-	case CMD_WRITE_SET_BIT:
-	case CMD_CHECK_BITS_SET:
-	case CMD_CHECK_BITS_CLR:
-	case CMD_CHECK_ANY_BIT_SET:
-	case CMD_CHECK_ANY_BIT_CLR:
-		value = get_cfg_value(token, name, lineno);
-		set_dcd_param_v2(dcd_v2, dcd_len, cmd);
-		set_dcd_val_v2(dcd_v2, name, lineno, fld, value, dcd_len);
-		if (cmd_ver_first != 1)
-			cmd_ver_first = 0;
-		break;
-	case CMD_CSF:
-		if (imximage_version != 2) {
-			fprintf(stderr,
-				"Error: %s[%d] - CSF only supported for VERSION 2(%s)\n",
-				name, lineno, token);
-			exit(EXIT_FAILURE);
-		}
-		imximage_csf_size = get_cfg_value(token, name, lineno);
-		if (cmd_ver_first != 1)
-			cmd_ver_first = 0;
-		break;
-	}
-}
-
-void parse_cfg_fld(dcd_v2_t *dcd_v2, int32_t *cmd,
-		char *token, char *name, int lineno, int fld, int *dcd_len)
-{
-	int value;
-
-	switch (fld) {
-	case CFG_COMMAND:
-		*cmd = get_table_entry_id(imximage_cmds,
-			"imximage commands", token);
-		if (*cmd < 0) {
-			fprintf(stderr, "Error: %s[%d] - Invalid command"
-			"(%s)\n", name, lineno, token);
-			exit(EXIT_FAILURE);
-		}
-		break;
-	case CFG_REG_SIZE:
-		parse_cfg_cmd(dcd_v2, *cmd, token, name, lineno, fld, *dcd_len);
-		break;
-	case CFG_REG_ADDRESS:
-	case CFG_REG_VALUE:
-		switch(*cmd) {
-		case CMD_WRITE_DATA:
-		case CMD_WRITE_CLR_BIT:
-		case CMD_WRITE_SET_BIT:
-		case CMD_CHECK_BITS_SET:
-		case CMD_CHECK_BITS_CLR:
-		case CMD_CHECK_ANY_BIT_SET:
-		case CMD_CHECK_ANY_BIT_CLR:
-			value = get_cfg_value(token, name, lineno);
-			set_dcd_param_v2(dcd_v2, *dcd_len, *cmd);
-			set_dcd_val_v2(dcd_v2, name, lineno, fld, value,
-					*dcd_len);
-
-			if (fld == CFG_REG_VALUE) {
-				(*dcd_len)++;
-				if (*dcd_len > MAX_HW_CFG_SIZE_V2) {
-					fprintf(stderr, "Error: %s[%d] -"
-						"DCD table exceeds maximum size(%d)\n",
-						name, lineno, MAX_HW_CFG_SIZE_V2);
-					exit(EXIT_FAILURE);
-				}
-			}
-			break;
-		default:
-			break;
-		}
-		break;
-	default:
-		break;
-	}
-}
-
-uint32_t parse_cfg_file(dcd_v2_t *dcd_v2, char *name)
-{
-	FILE *fd = NULL;
-	char *line = NULL;
-	char *token, *saveptr1, *saveptr2;
-	int lineno = 0;
-	int fld;
-	size_t len;
-	int dcd_len = 0;
-	int32_t cmd;
-
-	fd = fopen(name, "r");
-	if (fd == 0) {
-		fprintf(stderr, "Error: %s - Can't open DCD file\n", name);
-		exit(EXIT_FAILURE);
-	}
-
-	/*
-	 * Very simple parsing, line starting with # are comments
-	 * and are dropped
-	 */
-	while ((getline(&line, &len, fd)) > 0) {
-		lineno++;
-
-		token = strtok_r(line, "\r\n", &saveptr1);
-		if (token == NULL)
-			continue;
-
-		/* Check inside the single line */
-		for (fld = CFG_COMMAND, cmd = CMD_INVALID,
-				line = token; ; line = NULL, fld++) {
-			token = strtok_r(line, " \t", &saveptr2);
-			if (token == NULL)
-				break;
-
-			/* Drop all text starting with '#' as comments */
-			if (token[0] == '#')
-				break;
-
-			parse_cfg_fld(dcd_v2, &cmd, token, name,
-					lineno, fld, &dcd_len);
-		}
-
-	}
-
-	set_dcd_rst_v2(dcd_v2, dcd_len, name, lineno);
-	fclose(fd);
-
-	return dcd_len;
+	MKIMAGE_PROBE(copy__end, datafile, offset, size);
+	stats_end(STATS_COPY);
 }
 
 #define FDT_MAGIC 0xd00dfeed
@@ -576,6 +195,193 @@ int split_dtb_from_uboot(char *ifname)
 	return 0;
 }
 
+/*
+ * Smallest payload alignment the ROM of each boot device loads from, the
+ * floor for align= and -image_align. SD/eMMC are read in 512 byte blocks,
+ * NAND in whole pages (the sector size), FlexSPI through the AHB mapping.
+ */
+static const struct {
+	const char *dev;
+	uint32_t min_align;	/* 0 for the sector size */
+} image_align_policy[] = {
+	{ "sd",		0x200 },
+	{ "emmc_fast",	0x200 },
+	{ "flexspi",	0x10 },
+	{ "nand",	0 },
+};
+
+static uint32_t image_align_min(const char *dev, uint32_t sector_size)
+{
+	for (size_t i = 0; i < sizeof(image_align_policy) / sizeof(image_align_policy[0]); i++) {
+		if (!strcmp(dev, image_align_policy[i].dev) && image_align_policy[i].min_align)
+			return image_align_policy[i].min_align;
+	}
+
+	return sector_size;
+}
+
+static uint32_t parse_align(const char *arg)
+{
+	char *end;
+	unsigned long align = strtoul(arg, &end, 0);
+
+	if (*end || !align || (align & (align - 1)) || align > 0x100000) {
+		fprintf(stderr, "ERROR: alignment %s must be a power of 2 up to 1M\n", arg);
+		exit(EXIT_FAILURE);
+	}
+
+	return align;
+}
+
+static uint32_t parse_slack(const char *arg)
+{
+	char *end;
+	unsigned long long slack;
+
+	errno = 0;
+	slack = strtoull(arg, &end, 0);
+	if (errno || end == arg || *end || *arg == '-' || slack > UINT32_MAX) {
+		fprintf(stderr, "ERROR: slack %s must be a byte count below 4G\n", arg);
+		exit(EXIT_FAILURE);
+	}
+
+	return slack;
+}
+
+/* Secondary Image Table, as scripts/sit_template writes it */
+#define SIT_TAG			0x00112233
+#define SIT_SECTOR_SIZE		512
+
+typedef struct {
+	uint32_t chipnum;
+	uint32_t driver_type;
+	uint32_t tag;
+	uint32_t first_sector;	/* of the secondary image set */
+	uint32_t sector_count;	/* not used */
+} sit_t;
+
+/*
+ * Image offsets are relative to their container header, so the secondary
+ * set is the primary one copied to another sector. When combined, the copy
+ * goes into the output itself, combined_base being the device offset the
+ * output is written at, else to [output].secondary. The SIT goes to
+ * [output].sit.
+ */
+static void write_secondary(char *ofname, uint32_t sector, bool combined,
+			    uint32_t combined_base)
+{
+	sit_t sit = { .tag = SIT_TAG, .first_sector = sector };
+	uint8_t sit_sector[SIT_SECTOR_SIZE] = { 0 };
+	uint64_t sec_off = (uint64_t)sector * SIT_SECTOR_SIZE;
+	size_t len = strlen(ofname) + sizeof(".secondary");
+	char *name = malloc(len);
+	struct stat sbuf;
+	int fd;
+
+	if (!name) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		exit(EXIT_FAILURE);
+	}
+	/* With --watch the output read last time is stale */
+	input_reload(input_get(ofname));
+	check_file(&sbuf, ofname);
+	if (combined && sec_off < combined_base + sbuf.st_size) {
+		fprintf(stderr, "Secondary image set at 0x%" PRIx64 " overlaps the primary one at 0x%x-0x%" PRIx64 "\n",
+			sec_off, combined_base, combined_base + sbuf.st_size);
+		exit(EXIT_FAILURE);
+	}
+
+	snprintf(name, len, "%s.sit", ofname);
+	memcpy(sit_sector, &sit, sizeof(sit));
+	fd = open(name, O_RDWR|O_CREAT|O_TRUNC|O_BINARY, 0666);
+	if (fd < 0 || write(fd, sit_sector, sizeof(sit_sector)) != sizeof(sit_sector)) {
+		fprintf(stderr, "%s: Can't write: %s\n", name, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	close(fd);
+	fprintf(stdout, "SIT:\t%s, secondary image set at sector 0x%x\n", name, sector);
+
+	if (combined) {
+		fd = open(ofname, O_RDWR|O_BINARY);
+		if (fd < 0) {
+			fprintf(stderr, "%s: Can't open: %s\n", ofname, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		copy_file(fd, ofname, 0, sec_off - combined_base);
+		fprintf(stdout, "Secondary:\t%s at 0x%" PRIx64 ", write %s at device offset 0x%x\n",
+			ofname, sec_off - combined_base, ofname, combined_base);
+	} else {
+		snprintf(name, len, "%s.secondary", ofname);
+		fd = open(name, O_RDWR|O_CREAT|O_TRUNC|O_BINARY, 0666);
+		if (fd < 0) {
+			fprintf(stderr, "%s: Can't open: %s\n", name, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		copy_file(fd, ofname, 0, 0);
+		fprintf(stdout, "Secondary:\t%s, write it at device offset 0x%" PRIx64 "\n",
+			name, sec_off);
+	}
+	close(fd);
+	free(name);
+}
+
+static bool is_image_attr(const char *arg)
+{
+	return *arg != '-' && strchr(arg, '=');
+}
+
+/*
+ * Optional key=value attributes following the arguments of an image option,
+ * eg. -ap tee.bin a55 0x96000000 compress=lz4hc
+ */
+static void parse_image_attrs(image_t *img, int argc, char **argv, int *optind_p)
+{
+	char *name = img->filename;
+	bool compressed = false;
+
+	while (*optind_p < argc && is_image_attr(argv[*optind_p])) {
+		char *attr = argv[(*optind_p)++];
+		char *val = strchr(attr, '=') + 1;
+
+		fprintf(stdout, "\t%s\n", attr);
+		if (!strncmp(attr, "compress=", 9)) {
+			if (img->dek) {
+				fprintf(stderr, "ERROR: %s: compress= must come before encrypt=\n",
+					name);
+				exit(EXIT_FAILURE);
+			}
+			img->filename = compress_image(img->filename, val);
+			compressed = true;
+		} else if (!strncmp(attr, "encrypt=", 8)) {
+			img->dek = encrypt_key(val);
+		} else if (!strncmp(attr, "align=", 6)) {
+			img->align = parse_align(val);
+		} else if (!strncmp(attr, "slack=", 6)) {
+			img->slack = parse_slack(val);
+		} else if (!strncmp(attr, "xip=", 4)) {
+			img->xip = strtoull(val, NULL, 0);
+			if (!img->xip) {
+				fprintf(stderr, "ERROR: xip= needs the FlexSPI base address\n");
+				exit(EXIT_FAILURE);
+			}
+		} else {
+			fprintf(stderr, "ERROR: unknown image attribute %s\n", attr);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (img->xip && compressed) {
+		fprintf(stderr, "ERROR: %s executes in place, it can't be compressed\n",
+			name);
+		exit(EXIT_FAILURE);
+	}
+	if (img->xip && img->dek) {
+		fprintf(stderr, "ERROR: %s executes in place, it can't be encrypted\n",
+			name);
+		exit(EXIT_FAILURE);
+	}
+}
+
 /*
  * Read commandline parameters and construct the header in order
  *
@@ -592,12 +398,24 @@ int main(int argc, char **argv)
 	bool output = false;
 	bool dcd_skip = false;
 	bool emmc_fastboot = false;
+	bool layout_opt = false;
+	bool estimate = false;
+	uint32_t erase_block = 0;
+	char *region_map = NULL;
+	uint32_t secondary = 0, combined_base = 0;
+	bool combined = false;
+	char *srk_table = NULL, *sign_key = NULL, *sgk = NULL;
+	int srk_index = 0;
+	char *boot_dev = "sd";
+	char *image_align = NULL;
 	bool extract = false;
 	bool parse = false;
 	bool split = false;
+	bool watch = false;
+	unsigned int watch_ms = 100;
 
 	int container = -1;
-	image_t param_stack[IMG_STACK_SIZE];/* stack of input images */
+	image_t param_stack[IMG_STACK_SIZE] = { 0 };/* stack of input images */
 	int p_idx = 0;/* param index counter */
 	off_t file_off = 0;
 
@@ -650,9 +468,30 @@ int main(int argc, char **argv)
 		{"split", required_argument, NULL, 'S'},
 		{"hold", required_argument, NULL, 'H'},
 		{"cntr_flags", required_argument, NULL, 'F'},
+		{"compose", required_argument, NULL, 'C'},
+		{"stats", optional_argument, NULL, 'Q'},
+		{"trace", required_argument, NULL, 'Z'},
+		{"layout_opt", no_argument, NULL, 'Y'},
+		{"image_align", required_argument, NULL, 'J'},
+		{"estimate", required_argument, NULL, 'T'},
+		{"erase_block", required_argument, NULL, 'K'},
+		{"region_map", required_argument, NULL, 'k'},
+		{"secondary", required_argument, NULL, 'n'},
+		{"combined", required_argument, NULL, 'N'},
+		{"append_at_page", required_argument, NULL, 'g'},
+		{"srk_table", required_argument, NULL, 'B'},
+		{"srk_index", required_argument, NULL, 'j'},
+		{"sign_key", required_argument, NULL, 'q'},
+		{"sgk", required_argument, NULL, 'U'},
+		{"watch", optional_argument, NULL, 'W'},
 		{NULL, 0, NULL, 0}
 	};
 
+	/* before getopt reorders it */
+	watch_args(argc, argv);
+
+	stats_begin(STATS_ARGS, NULL);
+
 	/* scan in parameters in order */
 	while(1)
 	{
@@ -791,6 +630,7 @@ int main(int argc, char **argv)
 						}
 						fprintf(stdout, "\tcore: %s\n", argv[optind++]);
 						param_stack[p_idx].entry = (uint32_t) strtoll(argv[optind++], NULL, 0);
+						parse_image_attrs(&param_stack[p_idx], argc, argv, &optind);
 					}
 					else {
 						fprintf(stderr, "\n-data option require THREE arguments: filename, core: a[55,35,53,72]/m[4,4_1,33] load address in hex\n\n");
@@ -819,11 +659,12 @@ int main(int argc, char **argv)
 					param_stack[p_idx].dst = 0;
 					fprintf(stdout, "\tcore: %" PRIi64, param_stack[p_idx].ext);
 					fprintf(stdout, " entry addr: 0x%08" PRIx64 , param_stack[p_idx].entry);
-					if (optind < argc && *argv[optind] != '-') {
+					if (optind < argc && *argv[optind] != '-' && !is_image_attr(argv[optind])) {
 						param_stack[p_idx].dst = (uint32_t) strtoll(argv[optind++], NULL, 0);
 						fprintf(stdout, " load addr: 0x%08" PRIx64 , param_stack[p_idx].dst);
 					}
 					fprintf(stdout, "\n");
+					parse_image_attrs(&param_stack[p_idx], argc, argv, &optind);
 					p_idx++;
 				} else {
 					fprintf(stderr, "\n-m[4,33] option require FOUR arguments: filename, core: 0/1, entry address in hex, load address in hex(optional)\n\n");
@@ -859,6 +700,10 @@ int main(int argc, char **argv)
 					p_idx++;
 				}
 				break;
+			case 'C':
+				fprintf(stdout, "COMPOSE:\t%s\n", optarg);
+				compose_image(optarg, argc, argv, &optind);
+				break;
 			case 'H':
 				fprintf(stdout, "HOLD:\t%s", optarg);
 				param_stack[p_idx].option = HOLD;
@@ -895,7 +740,7 @@ int main(int argc, char **argv)
 					param_stack[p_idx].mu = SC_R_MU_0A;
 					param_stack[p_idx].part = 1;
 
-					if (optind < argc && *argv[optind] != '-') {
+					if (optind < argc && *argv[optind] != '-' && !is_image_attr(argv[optind])) {
 						if (!strncmp(argv[optind], "mu0", 3))
 							param_stack[p_idx].mu = SC_R_MU_0A;
 						else if (!strncmp(argv[optind], "mu3", 3))
@@ -906,7 +751,7 @@ int main(int argc, char **argv)
 						}
 						fprintf(stdout, "\tMU: %s ", argv[optind++]);
 					}
-					if (optind < argc && *argv[optind] != '-') {
+					if (optind < argc && *argv[optind] != '-' && !is_image_attr(argv[optind])) {
 						if ( !strncmp(argv[optind], "pt", 2)
 								&& (argv[optind][2] > '0')
 								&& (argv[optind][2] != '2') /* partition 2 is reserved */
@@ -922,7 +767,9 @@ int main(int argc, char **argv)
 						}
 						fprintf(stdout, "\tPartition: %s ", argv[optind++]);
 					}
-					fprintf(stdout, " addr: 0x%08" PRIx64 "\n", param_stack[p_idx++].entry);
+					fprintf(stdout, " addr: 0x%08" PRIx64 "\n", param_stack[p_idx].entry);
+					parse_image_attrs(&param_stack[p_idx], argc, argv, &optind);
+					p_idx++;
 				} else {
 					fprintf(stderr, "\n-ap option require THREE arguments: filename, a[35,55,53,72], start address in hex\n\n");
 					exit(EXIT_FAILURE);
@@ -955,6 +802,7 @@ int main(int argc, char **argv)
 				break;
 			case 'e':
 				fprintf(stdout, "BOOT DEVICE:\t%s\n", optarg);
+				boot_dev = optarg;
 				if (!strcmp(optarg, "flexspi")) {
 					ivt_offset = IVT_OFFSET_FLEXSPI;
 				} else if (!strcmp(optarg, "sd")) {
@@ -1068,6 +916,69 @@ int main(int argc, char **argv)
 				cntr_flags = (uint32_t) (strtoll(optarg, NULL, 0) & 0xFFFFFFFF);
 				fprintf(stdout, "Container header flags: 0x%08X\n", cntr_flags);
 				break;
+			case 'Q':
+				stats_enable(optarg);
+				break;
+			case 'W':
+				watch = true;
+				if (optarg)
+					watch_ms = strtoul(optarg, NULL, 0);
+				break;
+			case 'Z':
+				trace_open(optarg);
+				break;
+			case 'Y':
+				layout_opt = true;
+				break;
+			case 'J':
+				image_align = optarg;
+				break;
+			case 'T':
+				estimate_model(optarg);
+				estimate = true;
+				break;
+			case 'K':
+				erase_block = parse_align(optarg);
+				break;
+			case 'k':
+				region_map = optarg;
+				break;
+			case 'n':
+				secondary = (uint32_t) strtoll(optarg, NULL, 0);
+				if (!secondary) {
+					fprintf(stderr, "-secondary needs the sector of the secondary image set\n");
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'N':
+				combined_base = (uint32_t) strtoll(optarg, NULL, 0);
+				combined = true;
+				break;
+			case 'B':
+				srk_table = optarg;
+				break;
+			case 'j':
+				srk_index = (int) strtol(optarg, NULL, 0);
+				break;
+			case 'q':
+				sign_key = optarg;
+				break;
+			case 'U':
+				sgk = optarg;
+				break;
+			case 'g':
+				fprintf(stdout, "APPEND AT PAGE:\t%s", optarg);
+				param_stack[p_idx].option = APPEND_PAGE;
+				param_stack[p_idx].filename = optarg;
+				if (optind < argc && *argv[optind] != '-')
+					param_stack[p_idx].entry = strtoull(argv[optind++], NULL, 0) * 1024;
+				if (!param_stack[p_idx].entry) {
+					fprintf(stderr, "\n-append_at_page needs the page size in KB\n");
+					exit(EXIT_FAILURE);
+				}
+				fprintf(stdout, "\tpage: %" PRIu64 " KB\n", param_stack[p_idx].entry / 1024);
+				p_idx++;
+				break;
 			case '?':
 			default:
 				/* invalid option */
@@ -1077,6 +988,8 @@ int main(int argc, char **argv)
 		}
 	}
 
+	stats_end(STATS_ARGS);
+
 	if (!parse) {
 		fprintf(stdout, "CONTAINER FUSE VERSION:\t0x%02x\n", fuse_version);
 		fprintf(stdout, "CONTAINER SW VERSION:\t0x%04x\n", sw_version);
@@ -1084,13 +997,61 @@ int main(int argc, char **argv)
 
 	param_stack[p_idx].option = NO_IMG; /* null terminate the img stack */
 
+	if (image_align) {
+		uint32_t align = strcmp(image_align, "min") ?
+			parse_align(image_align) : image_align_min(boot_dev, sector_size);
+
+		fprintf(stdout, "IMAGE ALIGN:\t0x%x\n", align);
+		for (int i = 0; i < p_idx; i++) {
+			if (!param_stack[i].align)
+				param_stack[i].align = align;
+		}
+	}
+
+	/* images start on an erase block, so one changing leaves the others' blocks alone */
+	if (erase_block) {
+		fprintf(stdout, "ERASE BLOCK:\t0x%x\n", erase_block);
+		for (int i = 0; i < p_idx; i++) {
+			if (param_stack[i].align < erase_block && sector_size < erase_block)
+				param_stack[i].align = erase_block;
+		}
+	}
+
+	for (int i = 0; i < p_idx; i++) {
+		if (param_stack[i].xip && strcmp(boot_dev, "flexspi")) {
+			fprintf(stderr, "ERROR: %s: xip= needs -dev flexspi\n",
+				param_stack[i].filename);
+			exit(EXIT_FAILURE);
+		}
+		if (param_stack[i].xip && i > 0 && param_stack[i - 1].option == FILEOFF) {
+			fprintf(stderr, "ERROR: %s: -fileoff and xip= both place the image\n",
+				param_stack[i].filename);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	for (int i = 0; i < p_idx; i++) {
+		uint32_t min = image_align_min(boot_dev, sector_size);
+
+		if (param_stack[i].filename && param_stack[i].align &&
+		    param_stack[i].align < min) {
+			fprintf(stderr, "ERROR: %s alignment 0x%x is below the 0x%x %s boot needs\n",
+				param_stack[i].filename, param_stack[i].align, min, boot_dev);
+			exit(EXIT_FAILURE);
+		}
+	}
+
 	if(soc == NONE){
 		fprintf(stderr, " No SOC defined");
 		exit(EXIT_FAILURE);
 	}
 
 	if (parse || extract) {
+		stats_begin(STATS_PARSE, ifname);
 		parse_container_hdrs_qx_qm_b0(ifname, extract, soc, file_off);
+		stats_end(STATS_PARSE);
+		if (estimate)
+			estimate_boot_qx_qm_b0(ifname, soc, file_off);
 		return 0;
 	}
 
@@ -1110,53 +1071,102 @@ int main(int argc, char **argv)
 		exit(EXIT_FAILURE);
 	}
 
+	if (combined && !secondary) {
+		fprintf(stderr, "-combined needs -secondary\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* SECO parts fuse the SHA-512 of the SRK table, ELE parts its SHA-256 */
+	if (sign_key)
+		sign_setup(srk_table, srk_index, sign_key, sgk,
+			   (soc == QX || soc == QM || soc == DXL) ?
+			   HASH_ALGO_SHA512 : HASH_ALGO_SHA256);
+	else if (srk_table || sgk) {
+		fprintf(stderr, "-srk_table and -sgk need -sign_key\n");
+		exit(EXIT_FAILURE);
+	}
+
 	/* Now begin assembling the image acording to each SOC container */
+	stats_output(ofname);
 
 
 
-	switch(soc)
-	{
-		case QX:
-			if (rev == NO_REV) {
-				fprintf(stdout, "No REVISION defined, using B0 by default\n");
-				rev = B0;
-			}
-			fprintf(stdout, "ivt_offset:\t%d\n", ivt_offset);
-			fprintf(stdout, "rev:\t%d\n", rev);
-			if (rev == B0)
+	/* With --watch, again each time inputs change */
+	for (;;) {
+		switch(soc)
+		{
+			case QX:
+				if (rev == NO_REV) {
+					fprintf(stdout, "No REVISION defined, using B0 by default\n");
+					rev = B0;
+				}
+				fprintf(stdout, "ivt_offset:\t%d\n", ivt_offset);
+				fprintf(stdout, "rev:\t%d\n", rev);
+				if (rev == B0)
+					build_container_qx_qm_b0(soc, sector_size, ivt_offset, ofname,
+						emmc_fastboot, (image_t *) param_stack, dcd_skip,
+						fuse_version, sw_version, cntr_flags, images_hash,
+						layout_opt);
+				else
+					fprintf(stderr, " unsupported SOC revision");
+				break;
+			case QM:
+				if (rev == NO_REV) {
+					fprintf(stdout, "No REVISION defined, using B0 by default\n");
+					rev = B0;
+				}
+				if (rev == B0)
+					build_container_qx_qm_b0(soc, sector_size, ivt_offset, ofname,
+						emmc_fastboot, (image_t *) param_stack, dcd_skip,
+						fuse_version, sw_version, cntr_flags, images_hash,
+						layout_opt);
+				else
+					fprintf(stderr, " unsupported SOC revision");
+				break;
+			case DXL:
+			case ULP:
+			case IMX9:
 				build_container_qx_qm_b0(soc, sector_size, ivt_offset, ofname,
 					emmc_fastboot, (image_t *) param_stack, dcd_skip,
-					fuse_version, sw_version, cntr_flags, images_hash);
-			else
-				fprintf(stderr, " unsupported SOC revision");
-			break;
-		case QM:
-			if (rev == NO_REV) {
-				fprintf(stdout, "No REVISION defined, using B0 by default\n");
-				rev = B0;
+					fuse_version, sw_version, cntr_flags, images_hash,
+					layout_opt);
+				break;
+			default:
+				fprintf(stderr, " unrecognized SOC defined");
+				exit(EXIT_FAILURE);
+		}
+
+
+		if (erase_block || region_map) {
+			char *map = region_map;
+
+			if (!map) {
+				map = malloc(strlen(ofname) + sizeof(".regions"));
+				if (!map) {
+					fprintf(stderr, "Failed to allocate memory\n");
+					exit(EXIT_FAILURE);
+				}
+				sprintf(map, "%s.regions", ofname);
 			}
-			if (rev == B0)
-				build_container_qx_qm_b0(soc, sector_size, ivt_offset, ofname,
-					emmc_fastboot, (image_t *) param_stack, dcd_skip,
-					fuse_version, sw_version, cntr_flags, images_hash);
-			else
-				fprintf(stderr, " unsupported SOC revision");
-			break;
-		case DXL:
-		case ULP:
-		case IMX9:
-			build_container_qx_qm_b0(soc, sector_size, ivt_offset, ofname,
-				emmc_fastboot, (image_t *) param_stack, dcd_skip,
-				fuse_version, sw_version, cntr_flags, images_hash);
-			break;
-		default:
-			fprintf(stderr, " unrecognized SOC defined");
-			exit(EXIT_FAILURE);
-	}
+			write_region_map(ofname, (image_t *) param_stack,
+					 erase_block ? erase_block : sector_size, map);
+			if (map != region_map)
+				free(map);
+		}
 
+		if (estimate)
+			estimate_boot_qx_qm_b0(ofname, soc, 0);
 
-	fprintf(stdout, "DONE.\n");
-	fprintf(stdout, "Note: Please copy image to offset: IVT_OFFSET + IMAGE_OFFSET\n");
+		if (secondary)
+			write_secondary(ofname, secondary, combined, combined_base);
+
+		fprintf(stdout, "DONE.\n");
+		fprintf(stdout, "Note: Please copy image to offset: IVT_OFFSET + IMAGE_OFFSET\n");
+
+		if (!watch)
+			break;
+		watch_wait(ofname, watch_ms);
+	}
 
 	return 0;
 }
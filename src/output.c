@@ -0,0 +1,202 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Buffered output file writer. Writes are queued as an iovec run and go
+ * out in one pwritev() per contiguous run; small gaps between runs are
+ * bridged with zeros so that a whole boot image usually needs a handful of
+ * syscalls. The file is freshly truncated, so zero fill past the data
+ * already written is only remembered and becomes a hole.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "output.h"
+#include "stats.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define OUTPUT_IOV_MAX		64
+#define OUTPUT_STAGE_SIZE	16384
+#define OUTPUT_COPY_MAX		256	/* copied into the stage up to this size */
+#define OUTPUT_BRIDGE_MAX	65536	/* gaps up to this are written as zeros */
+
+static const uint8_t output_zeros[OUTPUT_BRIDGE_MAX];
+
+struct output {
+	char *name;
+	int fd;
+	off_t run;		/* file offset of iov[0] */
+	size_t run_len;
+	struct iovec iov[OUTPUT_IOV_MAX];
+	int iovcnt;
+	uint8_t stage[OUTPUT_STAGE_SIZE];
+	size_t stage_len;
+	off_t data_end;		/* end of the data written or queued */
+	off_t end;		/* file size, holes included */
+};
+
+output_t *output_open(const char *filename)
+{
+	output_t *out = calloc(1, sizeof(*out));
+
+	if (!out) {
+		fprintf(stderr, "%s: out of memory\n", filename);
+		exit(EXIT_FAILURE);
+	}
+
+	out->name = strdup(filename);
+	out->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0666);
+	if (out->fd < 0) {
+		fprintf(stderr, "%s: Can't open: %s\n",
+			filename, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	return out;
+}
+
+void output_flush(output_t *out)
+{
+	off_t off = out->run;
+	int i = 0;
+
+	while (i < out->iovcnt) {
+		ssize_t n = pwritev(out->fd, out->iov + i, out->iovcnt - i, off);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			fprintf(stderr, "%s: write error: %s\n",
+				out->name, n ? strerror(errno) : "no space");
+			exit(EXIT_FAILURE);
+		}
+
+		off += n;
+		while (i < out->iovcnt && (size_t)n >= out->iov[i].iov_len)
+			n -= out->iov[i++].iov_len;
+		if (n) {
+			out->iov[i].iov_base = (uint8_t *)out->iov[i].iov_base + n;
+			out->iov[i].iov_len -= n;
+		}
+	}
+
+	out->iovcnt = 0;
+	out->run_len = 0;
+	out->stage_len = 0;
+}
+
+/* Append buf, which stays valid until the next flush, to the current run */
+static void output_queue(output_t *out, off_t off, const void *buf, size_t len)
+{
+	struct iovec *last = out->iovcnt ? &out->iov[out->iovcnt - 1] : NULL;
+
+	if (last && (uint8_t *)last->iov_base + last->iov_len == buf) {
+		last->iov_len += len;
+	} else {
+		if (out->iovcnt == OUTPUT_IOV_MAX)
+			output_flush(out);
+		if (!out->iovcnt)
+			out->run = off;
+		out->iov[out->iovcnt].iov_base = (void *)buf;
+		out->iov[out->iovcnt++].iov_len = len;
+	}
+	out->run_len += len;
+
+	if (off + (off_t)len > out->data_end)
+		out->data_end = off + len;
+	if (out->data_end > out->end)
+		out->end = out->data_end;
+}
+
+/* Queue zeros from the static zero page, len is at most OUTPUT_BRIDGE_MAX */
+static void output_queue_zeros(output_t *out, off_t off, size_t len)
+{
+	output_queue(out, off, output_zeros, len);
+	stats_add(STATS_BYTES_WRITTEN, len);
+	stats_add(STATS_ZERO_WRITTEN, len);
+}
+
+/* Start a new run at off unless it continues the current one */
+static void output_seek(output_t *out, off_t off)
+{
+	off_t run_end = out->run + out->run_len;
+
+	if (!out->iovcnt || off == run_end)
+		return;
+
+	/* Nothing was written past the run yet, the gap would read as zeros */
+	if (off > run_end && run_end >= out->data_end &&
+	    off - run_end <= OUTPUT_BRIDGE_MAX)
+		output_queue_zeros(out, run_end, off - run_end);
+	else
+		output_flush(out);
+}
+
+void output_write(output_t *out, off_t off, const void *buf, size_t len)
+{
+	if (!len)
+		return;
+
+	output_seek(out, off);
+
+	if (len <= OUTPUT_COPY_MAX) {
+		/* A flush recycles the stage, so never let output_queue() do it */
+		if (out->iovcnt == OUTPUT_IOV_MAX ||
+		    out->stage_len + len > OUTPUT_STAGE_SIZE)
+			output_flush(out);
+		memcpy(out->stage + out->stage_len, buf, len);
+		buf = out->stage + out->stage_len;
+		out->stage_len += len;
+	}
+
+	output_queue(out, off, buf, len);
+	stats_add(STATS_BYTES_WRITTEN, len);
+}
+
+void output_zero(output_t *out, off_t off, size_t len)
+{
+	/* Only what may cover earlier data has to be written */
+	while (len && off < out->data_end) {
+		size_t todo = len;
+
+		if (todo > (size_t)(out->data_end - off))
+			todo = out->data_end - off;
+		if (todo > OUTPUT_BRIDGE_MAX)
+			todo = OUTPUT_BRIDGE_MAX;
+
+		output_seek(out, off);
+		output_queue_zeros(out, off, todo);
+		off += todo;
+		len -= todo;
+	}
+
+	if (off + (off_t)len > out->end)
+		out->end = off + len;
+}
+
+void output_close(output_t *out)
+{
+	output_flush(out);
+
+	if (out->end > out->data_end && ftruncate(out->fd, out->end) < 0) {
+		fprintf(stderr, "%s: Can't extend: %s\n",
+			out->name, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	close(out->fd);
+	free(out->name);
+	free(out);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Buffered output file writer: batched pwritev() runs, zero fill as holes
+ */
+
+#ifndef __MKIMAGE_OUTPUT_H__
+#define __MKIMAGE_OUTPUT_H__
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef struct output output_t;
+
+/* Create or truncate filename */
+output_t *output_open(const char *filename);
+
+/*
+ * Queue len bytes of buf at off. Writes up to a few hundred bytes are
+ * copied, larger ones are referenced: buf must then stay valid until the
+ * next output_flush() or output_close().
+ */
+void output_write(output_t *out, off_t off, const void *buf, size_t len);
+
+/*
+ * Zero len bytes at off. What lies past everything written so far is left
+ * as a hole (or bridged with zeros when the next write is close enough),
+ * only what may overwrite earlier data is actually written.
+ */
+void output_zero(output_t *out, off_t off, size_t len);
+
+void output_flush(output_t *out);
+/* Flush, extend the file over trailing holes and close it */
+void output_close(output_t *out);
+
+#endif /* __MKIMAGE_OUTPUT_H__ */
@@ -0,0 +1,30 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * USDT (systemtap sdt.h) static probes, provider "mkimage". Built in with
+ * 'make SDT=1' (needs sys/sdt.h, eg. from systemtap-sdt-dev); otherwise
+ * they compile to nothing. When built in, an unattached probe is a single
+ * nop. List them with 'bpftrace -l usdt:./mkimage_imx8:*'.
+ *
+ *   input__open(file, size)
+ *   digest__hit(file, algo)          digest__miss(file, algo)
+ *   hash__start(file, size, algo)    hash__end(file, size, algo)
+ *   copy__start(file, offset, size)  copy__end(file, offset, bytes)
+ *   flatten__start(containers)       flatten__end(containers, size)
+ *   parse__container(index, images)
+ *   extract__image(container, image, offset, size)
+ */
+
+#ifndef __MKIMAGE_PROBES_H__
+#define __MKIMAGE_PROBES_H__
+
+#ifdef MKIMAGE_SDT
+#include <sys/sdt.h>
+#define MKIMAGE_PROBE(name, ...)	STAP_PROBEV(mkimage, name, __VA_ARGS__)
+#else
+#define MKIMAGE_PROBE(name, ...)	do { } while (0)
+#endif
+
+#endif /* __MKIMAGE_PROBES_H__ */
@@ -0,0 +1,528 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * AHAB signature block: SRK table, optional certificate of a signing key
+ * (SGK) and the signature over the container header, image array and the
+ * signature block up to the signature. The image hashes are already in the
+ * image array so only the header is digested here; libcrypto just does the
+ * private key operation, on a PEM key or through a store URI (pkcs11: with
+ * the pkcs11-provider, eg. on SoftHSM).
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sign.h"
+#include "hash.h"
+
+#ifdef MKIMAGE_SIGN
+
+#include <openssl/core_names.h>
+#include <openssl/ec.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/store.h>
+#include <openssl/ui.h>
+#include <openssl/x509.h>
+
+#define SRK_TABLE_SIZE		4
+#define SRK_TABLE_TAG		0xD7
+#define SRK_TABLE_VERSION	0x42
+#define SRK_RECORD_TAG		0xE1
+#define SRK_ALG_RSA		0x21
+#define SRK_ALG_ECDSA		0x27
+#define SRK_FLAG_CA		0x80
+#define CERT_TAG		0xAF
+#define CERT_PERM_CONTAINER	0x01
+#define SIGNATURE_TAG		0xD8
+#define SIG_BLK_TAG		0x90
+
+#define SIG_BLK_ALIGN		8
+#define ALIGN_UP(x)		(((x) + SIG_BLK_ALIGN - 1) & ~(SIG_BLK_ALIGN - 1))
+
+typedef struct {
+	uint8_t tag;
+	uint16_t length;
+	uint8_t version;
+} __attribute__((packed)) srk_table_hdr_t;
+
+typedef struct {
+	uint8_t tag;
+	uint16_t length;
+	uint8_t alg;
+	uint8_t hash;
+	uint8_t key_size;
+	uint8_t not_used;
+	uint8_t flags;
+	uint16_t p1_len;	/* RSA modulus, ECDSA X */
+	uint16_t p2_len;	/* RSA exponent, ECDSA Y */
+} __attribute__((packed)) srk_record_hdr_t;
+
+typedef struct {
+	uint8_t version;
+	uint16_t length;
+	uint8_t tag;
+	uint16_t signature_offset;
+	uint8_t permissions_inv;
+	uint8_t permissions;
+} __attribute__((packed)) cert_hdr_t;
+
+typedef struct {
+	uint8_t version;
+	uint16_t length;
+	uint8_t tag;
+	uint32_t reserved;
+} __attribute__((packed)) signature_hdr_t;
+
+typedef struct {
+	EVP_PKEY *pkey;
+	uint8_t alg;
+	uint8_t key_size;
+	int hash;		/* HASH_ALGO_* */
+	uint8_t *record;	/* SRK record of the public key */
+	uint32_t record_len;
+	uint32_t sig_len;
+} sign_key_t;
+
+static sign_key_t srk[SRK_TABLE_SIZE];
+static sign_key_t signer;	/* the private key of srk[srk_index] */
+static sign_key_t sgk;
+static int srk_index;
+static bool use_sgk;
+static bool enabled;
+
+static uint8_t *srk_table;
+static uint32_t srk_table_len;
+static uint8_t *cert;
+static uint32_t cert_len;
+
+static void sign_fail(const char *what, const char *spec)
+{
+	fprintf(stderr, "%s: %s\n", spec, what);
+	ERR_print_errors_fp(stderr);
+	exit(EXIT_FAILURE);
+}
+
+/* Key backends, chosen by the prefix of the key spec */
+static EVP_PKEY *load_pem(const char *spec, bool priv)
+{
+	EVP_PKEY *pkey = NULL;
+	BIO *bio;
+
+	bio = BIO_new_file(spec, "r");
+	if (!bio)
+		sign_fail("Can't open", spec);
+
+	if (priv) {
+		pkey = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
+	} else {
+		/* SRK certificates as CST makes them, or bare public keys */
+		X509 *crt = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+
+		if (crt) {
+			pkey = X509_get_pubkey(crt);
+			X509_free(crt);
+		} else {
+			ERR_clear_error();
+			BIO_reset(bio);
+			pkey = PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL);
+		}
+	}
+	BIO_free(bio);
+
+	return pkey;
+}
+
+static EVP_PKEY *load_store(const char *spec, bool priv)
+{
+	EVP_PKEY *pkey = NULL;
+	OSSL_STORE_CTX *store;
+
+	store = OSSL_STORE_open(spec, UI_OpenSSL(), NULL, NULL, NULL);
+	if (!store)
+		return NULL;
+
+	while (!pkey && !OSSL_STORE_eof(store)) {
+		OSSL_STORE_INFO *info = OSSL_STORE_load(store);
+
+		if (!info)
+			continue;
+		switch (OSSL_STORE_INFO_get_type(info)) {
+		case OSSL_STORE_INFO_PKEY:
+			pkey = OSSL_STORE_INFO_get1_PKEY(info);
+			break;
+		case OSSL_STORE_INFO_PUBKEY:
+			if (!priv)
+				pkey = OSSL_STORE_INFO_get1_PUBKEY(info);
+			break;
+		case OSSL_STORE_INFO_CERT:
+			if (!priv)
+				pkey = X509_get_pubkey(OSSL_STORE_INFO_get0_CERT(info));
+			break;
+		default:
+			break;
+		}
+		OSSL_STORE_INFO_free(info);
+	}
+	OSSL_STORE_close(store);
+
+	return pkey;
+}
+
+static const struct {
+	const char *prefix;
+	EVP_PKEY *(*load)(const char *spec, bool priv);
+} sign_backends[] = {
+	{ "pkcs11:",	load_store },
+	{ "file:",	load_store },
+	{ "",		load_pem },
+};
+
+static EVP_PKEY *sign_load(const char *spec, bool priv)
+{
+	EVP_PKEY *pkey = NULL;
+
+	for (size_t i = 0; i < sizeof(sign_backends) / sizeof(sign_backends[0]); i++) {
+		if (!strncmp(spec, sign_backends[i].prefix, strlen(sign_backends[i].prefix))) {
+			pkey = sign_backends[i].load(spec, priv);
+			break;
+		}
+	}
+	if (!pkey)
+		sign_fail(priv ? "Can't load private key" : "Can't load public key", spec);
+
+	return pkey;
+}
+
+/* Fills in the algorithm and the SRK record of a key */
+static void sign_describe(sign_key_t *key, EVP_PKEY *pkey, const char *spec, uint8_t flags)
+{
+	uint8_t p1[512], p2[512];
+	size_t p1_len, p2_len;
+	srk_record_hdr_t hdr = { 0 };
+
+	key->pkey = pkey;
+
+	if (EVP_PKEY_is_a(pkey, "RSA")) {
+		BIGNUM *n = NULL, *e = NULL;
+
+		key->alg = SRK_ALG_RSA;
+		key->sig_len = EVP_PKEY_get_size(pkey);
+		switch (EVP_PKEY_get_bits(pkey)) {
+		case 2048:
+			key->key_size = 0x5;
+			key->hash = HASH_ALGO_SHA256;
+			break;
+		case 3072:
+			key->key_size = 0x6;
+			key->hash = HASH_ALGO_SHA384;
+			break;
+		case 4096:
+			key->key_size = 0x7;
+			key->hash = HASH_ALGO_SHA512;
+			break;
+		default:
+			sign_fail("RSA keys must be 2048, 3072 or 4096 bit", spec);
+		}
+		if (!EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_RSA_N, &n) ||
+		    !EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_RSA_E, &e))
+			sign_fail("Can't read the RSA public key", spec);
+		p1_len = BN_bn2bin(n, p1);
+		p2_len = BN_bn2bin(e, p2);
+		BN_free(n);
+		BN_free(e);
+	} else if (EVP_PKEY_is_a(pkey, "EC")) {
+		char curve[64];
+		uint8_t point[1 + 2 * 66];
+		size_t len;
+
+		key->alg = SRK_ALG_ECDSA;
+		if (!EVP_PKEY_get_utf8_string_param(pkey, OSSL_PKEY_PARAM_GROUP_NAME,
+						    curve, sizeof(curve), NULL))
+			sign_fail("Can't read the EC curve", spec);
+		if (!strcmp(curve, "prime256v1")) {
+			key->key_size = 0x1;
+			key->hash = HASH_ALGO_SHA256;
+		} else if (!strcmp(curve, "secp384r1")) {
+			key->key_size = 0x2;
+			key->hash = HASH_ALGO_SHA384;
+		} else if (!strcmp(curve, "secp521r1")) {
+			key->key_size = 0x3;
+			key->hash = HASH_ALGO_SHA512;
+		} else {
+			sign_fail("EC keys must be on prime256v1, secp384r1 or secp521r1", spec);
+		}
+		/* uncompressed point, 0x04 || X || Y */
+		if (!EVP_PKEY_get_octet_string_param(pkey, OSSL_PKEY_PARAM_ENCODED_PUBLIC_KEY,
+						     point, sizeof(point), &len) ||
+		    point[0] != 0x04)
+			sign_fail("Can't read the EC public key", spec);
+		p1_len = p2_len = (len - 1) / 2;
+		memcpy(p1, point + 1, p1_len);
+		memcpy(p2, point + 1 + p1_len, p2_len);
+		key->sig_len = 2 * p1_len;
+	} else {
+		sign_fail("Only RSA and EC keys can sign AHAB containers", spec);
+	}
+
+	hdr.tag = SRK_RECORD_TAG;
+	hdr.length = sizeof(hdr) + p1_len + p2_len;
+	hdr.alg = key->alg;
+	hdr.hash = key->hash;
+	hdr.key_size = key->key_size;
+	hdr.flags = flags;
+	hdr.p1_len = p1_len;
+	hdr.p2_len = p2_len;
+
+	key->record_len = hdr.length;
+	key->record = malloc(key->record_len);
+	if (!key->record) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(key->record, &hdr, sizeof(hdr));
+	memcpy(key->record + sizeof(hdr), p1, p1_len);
+	memcpy(key->record + sizeof(hdr) + p1_len, p2, p2_len);
+}
+
+static uint32_t signature_size(sign_key_t *key)
+{
+	return sizeof(signature_hdr_t) + key->sig_len;
+}
+
+/* Writes a signature structure over data[0..len) to out */
+static void sign_data(sign_key_t *key, const uint8_t *data, size_t len, uint8_t *out)
+{
+	static const char *md_names[] = { "SHA256", "SHA384", "SHA512" };
+	signature_hdr_t hdr = { 0 };
+	uint8_t digest[HASH_DIGEST_MAX];
+	uint8_t der[2 * 66 + 16];
+	size_t digest_len, der_len = sizeof(der);
+	EVP_PKEY_CTX *ctx;
+
+	digest_len = hash_buffer(key->hash, data, len, len, digest);
+
+	ctx = EVP_PKEY_CTX_new_from_pkey(NULL, key->pkey, NULL);
+	if (!ctx || EVP_PKEY_sign_init(ctx) <= 0 ||
+	    EVP_PKEY_CTX_set_signature_md(ctx, EVP_get_digestbyname(md_names[key->hash])) <= 0)
+		sign_fail("Can't set up the signature", "sign");
+	if (key->alg == SRK_ALG_RSA &&
+	    EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) <= 0)
+		sign_fail("Can't set up the signature", "sign");
+
+	hdr.tag = SIGNATURE_TAG;
+	hdr.length = signature_size(key);
+	memcpy(out, &hdr, sizeof(hdr));
+	out += sizeof(hdr);
+
+	if (key->alg == SRK_ALG_RSA) {
+		size_t sig_len = key->sig_len;
+
+		if (EVP_PKEY_sign(ctx, out, &sig_len, digest, digest_len) <= 0 ||
+		    sig_len != key->sig_len)
+			sign_fail("Signing failed", "sign");
+	} else {
+		/* DER SEQUENCE { r, s } to the raw r || s the ROM takes */
+		const uint8_t *p = der;
+		const BIGNUM *r, *s;
+		ECDSA_SIG *sig;
+
+		if (EVP_PKEY_sign(ctx, der, &der_len, digest, digest_len) <= 0)
+			sign_fail("Signing failed", "sign");
+		sig = d2i_ECDSA_SIG(NULL, &p, der_len);
+		if (!sig)
+			sign_fail("Bad ECDSA signature", "sign");
+		ECDSA_SIG_get0(sig, &r, &s);
+		BN_bn2binpad(r, out, key->sig_len / 2);
+		BN_bn2binpad(s, out + key->sig_len / 2, key->sig_len / 2);
+		ECDSA_SIG_free(sig);
+	}
+
+	EVP_PKEY_CTX_free(ctx);
+}
+
+void sign_setup(const char *srk_list, int index, const char *key, const char *sgk_spec,
+		int srk_hash)
+{
+	srk_table_hdr_t hdr = { 0 };
+	uint8_t digest[HASH_DIGEST_MAX];
+	char *list, *spec, *save;
+	size_t len;
+	uint8_t *p;
+	int n = 0;
+
+	if (!srk_list) {
+		fprintf(stderr, "-sign_key needs -srk_table\n");
+		exit(EXIT_FAILURE);
+	}
+	if (index < 0 || index >= SRK_TABLE_SIZE) {
+		fprintf(stderr, "-srk_index must be 0 to %d\n", SRK_TABLE_SIZE - 1);
+		exit(EXIT_FAILURE);
+	}
+	srk_index = index;
+	use_sgk = sgk_spec != NULL;
+
+	list = strdup(srk_list);
+	if (!list) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		exit(EXIT_FAILURE);
+	}
+	for (spec = strtok_r(list, ",", &save); spec; spec = strtok_r(NULL, ",", &save)) {
+		if (n == SRK_TABLE_SIZE)
+			break;
+		sign_describe(&srk[n++], sign_load(spec, false), spec,
+			      use_sgk ? SRK_FLAG_CA : 0);
+	}
+	if (n != SRK_TABLE_SIZE || spec) {
+		fprintf(stderr, "-srk_table needs %d public keys\n", SRK_TABLE_SIZE);
+		exit(EXIT_FAILURE);
+	}
+	free(list);
+
+	sign_describe(&signer, sign_load(key, true), key, 0);
+	if (EVP_PKEY_eq(signer.pkey, srk[srk_index].pkey) != 1) {
+		fprintf(stderr, "%s: not the private key of SRK %d\n", key, srk_index);
+		exit(EXIT_FAILURE);
+	}
+
+	/* SRK table, its srk_hash digest is what gets fused */
+	srk_table_len = sizeof(hdr);
+	for (n = 0; n < SRK_TABLE_SIZE; n++)
+		srk_table_len += srk[n].record_len;
+	srk_table = malloc(srk_table_len);
+	if (!srk_table) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		exit(EXIT_FAILURE);
+	}
+	hdr.tag = SRK_TABLE_TAG;
+	hdr.length = srk_table_len;
+	hdr.version = SRK_TABLE_VERSION;
+	p = srk_table;
+	memcpy(p, &hdr, sizeof(hdr));
+	p += sizeof(hdr);
+	for (n = 0; n < SRK_TABLE_SIZE; n++) {
+		memcpy(p, srk[n].record, srk[n].record_len);
+		p += srk[n].record_len;
+	}
+
+	len = hash_buffer(srk_hash, srk_table, srk_table_len, srk_table_len, digest);
+	fprintf(stdout, "SRK table hash:\t");
+	for (n = 0; n < (int)len; n++)
+		fprintf(stdout, "%02x", digest[n]);
+	fprintf(stdout, "\n");
+
+	/* SGK certificate, signed once by the SRK and reused in every container */
+	if (use_sgk) {
+		cert_hdr_t chdr = { 0 };
+
+		sign_describe(&sgk, sign_load(sgk_spec, true), sgk_spec, 0);
+		chdr.tag = CERT_TAG;
+		chdr.signature_offset = ALIGN_UP(sizeof(chdr) + sgk.record_len);
+		chdr.length = chdr.signature_offset + signature_size(&signer);
+		chdr.permissions = CERT_PERM_CONTAINER;
+		chdr.permissions_inv = ~CERT_PERM_CONTAINER;
+		cert_len = chdr.length;
+		cert = calloc(1, cert_len);
+		if (!cert) {
+			fprintf(stderr, "Failed to allocate memory\n");
+			exit(EXIT_FAILURE);
+		}
+		memcpy(cert, &chdr, sizeof(chdr));
+		memcpy(cert + sizeof(chdr), sgk.record, sgk.record_len);
+		sign_data(&signer, cert, chdr.signature_offset, cert + chdr.signature_offset);
+	}
+
+	enabled = true;
+}
+
+bool sign_enabled(void)
+{
+	return enabled;
+}
+
+uint32_t sign_container_flags(uint32_t flags)
+{
+	/* SRK set OEM in bits 1:0, the SRK used in bits 5:4 */
+	return (flags & ~0x33) | 0x2 | (srk_index << 4);
+}
+
+static uint32_t sign_cert_offset(void)
+{
+	return ALIGN_UP(sizeof(sig_blk_hdr_t) + srk_table_len);
+}
+
+static uint32_t sign_signature_offset(void)
+{
+	return cert ? ALIGN_UP(sign_cert_offset() + cert_len) : sign_cert_offset();
+}
+
+static uint32_t sign_blob_offset(void)
+{
+	return ALIGN_UP(sign_signature_offset() + signature_size(use_sgk ? &sgk : &signer));
+}
+
+uint32_t sign_block_size(uint32_t blob_len)
+{
+	if (blob_len)
+		return sign_blob_offset() + blob_len;
+	return sign_signature_offset() + signature_size(use_sgk ? &sgk : &signer);
+}
+
+void sign_container(uint8_t *cntr, uint32_t sig_blk_offset, uint32_t blob_len)
+{
+	sig_blk_hdr_t hdr = { 0 };
+	uint8_t *blk = cntr + sig_blk_offset;
+
+	hdr.tag = SIG_BLK_TAG;
+	hdr.length = sign_block_size(blob_len);
+	hdr.srk_table_offset = sizeof(hdr);
+	hdr.cert_offset = cert ? sign_cert_offset() : 0;
+	/* The blob is not signed, but where it goes is */
+	hdr.blob_offset = blob_len ? sign_blob_offset() : 0;
+	hdr.signature_offset = sign_signature_offset();
+
+	memset(blk, 0, hdr.length);
+	memcpy(blk, &hdr, sizeof(hdr));
+	memcpy(blk + hdr.srk_table_offset, srk_table, srk_table_len);
+	if (cert)
+		memcpy(blk + hdr.cert_offset, cert, cert_len);
+
+	sign_data(use_sgk ? &sgk : &signer, cntr, sig_blk_offset + hdr.signature_offset,
+		  blk + hdr.signature_offset);
+}
+
+#else /* !MKIMAGE_SIGN */
+
+void sign_setup(const char *srk_list, int index, const char *key, const char *sgk,
+		int srk_hash)
+{
+	fprintf(stderr, "-sign_key: built without signing support, rebuild with 'make SIGN=1'\n");
+	exit(EXIT_FAILURE);
+}
+
+bool sign_enabled(void)
+{
+	return false;
+}
+
+uint32_t sign_container_flags(uint32_t flags)
+{
+	return flags;
+}
+
+uint32_t sign_block_size(uint32_t blob_len)
+{
+	return 0;
+}
+
+void sign_container(uint8_t *cntr, uint32_t sig_blk_offset, uint32_t blob_len)
+{
+}
+
+#endif /* MKIMAGE_SIGN */
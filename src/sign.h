@@ -0,0 +1,47 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * In-process AHAB container signing, built in with 'make SIGN=1'
+ */
+
+#ifndef __MKIMAGE_SIGN_H__
+#define __MKIMAGE_SIGN_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Signature block header, at the container's signature block offset */
+typedef struct {
+	uint8_t version;
+	uint16_t length;
+	uint8_t tag;
+	uint16_t srk_table_offset;
+	uint16_t cert_offset;
+	uint16_t blob_offset;
+	uint16_t signature_offset;
+	uint32_t reserved;
+} __attribute__((packed)) sig_blk_hdr_t;
+
+/*
+ * srk_list is the four SRK public keys, comma separated, index the one
+ * that signs. sgk, if not NULL, is a signing key the SRK certifies, it then
+ * signs the containers instead. Keys are PEM files or pkcs11: URIs.
+ * srk_hash is the HASH_ALGO_* the SoC fuses the SRK table hash with.
+ */
+void sign_setup(const char *srk_list, int index, const char *key, const char *sgk,
+		int srk_hash);
+bool sign_enabled(void);
+/* Container flags with the OEM SRK set and the SRK index */
+uint32_t sign_container_flags(uint32_t flags);
+/* Size of the signature block sign_container() writes */
+uint32_t sign_block_size(uint32_t blob_len);
+/*
+ * Writes the signature block at cntr + sig_blk_offset and signs cntr up to
+ * its signature. cntr holds the container header and image array. blob_len,
+ * if not 0, reserves a zeroed DEK blob slot of that size past the signature.
+ */
+void sign_container(uint8_t *cntr, uint32_t sig_blk_offset, uint32_t blob_len);
+
+#endif /* __MKIMAGE_SIGN_H__ */
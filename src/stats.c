@@ -0,0 +1,269 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Per-phase timing and I/O accounting. Timestamps are always taken (two
+ * clock reads per phase, nothing next to the file I/O they measure); the
+ * report is only printed at exit when --stats was given.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "stats.h"
+#include "trace.h"
+
+#define STATS_MAX_DEPTH		8
+#define STATS_MAX_IMAGES	64
+
+typedef struct {
+	const char *name;
+	double wall[STATS_PHASE_COUNT];
+} stats_image_t;
+
+typedef struct {
+	stats_phase_t phase;
+	stats_image_t *image;
+} stats_frame_t;
+
+static const char *phase_names[STATS_PHASE_COUNT] = {
+	[STATS_ARGS]	= "args",
+	[STATS_LAYOUT]	= "layout",
+	[STATS_HASH]	= "hash",
+	[STATS_COPY]	= "copy",
+	[STATS_PAD]	= "pad",
+	[STATS_FLATTEN]	= "flatten",
+	[STATS_PARSE]	= "parse",
+};
+
+static double phase_wall[STATS_PHASE_COUNT], phase_cpu[STATS_PHASE_COUNT];
+static uint64_t counters[STATS_COUNTER_COUNT];
+static stats_image_t images[STATS_MAX_IMAGES];
+static int image_count;
+static stats_frame_t stack[STATS_MAX_DEPTH];
+static int depth;
+static double mark_wall, mark_cpu, start_wall, base_cpu;
+static long long base_syscr, base_syscw;
+static double rebuild_ms;
+static int rebuild_inputs;
+static const char *output_name;
+static bool json, enabled;
+
+static double now(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* Charge the time since the last mark to the innermost phase */
+static void stats_charge(void)
+{
+	double wall = now(CLOCK_MONOTONIC), cpu = now(CLOCK_PROCESS_CPUTIME_ID);
+
+	if (depth) {
+		stats_frame_t *f = &stack[depth - 1];
+
+		phase_wall[f->phase] += wall - mark_wall;
+		phase_cpu[f->phase] += cpu - mark_cpu;
+		if (f->image)
+			f->image->wall[f->phase] += wall - mark_wall;
+	}
+
+	mark_wall = wall;
+	mark_cpu = cpu;
+}
+
+static stats_image_t *stats_image(const char *name)
+{
+	for (int i = 0; i < image_count; i++) {
+		if (!strcmp(images[i].name, name))
+			return &images[i];
+	}
+
+	if (image_count == STATS_MAX_IMAGES)
+		return NULL;
+
+	images[image_count].name = name;
+	return &images[image_count++];
+}
+
+void stats_begin(stats_phase_t phase, const char *image)
+{
+	trace_begin("phase", phase_names[phase], image);
+
+	if (!start_wall)
+		start_wall = now(CLOCK_MONOTONIC);
+
+	stats_charge();
+
+	if (depth == STATS_MAX_DEPTH)
+		return;
+
+	stack[depth].phase = phase;
+	/* A nested phase without a name still belongs to the outer image */
+	stack[depth].image = image ? stats_image(image) :
+			     depth ? stack[depth - 1].image : NULL;
+	depth++;
+}
+
+void stats_end(stats_phase_t phase)
+{
+	trace_end();
+	stats_charge();
+
+	if (depth && stack[depth - 1].phase == phase)
+		depth--;
+}
+
+void stats_add(stats_counter_t counter, uint64_t n)
+{
+	counters[counter] += n;
+}
+
+void stats_output(const char *filename)
+{
+	output_name = filename;
+}
+
+/* read()/write() syscall counts of this process, -1 if not available */
+static void proc_io(long long *syscr, long long *syscw)
+{
+	FILE *fp = fopen("/proc/self/io", "r");
+	char line[128];
+
+	*syscr = *syscw = -1;
+	if (!fp)
+		return;
+
+	while (fgets(line, sizeof(line), fp)) {
+		sscanf(line, "syscr: %lld", syscr);
+		sscanf(line, "syscw: %lld", syscw);
+	}
+	fclose(fp);
+}
+
+void stats_report(void)
+{
+	double total = now(CLOCK_MONOTONIC) - start_wall;
+	double total_cpu = now(CLOCK_PROCESS_CPUTIME_ID) - base_cpu;
+	double hash_mbs = 0;
+	long long syscr, syscw, holes = 0;
+	struct rusage ru;
+	struct stat sbuf;
+
+	/* Off, or nothing ran since the last report (--watch) */
+	if (!enabled || !start_wall)
+		return;
+
+	while (depth) {
+		stats_charge();
+		depth--;
+	}
+
+	proc_io(&syscr, &syscw);
+	if (syscr >= 0) {
+		syscr -= base_syscr;
+		syscw -= base_syscw;
+	}
+	getrusage(RUSAGE_SELF, &ru);
+	if (output_name && !stat(output_name, &sbuf) &&
+	    sbuf.st_size > (off_t)sbuf.st_blocks * 512)
+		holes = sbuf.st_size - (off_t)sbuf.st_blocks * 512;
+	if (phase_wall[STATS_HASH] > 0)
+		hash_mbs = counters[STATS_BYTES_HASHED] / 1e3 / phase_wall[STATS_HASH];
+
+	if (json) {
+		fprintf(stderr, "{\n  \"wall_ms\": %.3f, \"cpu_ms\": %.3f,\n  \"phases\": {",
+			total, total_cpu);
+		for (int i = 0; i < STATS_PHASE_COUNT; i++)
+			fprintf(stderr, "%s\n    \"%s\": { \"wall_ms\": %.3f, \"cpu_ms\": %.3f }",
+				i ? "," : "", phase_names[i], phase_wall[i], phase_cpu[i]);
+		fprintf(stderr, "\n  },\n  \"images\": [");
+		for (int i = 0; i < image_count; i++) {
+			fprintf(stderr, "%s\n    { \"name\": \"%s\"", i ? "," : "", images[i].name);
+			for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+				if (images[i].wall[p] > 0)
+					fprintf(stderr, ", \"%s_ms\": %.3f", phase_names[p], images[i].wall[p]);
+			}
+			fprintf(stderr, " }");
+		}
+		fprintf(stderr, "\n  ],\n");
+		fprintf(stderr, "  \"bytes_read\": %llu, \"bytes_written\": %llu, \"zero_bytes_written\": %llu, \"output_holes\": %lld,\n",
+			(unsigned long long)counters[STATS_BYTES_READ],
+			(unsigned long long)counters[STATS_BYTES_WRITTEN],
+			(unsigned long long)counters[STATS_ZERO_WRITTEN], holes);
+		fprintf(stderr, "  \"read_syscalls\": %lld, \"write_syscalls\": %lld,\n", syscr, syscw);
+		if (rebuild_inputs)
+			fprintf(stderr, "  \"rebuild_ms\": %.3f, \"inputs_changed\": %d,\n",
+				rebuild_ms, rebuild_inputs);
+		fprintf(stderr, "  \"bytes_hashed\": %llu, \"hash_mb_s\": %.1f, \"peak_rss_kb\": %ld\n}\n",
+			(unsigned long long)counters[STATS_BYTES_HASHED], hash_mbs, ru.ru_maxrss);
+		return;
+	}
+
+	fprintf(stderr, "\n%-12s %12s %12s\n", "PHASE", "WALL ms", "CPU ms");
+	for (int i = 0; i < STATS_PHASE_COUNT; i++)
+		fprintf(stderr, "%-12s %12.3f %12.3f\n", phase_names[i], phase_wall[i], phase_cpu[i]);
+	fprintf(stderr, "%-12s %12.3f %12.3f\n", "total", total, total_cpu);
+
+	if (image_count) {
+		fprintf(stderr, "\n%-32s %10s %10s %10s\n", "IMAGE", "hash ms", "copy ms", "pad ms");
+		for (int i = 0; i < image_count; i++)
+			fprintf(stderr, "%-32s %10.3f %10.3f %10.3f\n", images[i].name,
+				images[i].wall[STATS_HASH], images[i].wall[STATS_COPY],
+				images[i].wall[STATS_PAD]);
+	}
+
+	fprintf(stderr, "\nbytes read          %llu\n", (unsigned long long)counters[STATS_BYTES_READ]);
+	fprintf(stderr, "bytes written       %llu\n", (unsigned long long)counters[STATS_BYTES_WRITTEN]);
+	fprintf(stderr, "zero bytes written  %llu\n", (unsigned long long)counters[STATS_ZERO_WRITTEN]);
+	fprintf(stderr, "output holes        %lld\n", holes);
+	fprintf(stderr, "read/write syscalls %lld/%lld\n", syscr, syscw);
+	fprintf(stderr, "hashed              %llu bytes, %.1f MB/s\n",
+		(unsigned long long)counters[STATS_BYTES_HASHED], hash_mbs);
+	fprintf(stderr, "peak RSS            %ld KB\n", ru.ru_maxrss);
+	if (rebuild_inputs)
+		fprintf(stderr, "rebuild             %.3f ms, %d input%s changed\n",
+			rebuild_ms, rebuild_inputs, rebuild_inputs > 1 ? "s" : "");
+}
+
+void stats_rebuild(double latency_ms, int inputs_changed)
+{
+	rebuild_ms = latency_ms;
+	rebuild_inputs = inputs_changed;
+}
+
+void stats_restart(void)
+{
+	stats_report();
+
+	memset(phase_wall, 0, sizeof(phase_wall));
+	memset(phase_cpu, 0, sizeof(phase_cpu));
+	memset(counters, 0, sizeof(counters));
+	image_count = 0;
+	start_wall = 0;
+	base_cpu = now(CLOCK_PROCESS_CPUTIME_ID);
+	proc_io(&base_syscr, &base_syscw);
+	rebuild_inputs = 0;
+}
+
+void stats_enable(const char *format)
+{
+	if (format && strcmp(format, "table") && strcmp(format, "json")) {
+		fprintf(stderr, "--stats: unknown format '%s' (table or json)\n", format);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!enabled)
+		atexit(stats_report);
+	json = format && !strcmp(format, "json");
+	enabled = true;
+}
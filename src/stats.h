@@ -0,0 +1,54 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Per-phase timing and I/O accounting, reported with --stats
+ */
+
+#ifndef __MKIMAGE_STATS_H__
+#define __MKIMAGE_STATS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+	STATS_ARGS,		/* command line parsing */
+	STATS_LAYOUT,		/* offsets, headers, image array */
+	STATS_HASH,
+	STATS_COPY,
+	STATS_PAD,
+	STATS_FLATTEN,		/* container header / FIT structure */
+	STATS_PARSE,		/* -parse / -extract */
+	STATS_PHASE_COUNT
+} stats_phase_t;
+
+typedef enum {
+	STATS_BYTES_READ,
+	STATS_BYTES_WRITTEN,
+	STATS_ZERO_WRITTEN,
+	STATS_BYTES_HASHED,
+	STATS_COUNTER_COUNT
+} stats_counter_t;
+
+/* format is NULL or "table" for a table, "json" for JSON, both on stderr */
+void stats_enable(const char *format);
+/* Output file, its holes are reported */
+void stats_output(const char *filename);
+/* Prints the report of --stats, done at exit */
+void stats_report(void);
+
+/*
+ * Phases nest; time is charged to the innermost one only. image, if not
+ * NULL, also gets a row of its own in the report.
+ */
+void stats_begin(stats_phase_t phase, const char *image);
+void stats_end(stats_phase_t phase);
+void stats_add(stats_counter_t counter, uint64_t n);
+
+/* --watch: time from the first input change to the rebuilt output */
+void stats_rebuild(double latency_ms, int inputs_changed);
+/* --watch: report the build just done, if enabled, and start afresh */
+void stats_restart(void);
+
+#endif /* __MKIMAGE_STATS_H__ */
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Trace Event Format writer. Every span is a B/E event pair written as it
+ * happens, tagged with the kernel thread id so that worker threads show up
+ * as their own tracks. The stats phases are traced automatically.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "trace.h"
+
+static FILE *trace_fp;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Spans opened since tracing started, an end without a begin is dropped */
+static __thread int trace_depth;
+
+static double trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* JSON string body, only quotes, backslashes and control chars need care */
+static void trace_string(const char *s)
+{
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(trace_fp, "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			fprintf(trace_fp, "\\u%04x", *s);
+		else
+			fputc(*s, trace_fp);
+	}
+}
+
+static void trace_event(char ph, const char *cat, const char *name, const char *file)
+{
+	double ts = trace_now();
+	long tid = syscall(SYS_gettid);
+
+	pthread_mutex_lock(&trace_lock);
+	fprintf(trace_fp, ",\n{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%ld",
+		ph, ts, (int)getpid(), tid);
+	if (cat) {
+		fprintf(trace_fp, ",\"cat\":\"%s\",\"name\":\"", cat);
+		trace_string(name);
+		fputc('"', trace_fp);
+	}
+	if (file) {
+		fprintf(trace_fp, ",\"args\":{\"file\":\"");
+		trace_string(file);
+		fprintf(trace_fp, "\"}");
+	}
+	fputc('}', trace_fp);
+	pthread_mutex_unlock(&trace_lock);
+}
+
+void trace_begin(const char *cat, const char *name, const char *file)
+{
+	if (trace_fp) {
+		trace_event('B', cat, name, file);
+		trace_depth++;
+	}
+}
+
+void trace_end(void)
+{
+	if (trace_fp && trace_depth) {
+		trace_event('E', NULL, NULL, NULL);
+		trace_depth--;
+	}
+}
+
+void trace_close(void)
+{
+	if (!trace_fp)
+		return;
+
+	fprintf(trace_fp, "\n]}\n");
+	fclose(trace_fp);
+	trace_fp = NULL;
+}
+
+void trace_open(const char *filename)
+{
+	if (trace_fp) {
+		fprintf(stderr, "--trace given twice\n");
+		exit(EXIT_FAILURE);
+	}
+
+	trace_fp = fopen(filename, "w");
+	if (!trace_fp) {
+		fprintf(stderr, "%s: Can't open: %s\n", filename, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	/* Process name metadata event first, every other event starts with ',' */
+	fprintf(trace_fp, "{\"traceEvents\":[\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"mkimage\"}}",
+		(int)getpid());
+	atexit(trace_close);
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * Trace Event Format (chrome://tracing, Perfetto) output, --trace FILE
+ */
+
+#ifndef __MKIMAGE_TRACE_H__
+#define __MKIMAGE_TRACE_H__
+
+void trace_open(const char *filename);
+/* Terminates the JSON and closes the file, done at exit */
+void trace_close(void);
+
+/*
+ * Open and close a span on the calling thread. file, if not NULL, is shown
+ * as the span argument. Both are no-ops until trace_open() was called.
+ */
+void trace_begin(const char *cat, const char *name, const char *file);
+void trace_end(void);
+
+#endif /* __MKIMAGE_TRACE_H__ */
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * --watch. The directories of the inputs are watched with inotify rather
+ * than the files themselves, as build systems tend to replace a file
+ * (write a new one, rename it over) instead of rewriting it. Changed
+ * inputs are reloaded, which drops their cached digests; the rebuild then
+ * hashes and writes only those (see build_container_qx_qm_b0()). A part
+ * of a '@name' composed image can't be reloaded on its own, so a change to
+ * one starts the whole command over.
+ *
+ * SIGINT and SIGTERM are only taken while waiting for changes (ppoll), so
+ * an interrupt never cuts a build short, and end the command with exit()
+ * for --trace and --stats to finish their output.
+ */
+
+#include "mkimage_common.h"
+#include "stats.h"
+#include "trace.h"
+#include "watch.h"
+
+#include <libgen.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/inotify.h>
+
+#define WATCH_MAX_FILES		64
+#define WATCH_EVENTS		(IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB)
+
+typedef struct {
+	input_t *in;
+	int wd;
+	char *base;
+	bool pending;
+} watch_file_t;
+
+static watch_file_t files[WATCH_MAX_FILES];
+static int file_count;
+static int ifd = -1;
+static char **args;
+static double first_change;
+static int batch_changed;
+static sigset_t wait_mask;
+static volatile sig_atomic_t stop;
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+void watch_args(int argc, char **argv)
+{
+	/* getopt permutes argv, keep it as given */
+	args = malloc((argc + 1) * sizeof(*args));
+	if (!args) {
+		fprintf(stderr, "Failed to allocate memory\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(args, argv, (argc + 1) * sizeof(*args));
+}
+
+static void watch_signal(int sig)
+{
+	stop = 1;
+}
+
+static void watch_setup(const char *ofname)
+{
+	struct sigaction sa = { .sa_handler = watch_signal };
+	sigset_t block;
+
+	/* Blocked but while in ppoll(), no SA_RESTART to get its EINTR */
+	sigemptyset(&block);
+	sigaddset(&block, SIGINT);
+	sigaddset(&block, SIGTERM);
+	sigprocmask(SIG_BLOCK, &block, &wait_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	ifd = inotify_init1(IN_CLOEXEC);
+	if (ifd < 0) {
+		fprintf(stderr, "--watch: inotify: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	for (input_t *in = input_next(NULL); in; in = input_next(in)) {
+		watch_file_t *f = &files[file_count];
+		char *path, *dir;
+
+		/* The output is read back for -secondary, it is not an input */
+		if (!input_is_file(in) || !strcmp(input_name(in), ofname))
+			continue;
+		if (file_count == WATCH_MAX_FILES) {
+			fprintf(stderr, "--watch: too many inputs (max %d)\n", WATCH_MAX_FILES);
+			exit(EXIT_FAILURE);
+		}
+
+		path = strdup(input_name(in));
+		f->base = strdup(basename(path));
+		strcpy(path, input_name(in));
+		dir = dirname(path);
+		f->wd = inotify_add_watch(ifd, dir, WATCH_EVENTS);
+		if (f->wd < 0) {
+			fprintf(stderr, "--watch: %s: %s\n", dir, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		f->in = in;
+		file_count++;
+		free(path);
+	}
+
+	fprintf(stdout, "WATCH:\t%d inputs\n", file_count);
+}
+
+/* Wait up to timeout_ms (-1 for ever) for events, false on a timeout */
+static bool watch_read(int timeout_ms)
+{
+	struct pollfd pfd = { .fd = ifd, .events = POLLIN };
+	struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+
+	if (ppoll(&pfd, 1, timeout_ms < 0 ? NULL : &ts, &wait_mask) <= 0) {
+		if (stop) {
+			fprintf(stdout, "WATCH:\tinterrupted\n");
+			exit(EXIT_SUCCESS);
+		}
+		return false;
+	}
+
+	len = read(ifd, buf, sizeof(buf));
+	for (char *p = buf; len > 0 && p < buf + len; ) {
+		struct inotify_event *ev = (struct inotify_event *)p;
+
+		for (int i = 0; ev->len && i < file_count; i++) {
+			if (files[i].wd == ev->wd && !strcmp(files[i].base, ev->name))
+				files[i].pending = true;
+		}
+		p += sizeof(*ev) + ev->len;
+	}
+
+	return true;
+}
+
+void watch_wait(const char *ofname, unsigned int debounce_ms)
+{
+	int changed;
+
+	if (first_change) {
+		double latency = now_ms() - first_change;
+
+		fprintf(stdout, "WATCH:\t%s rebuilt in %.3f ms\n", ofname, latency);
+		stats_rebuild(latency, batch_changed);
+	}
+	stats_restart();
+
+	if (ifd < 0)
+		watch_setup(ofname);
+	fflush(stdout);
+
+	do {
+		bool restart = false;
+
+		watch_read(-1);
+		first_change = now_ms();
+		while (watch_read(debounce_ms))
+			;
+
+		changed = 0;
+		for (int i = 0; i < file_count; i++) {
+			if (!files[i].pending)
+				continue;
+			files[i].pending = false;
+			if (!input_reload(files[i].in))
+				continue;
+			fprintf(stdout, "WATCH:\t%s changed\n", input_name(files[i].in));
+			restart |= input_composed(files[i].in);
+			changed++;
+		}
+
+		if (restart) {
+			fprintf(stdout, "WATCH:\tpart of a composed image changed, starting over\n");
+			/* execv() skips the atexit() handlers */
+			trace_close();
+			stats_report();
+			fflush(stdout);
+			fflush(stderr);
+			sigprocmask(SIG_SETMASK, &wait_mask, NULL);
+			if (stop)
+				exit(EXIT_SUCCESS);
+			execv("/proc/self/exe", args);
+			fprintf(stderr, "--watch: can't restart: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	} while (!changed);
+
+	batch_changed = changed;
+}
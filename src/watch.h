@@ -0,0 +1,22 @@
+/*
+ * Copyright 2026 NXP
+ *
+ * SPDX-License-Identifier:     GPL-2.0+
+ *
+ * --watch: rebuild the output whenever one of its inputs changes
+ */
+
+#ifndef __MKIMAGE_WATCH_H__
+#define __MKIMAGE_WATCH_H__
+
+/* The command line, to start over with when a composed image needs it */
+void watch_args(int argc, char **argv);
+
+/*
+ * Report the build just done, then block until some inputs have changed.
+ * Changes closer than debounce_ms to each other are taken as one batch.
+ * Returns with the changed inputs reloaded, ready for the rebuild.
+ */
+void watch_wait(const char *ofname, unsigned int debounce_ms);
+
+#endif /* __MKIMAGE_WATCH_H__ */